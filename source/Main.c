@@ -19,23 +19,50 @@
 #include "right_panel.h"
 #include "fill_algorithms.h"
 #include "image_management.h"
+#include "image_cache.h"
+#include "image_index.h"
+#include "result_writer.h"
+#include "animation_export.h"
+#include "hardware_counters.h"
+#include "trace.h"
+#include "benchmark.h"
+#include "image_generator.h"
+#include "regression_gate.h"
+#include "fuzz_harness.h"
+#include "visit_heatmap.h"
+#include "stb_image.h"
 
 void check_init(bool checked_function);
 void init_allegro(ALLEGRO_EVENT_QUEUE**, ALLEGRO_DISPLAY**);
-void get_image_names();
 void load_fonts();
 void main_loop(ALLEGRO_EVENT_QUEUE*, ALLEGRO_DISPLAY*);
 void clean_up_allegro(ALLEGRO_EVENT_QUEUE**, ALLEGRO_DISPLAY**);
 void quantize_mouse_position(uint32_t, uint32_t*, uint32_t*);
+void prefetch_neighbour_images();
+int run_headless(int, char**);
+bool load_headless_image(const char*, Image*, uint32_t*, uint32_t*);
+uint32_t parse_start_coordinate(const char*, uint32_t);
+int run_export_command(int, char**);
+int run_benchmark_command(int, char**);
+int run_layout_benchmark_command(int, char**);
+int run_batch_benchmark_command(int, char**);
+int run_generate_command(int, char**);
+int run_benchmark_suite_command(int, char**);
+void print_suite_result(const char*, const BenchmarkResult*, void*);
+int run_regression_gate_command(int, char**);
+void print_and_collect_result(const char*, const BenchmarkResult*, void*);
+int run_fuzz_command(int, char**);
+int run_distance_map_command(int, char**);
 
 void fill_with_color(Image*, algorithm_t, uint32_t, uint32_t);
+void recolor_all_regions(Image*);
 bool check_if_clicked_on_image(ALLEGRO_MOUSE_STATE, Image);
 
 MeasureValues measure_values;
 uint32_t IMAGE_AMOUNT;
 ALLEGRO_USTR** image_names;
 bool visualisation_mode = false;
-uint32_t ALGORITHM_AMOUNT = 4;
+uint32_t ALGORITHM_AMOUNT = 8;
 
 Color_t replacement_color = { 128, 128, 255 };
 
@@ -45,104 +72,602 @@ ALLEGRO_FONT* hint_font;
 uint32_t current_image = 0;
 uint32_t current_algorithm = STACK_BASED_RECURSIVE_FOUR_WAY;
 
-int main()
+#if !FUZZ_LIBFUZZER
+int main(int argc, char** argv)
 {
+	//! Z argumentami program działa bez okna, patrz run_headless.
+	if (argc > 1) return run_headless(argc, argv);
+
 	ALLEGRO_EVENT_QUEUE* queue = NULL;
 	ALLEGRO_DISPLAY* display = NULL;
 	init_allegro(&queue, &display);
-	get_image_names();
+	init_image_index("Images");
 	load_fonts();
+	init_image_cache(IMAGE_CACHE_MEMORY_BUDGET);
+	init_result_writer();
 
 	main_loop(queue, display);
 
+	destroy_result_writer();
+	destroy_image_cache();
+	close_hardware_counters();
+#if TRACE_TIMELINE
+	write_trace("trace.json");
+#endif
 	clean_up_allegro(&queue, &display);
+	destroy_image_index();
 	return EXIT_SUCCESS;
 }
+#endif
 
-//! Sprawdza inicjalizacje pierwszych funkcji w init_allegro(), w przypadku błędu kończy działanie aplikacji.
-//! \param bool checked_function Sprawdzana funkcja z Allegro5.
-void check_init(bool checked_function)
+/*!
+* Wykonuje polecenie podane w linii poleceń, bez tworzenia okna.
+* --export <obraz> <x> <y> <algorytm> <plik> [pikseli_na_klatke] zapisuje animację wypełniania do pliku .y4m, .gif albo surowych klatek RGB.
+* --benchmark <obraz> <x> <y> [powtórzenia] [rozgrzewki] [warm|cold] [plik.csv] mierzy wszystkie algorytmy, wyniki dopisuje do pliku CSV.
+* --benchmark-layout <obraz> <x> <y> [powtórzenia] [rozgrzewki] [warm|cold] [plik.csv] porównuje algorytmy na obrazie w wierszach i w kafelkach.
+* --benchmark-batch <obraz> <punkty> [powtórzenia] [rozgrzewki] [algorytm] [ziarno] porównuje flood_fill_batch z osobnym flood_fill dla każdego z losowych punktów.
+* --generate <wzór> <szerokość> <wysokość> <plik.bmp> [ziarno] [parametr] zapisuje wygenerowany obraz testowy.
+* --benchmark-suite <megapiksele> [powtórzenia] [rozgrzewki] [warm|cold] [plik.csv] mierzy wszystkie algorytmy na wszystkich wzorach, od 1 KP do podanego rozmiaru.
+* --regression-gate <punkt_odniesienia.json> <megapiksele> [powtórzenia] [rozgrzewki] [raport.md] powtarza pomiary --benchmark-suite
+* i porównuje je z punktem odniesienia, kończy się kodem błędu przy regresji albo braku punktu odniesienia. --record-baseline z tymi samymi argumentami zapisuje nowy punkt odniesienia.
+* --fuzz [ilość] [ziarno] [folder] porównuje wszystkie algorytmy z wzorcowym na obrazach z folderu i losowych obrazach oraz sprawdza
+* zapis i odczyt każdego z nich w QOI, kończy się kodem błędu przy niezgodności.
+* --write-fuzz-corpus <folder_korpusu> [folder] zapisuje korpus dla libFuzzera z obrazów z folderu.
+* --distance-map <obraz> <x> <y> <plik> [algorytm] zapisuje odległości pikseli obszaru od punktu startowego, wyznaczone przez wypełnianie BFS.
+* Algorytm to numer z algorithm_t. Zamiast obrazu można podać opis wzór:szerokośćxwysokość[:ziarno[:parametr]], a zamiast x i y słowo auto,
+* wtedy wypełnianie zaczyna się w punkcie zaproponowanym przez generator albo na środku obrazu.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_headless(int argc, char** argv)
 {
-	if (!checked_function)
-	{
-		printf("%s", "Error initializing function, refer to debugger.");
-		exit(EXIT_FAILURE);
+	check_init(al_init());
+
+	int exit_code = EXIT_FAILURE;
+	if (!strcmp(argv[1], "--export") && argc >= 7) {
+		exit_code = run_export_command(argc, argv);
+	}
+	else if (!strcmp(argv[1], "--benchmark") && argc >= 5) {
+		exit_code = run_benchmark_command(argc, argv);
+	}
+	else if (!strcmp(argv[1], "--benchmark-layout") && argc >= 5) {
+		exit_code = run_layout_benchmark_command(argc, argv);
+	}
+	else if (!strcmp(argv[1], "--benchmark-batch") && argc >= 4) {
+		exit_code = run_batch_benchmark_command(argc, argv);
+	}
+	else if (!strcmp(argv[1], "--generate") && argc >= 6) {
+		exit_code = run_generate_command(argc, argv);
+	}
+	else if (!strcmp(argv[1], "--benchmark-suite") && argc >= 3) {
+		exit_code = run_benchmark_suite_command(argc, argv);
+	}
+	else if ((!strcmp(argv[1], "--regression-gate") || !strcmp(argv[1], "--record-baseline")) && argc >= 4) {
+		exit_code = run_regression_gate_command(argc, argv);
+	}
+	else if (!strcmp(argv[1], "--fuzz") || (!strcmp(argv[1], "--write-fuzz-corpus") && argc >= 3)) {
+		exit_code = run_fuzz_command(argc, argv);
+	}
+	else if (!strcmp(argv[1], "--distance-map") && argc >= 6) {
+		exit_code = run_distance_map_command(argc, argv);
+	}
+	else {
+		printf("Usage: %s --export <image> <x> <y> <algorithm 0-%u> <output.y4m|.gif|.rgb> [pixels per frame]\n", argv[0], ALGORITHM_AMOUNT - 1);
+		printf("       %s --benchmark <image> <x> <y> [runs] [warmup runs] [warm|cold] [output.csv]\n", argv[0]);
+		printf("       %s --benchmark-layout <image> <x> <y> [runs] [warmup runs] [warm|cold] [output.csv]\n", argv[0]);
+		printf("       %s --benchmark-batch <image> <seeds> [runs] [warmup runs] [algorithm 0-%u] [seed]\n", argv[0], ALGORITHM_AMOUNT - 1);
+		printf("       %s --generate <pattern> <width> <height> <output.bmp> [seed] [parameter]\n", argv[0]);
+		printf("       %s --benchmark-suite <megapixels> [runs] [warmup runs] [warm|cold] [output.csv]\n", argv[0]);
+		printf("       %s --regression-gate|--record-baseline <baseline.json> <megapixels> [runs] [warmup runs] [report.md]\n", argv[0]);
+		printf("       %s --fuzz [iterations] [seed] [image directory]\n", argv[0]);
+		printf("       %s --write-fuzz-corpus <corpus directory> [image directory]\n", argv[0]);
+		printf("       %s --distance-map <image> <x> <y> <output.raw> [algorithm %u|%u]\n", argv[0], QUEUE_BASED_FOUR_WAY, PARALLEL_BFS_FOUR_WAY);
+		printf("Patterns:");
+		for (uint32_t i = 0; i < PATTERN_AMOUNT; i++) printf(" %s", pattern_names[i]);
+		printf("\nImage can be a file or <pattern>:<width>x<height>[:seed[:parameter]], x and y can be auto.\n");
+	}
+
+	close_hardware_counters();
+#if TRACE_TIMELINE
+	write_trace("trace.json");
+#endif
+	return exit_code;
+}
+
+/*!
+* Wczytuje obraz do trybu bez okna, bez tworzenia bitmapy i bez pamięci podręcznej.
+* Opis w postaci wzór:szerokośćxwysokość[:ziarno[:parametr]] generuje obraz zamiast wczytywać plik.
+* \param const char* path Ścieżka do obrazu albo opis generowanego obrazu.
+* \param Image* image Wczytywany obraz, piksele należy zwolnić przez stbi_image_free.
+* \param uint32_t* start_x Pozycja X punktu startowego dla auto: zaproponowana przez generator albo środek obrazu.
+* \param uint32_t* start_y Pozycja Y punktu startowego dla auto.
+* \returns true, jeśli obraz został wczytany.
+*/
+bool load_headless_image(const char* path, Image* image, uint32_t* start_x, uint32_t* start_y)
+{
+	if (strchr(path, ':') && generate_image_from_spec(path, image, start_x, start_y)) return true;
+
+	memset(image, 0, sizeof(Image));
+	image->as_array = read_image_pixels(path, &image->width, &image->height);
+	if (image->as_array == NULL) {
+		printf("error when loading %s\n", path);
+		return false;
 	}
+	image->stb_x = image->width;
+	image->stb_y = image->height;
+	image->stb_comp = 3;
+	*start_x = image->width / 2;
+	*start_y = image->height / 2;
+	return true;
 }
 
 /*!
-* Wczytuje wszystkie zdjęcia z rozszerzeniem .bmp z folderu Images. Odczytuje zawartość folderu dwa razy.
-* Pierwszy raz wyznacza ilość obrazów, drugi raz dynamicznie przydziela pamięć na ścieżki dla plików zdjęć.
+* Odczytuje współrzędną punktu startowego z argumentu.
+* \param const char* argument Liczba albo auto.
+* \param uint32_t automatic Wartość dla auto.
 */
-void get_image_names()
+uint32_t parse_start_coordinate(const char* argument, uint32_t automatic)
 {
-	const char* current_dir = al_get_current_directory();
-	strcat_s(current_dir, strlen(current_dir) + 2, "\\");
-	ALLEGRO_PATH* path = al_create_path(current_dir);
-	al_append_path_component(path, "Images");
-	puts(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
-
-	ALLEGRO_FS_ENTRY* images_directory = al_create_fs_entry(al_path_cstr(path, ALLEGRO_NATIVE_PATH_SEP));
-	al_open_directory(images_directory);
-
-	uint32_t image_amount = 0;
-	ALLEGRO_FS_ENTRY* image = NULL;
-	while (true)
-	{
-		image = al_read_directory(images_directory);
-		if (!image)
-		{
+	return strcmp(argument, "auto") ? (uint32_t)strtoul(argument, NULL, 10) : automatic;
+}
+
+/*!
+* Polecenie --export, zapisuje animację wypełniania obrazu.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_export_command(int argc, char** argv)
+{
+	Image image;
+	uint32_t start_x, start_y;
+	if (!load_headless_image(argv[2], &image, &start_x, &start_y)) return EXIT_FAILURE;
+
+	algorithm_t algorithm = (algorithm_t)strtoul(argv[5], NULL, 10);
+	uint64_t pixels_per_frame = argc >= 8 ? strtoull(argv[7], NULL, 10) : ANIMATION_DEFAULT_PIXELS_PER_FRAME;
+	bool exported = algorithm < ALGORITHM_AMOUNT && export_fill_animation(
+		argv[6], &image, algorithm, parse_start_coordinate(argv[3], start_x), parse_start_coordinate(argv[4], start_y), pixels_per_frame
+	);
+	stbi_image_free(image.as_array);
+	return exported ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+* Polecenie --benchmark, mierzy wszystkie algorytmy na obrazie od podanego punktu i wypisuje statystyki.
+* Jeśli podano plik CSV, dopisuje do niego wyniki, a do nowego pliku najpierw nagłówek.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_benchmark_command(int argc, char** argv)
+{
+	Image image;
+	uint32_t start_x, start_y;
+	if (!load_headless_image(argv[2], &image, &start_x, &start_y)) return EXIT_FAILURE;
+
+	uint32_t x = parse_start_coordinate(argv[3], start_x);
+	uint32_t y = parse_start_coordinate(argv[4], start_y);
+	BenchmarkOptions options = {
+		.runs = argc >= 6 ? (uint32_t)strtoul(argv[5], NULL, 10) : BENCHMARK_DEFAULT_RUNS,
+		.warmup_runs = argc >= 7 ? (uint32_t)strtoul(argv[6], NULL, 10) : BENCHMARK_DEFAULT_WARMUP_RUNS,
+		.cold_cache = argc >= 8 && !strcmp(argv[7], "cold")
+	};
+
+	FILE* csv = NULL;
+	if (argc >= 9) {
+		csv = fopen(argv[8], "a");
+		if (csv == NULL) printf("error when opening %s\n", argv[8]);
+		else if (fseek(csv, 0, SEEK_END) == 0 && ftell(csv) == 0) write_benchmark_csv_header(csv);
+	}
+
+	bool measured = true;
+	for (uint32_t algorithm = 0; algorithm < ALGORITHM_AMOUNT; algorithm++) {
+		BenchmarkResult result;
+		if (!run_benchmark(&image, algorithm, x, y, &options, &result)) {
+			measured = false;
 			break;
 		}
+		print_benchmark_result(argv[2], &result);
+		if (csv) write_benchmark_csv(csv, argv[2], &result);
+	}
 
-		uint32_t fs_flags = al_get_fs_entry_mode(image);
-		if (fs_flags & ALLEGRO_FILEMODE_ISFILE)
-		{
-			image_amount++;
-		}
+	if (csv) fclose(csv);
+	stbi_image_free(image.as_array);
+	return measured ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
+/*!
+* Polecenie --benchmark-layout, mierzy wszystkie algorytmy na obrazie w układzie wierszy, a potem w kafelkach IMAGE_LAYOUT_TILED,
+* i wypisuje, ile razy kafelki są szybsze. Obraz jest zamieniany na kafelki raz, poza mierzonym czasem.
+* Argumenty takie jak w --benchmark, w pliku CSV wyniki z kafelków mają nazwę obrazu z dopiskiem tiles i bokiem kafelka.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_layout_benchmark_command(int argc, char** argv)
+{
+	Image image;
+	uint32_t start_x, start_y;
+	if (!load_headless_image(argv[2], &image, &start_x, &start_y)) return EXIT_FAILURE;
+
+	uint32_t x = parse_start_coordinate(argv[3], start_x);
+	uint32_t y = parse_start_coordinate(argv[4], start_y);
+	BenchmarkOptions options = {
+		.runs = argc >= 6 ? (uint32_t)strtoul(argv[5], NULL, 10) : BENCHMARK_DEFAULT_RUNS,
+		.warmup_runs = argc >= 7 ? (uint32_t)strtoul(argv[6], NULL, 10) : BENCHMARK_DEFAULT_WARMUP_RUNS,
+		.cold_cache = argc >= 8 && !strcmp(argv[7], "cold")
+	};
+
+	FILE* csv = NULL;
+	if (argc >= 9) {
+		csv = fopen(argv[8], "a");
+		if (csv == NULL) printf("error when opening %s\n", argv[8]);
+		else if (fseek(csv, 0, SEEK_END) == 0 && ftell(csv) == 0) write_benchmark_csv_header(csv);
 	}
 
-	ALLEGRO_PATH* result_image_path = path;
-	al_append_path_component(result_image_path, "Result.bmp");
-	if (al_filename_exists(al_path_cstr(result_image_path, ALLEGRO_NATIVE_PATH_SEP)))
-	{
-		image_amount--;
+	char tiled_name[512];
+	snprintf(tiled_name, sizeof(tiled_name), "%s tiles %ux%u", argv[2], 1u << IMAGE_TILE_SHIFT, 1u << IMAGE_TILE_SHIFT);
+
+	BenchmarkResult* row_major_results = malloc(sizeof(BenchmarkResult) * ALGORITHM_AMOUNT);
+	BenchmarkResult* tiled_results = malloc(sizeof(BenchmarkResult) * ALGORITHM_AMOUNT);
+	bool measured = row_major_results && tiled_results;
+
+	for (uint32_t algorithm = 0; algorithm < ALGORITHM_AMOUNT && measured; algorithm++) {
+		measured = run_benchmark(&image, algorithm, x, y, &options, &row_major_results[algorithm]);
+		if (!measured) break;
+		print_benchmark_result(argv[2], &row_major_results[algorithm]);
+		if (csv) write_benchmark_csv(csv, argv[2], &row_major_results[algorithm]);
 	}
 
-	al_close_directory(images_directory);
-	image_names = malloc(sizeof(ALLEGRO_USTR*) * image_amount);
-	al_open_directory(images_directory);
+	if (measured && !convert_image_layout(&image, IMAGE_LAYOUT_TILED)) {
+		printf("error when converting %s to tiles\n", argv[2]);
+		measured = false;
+	}
 
-	for (uint32_t i = 0; i < image_amount; i++)
-	{
-		image = al_read_directory(images_directory);
-		if (
-			!strcmp(al_get_path_filename(al_create_path(al_get_fs_entry_name(image))), "Result.bmp")) {
-			i--;
-			continue;
+	for (uint32_t algorithm = 0; algorithm < ALGORITHM_AMOUNT && measured; algorithm++) {
+		measured = run_benchmark(&image, algorithm, x, y, &options, &tiled_results[algorithm]);
+		if (!measured) break;
+		print_benchmark_result(tiled_name, &tiled_results[algorithm]);
+		if (csv) write_benchmark_csv(csv, tiled_name, &tiled_results[algorithm]);
+	}
+
+	//! Podsumowanie: przyspieszenie mediany czasu; różna ilość wypełnionych pikseli oznaczałaby błąd w akcesorach pikseli.
+	for (uint32_t algorithm = 0; algorithm < ALGORITHM_AMOUNT && measured; algorithm++) {
+		const BenchmarkResult* row_major = &row_major_results[algorithm];
+		const BenchmarkResult* tiled = &tiled_results[algorithm];
+		printf(
+			"%s: rows %.3f ms, tiles %.3f ms, %.2fx%s\n",
+			algorithm_names[algorithm],
+			row_major->median,
+			tiled->median,
+			tiled->median > 0 ? row_major->median / tiled->median : 0.0,
+			row_major->filled_pixels == tiled->filled_pixels ? "" : ", FILLED PIXELS DIFFER"
+		);
+		if (row_major->filled_pixels != tiled->filled_pixels) measured = false;
+	}
+
+	if (csv) fclose(csv);
+	free(row_major_results);
+	free(tiled_results);
+	stbi_image_free(image.as_array);
+	return measured ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+* Polecenie --benchmark-batch, mierzy wypełnianie obszarów losowych punktów startowych w losowych kolorach
+* jednym wywołaniem flood_fill_batch i osobnym flood_fill dla każdego punktu, domyślnie algorytmem SCANLINE_RECURSIVE.
+* Wypisuje oba wyniki i przyspieszenie wsadu. Punkty są losowane z podanego ziarna, domyślnie GENERATOR_DEFAULT_SEED.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_batch_benchmark_command(int argc, char** argv)
+{
+	Image image;
+	uint32_t start_x, start_y;
+	if (!load_headless_image(argv[2], &image, &start_x, &start_y)) return EXIT_FAILURE;
+
+	uint32_t seed_amount = (uint32_t)strtoul(argv[3], NULL, 10);
+	BenchmarkOptions options = {
+		.runs = argc >= 5 ? (uint32_t)strtoul(argv[4], NULL, 10) : BENCHMARK_DEFAULT_RUNS,
+		.warmup_runs = argc >= 6 ? (uint32_t)strtoul(argv[5], NULL, 10) : BENCHMARK_DEFAULT_WARMUP_RUNS,
+		.cold_cache = false
+	};
+	algorithm_t algorithm = argc >= 7 ? (algorithm_t)strtoul(argv[6], NULL, 10) : SCANLINE_RECURSIVE;
+	uint64_t random_state = argc >= 8 ? strtoull(argv[7], NULL, 10) : GENERATOR_DEFAULT_SEED;
+
+	Seed_t* seeds = seed_amount > 0 && algorithm < ALGORITHM_AMOUNT ? malloc(sizeof(Seed_t) * seed_amount) : NULL;
+	if (seeds == NULL) {
+		stbi_image_free(image.as_array);
+		return EXIT_FAILURE;
+	}
+	for (uint32_t i = 0; i < seed_amount; i++) {
+		uint64_t random = next_random(&random_state);
+		seeds[i].x = (uint32_t)(next_random(&random_state) % image.width);
+		seeds[i].y = (uint32_t)(next_random(&random_state) % image.height);
+		seeds[i].color = (Color_t){ (uint8_t)random, (uint8_t)(random >> 8), (uint8_t)(random >> 16) };
+	}
+
+	BenchmarkResult batch_result;
+	BenchmarkResult separate_result;
+	bool measured = run_batch_benchmark(&image, seeds, seed_amount, algorithm, &options, &batch_result, &separate_result);
+	if (measured) {
+		printf(
+			"%s, %u seeds: flood_fill_batch median %.3f ms (min %.3f ms, %u runs, %llu px), %u x flood_fill %s median %.3f ms (min %.3f ms, %u runs, %llu px), batch %.2fx\n",
+			argv[2],
+			seed_amount,
+			batch_result.median,
+			batch_result.min,
+			batch_result.runs,
+			(unsigned long long)batch_result.filled_pixels,
+			seed_amount,
+			algorithm_names[algorithm],
+			separate_result.median,
+			separate_result.min,
+			separate_result.runs,
+			(unsigned long long)separate_result.filled_pixels,
+			batch_result.median > 0 ? separate_result.median / batch_result.median : 0.0
+		);
+	}
+
+	free(seeds);
+	stbi_image_free(image.as_array);
+	return measured ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+* Polecenie --generate, zapisuje wygenerowany obraz testowy do pliku BMP i wypisuje proponowany punkt startowy.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_generate_command(int argc, char** argv)
+{
+	pattern_t pattern;
+	if (!parse_pattern(argv[2], &pattern)) {
+		printf("unknown pattern %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	Image image;
+	uint32_t seed_x, seed_y;
+	uint64_t seed = argc >= 7 ? strtoull(argv[6], NULL, 10) : GENERATOR_DEFAULT_SEED;
+	uint32_t parameter = argc >= 8 ? (uint32_t)strtoul(argv[7], NULL, 10) : 0;
+	if (!generate_image(pattern, (uint32_t)strtoul(argv[3], NULL, 10), (uint32_t)strtoul(argv[4], NULL, 10), seed, parameter, &image, &seed_x, &seed_y)) {
+		printf("error when generating %s\n", argv[2]);
+		return EXIT_FAILURE;
+	}
+
+	bool saved = encode_bmp(argv[5], image.as_array, image.width, image.height);
+	if (saved) printf("%s: %ux%u, start %u %u\n", argv[5], image.width, image.height, seed_x, seed_y);
+	else printf("error when saving %s\n", argv[5]);
+	free(image.as_array);
+	return saved ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+* Wypisuje wynik pomiaru z --benchmark-suite i dopisuje go do pliku CSV.
+* \param const char* image_name Opis wygenerowanego obrazu.
+* \param const BenchmarkResult* result Wyniki pomiaru.
+* \param void* csv Plik CSV albo NULL.
+*/
+void print_suite_result(const char* image_name, const BenchmarkResult* result, void* csv)
+{
+	print_benchmark_result(image_name, result);
+	if (csv) write_benchmark_csv(csv, image_name, result);
+}
+
+/*!
+* Polecenie --benchmark-suite, mierzy wszystkie algorytmy na wszystkich wzorach, patrz run_benchmark_suite.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_benchmark_suite_command(int argc, char** argv)
+{
+	BenchmarkOptions options = {
+		.runs = argc >= 4 ? (uint32_t)strtoul(argv[3], NULL, 10) : BENCHMARK_DEFAULT_RUNS,
+		.warmup_runs = argc >= 5 ? (uint32_t)strtoul(argv[4], NULL, 10) : BENCHMARK_DEFAULT_WARMUP_RUNS,
+		.cold_cache = argc >= 6 && !strcmp(argv[5], "cold")
+	};
+
+	FILE* csv = NULL;
+	if (argc >= 7) {
+		csv = fopen(argv[6], "a");
+		if (csv == NULL) printf("error when opening %s\n", argv[6]);
+		else if (fseek(csv, 0, SEEK_END) == 0 && ftell(csv) == 0) write_benchmark_csv_header(csv);
+	}
+
+	bool measured = run_benchmark_suite(strtod(argv[2], NULL), &options, print_suite_result, csv);
+
+	if (csv) fclose(csv);
+	return measured ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*!
+* Wypisuje wynik pomiaru i dodaje go do BenchmarkEntries.
+* \param const char* image_name Opis wygenerowanego obrazu.
+* \param const BenchmarkResult* result Wyniki pomiaru.
+* \param void* entries Uzupełniane BenchmarkEntries.
+*/
+void print_and_collect_result(const char* image_name, const BenchmarkResult* result, void* entries)
+{
+	print_benchmark_result(image_name, result);
+	collect_benchmark_entry(image_name, result, entries);
+}
+
+/*!
+* Polecenia --regression-gate i --record-baseline. Oba mierzą algorytmy tak jak --benchmark-suite, z ciepłą pamięcią podręczną.
+* --record-baseline zapisuje wyniki jako punkt odniesienia. Tylko ono tworzy plik punktu odniesienia.
+* --regression-gate porównuje wyniki z punktem odniesienia i wypisuje tabelę różnic w formacie Markdown, także do pliku raportu, jeśli go podano.
+* Brakujący, nieczytelny albo pusty punkt odniesienia jest błędem, tak samo jak brak pamięci na wyniki pomiarów.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns EXIT_FAILURE przy regresji albo błędzie, inaczej EXIT_SUCCESS.
+*/
+int run_regression_gate_command(int argc, char** argv)
+{
+	BenchmarkOptions options = {
+		.runs = argc >= 5 ? (uint32_t)strtoul(argv[4], NULL, 10) : BENCHMARK_DEFAULT_RUNS,
+		.warmup_runs = argc >= 6 ? (uint32_t)strtoul(argv[5], NULL, 10) : BENCHMARK_DEFAULT_WARMUP_RUNS,
+		.cold_cache = false
+	};
+
+	BenchmarkEntries baseline = { 0 };
+	bool recording = !strcmp(argv[1], "--record-baseline");
+	if (!recording && !read_baseline(argv[2], &baseline)) {
+		printf("error when reading baseline %s: missing, unreadable or without results, record one with --record-baseline\n", argv[2]);
+		free_benchmark_entries(&baseline);
+		return EXIT_FAILURE;
+	}
+
+	BenchmarkEntries current = { 0 };
+	bool measured = run_benchmark_suite(strtod(argv[3], NULL), &options, print_and_collect_result, &current);
+	if (current.failed) printf("error when collecting benchmark results: out of memory\n");
+	if (!measured || current.failed) {
+		free_benchmark_entries(&baseline);
+		free_benchmark_entries(&current);
+		return EXIT_FAILURE;
+	}
+
+	int exit_code = EXIT_SUCCESS;
+	if (recording) {
+		if (write_baseline(argv[2], &current)) printf("baseline written to %s\n", argv[2]);
+		else {
+			printf("error when writing %s\n", argv[2]);
+			exit_code = EXIT_FAILURE;
+		}
+	}
+	else {
+		printf("\n");
+		if (compare_with_baseline(&baseline, &current, stdout) > 0) exit_code = EXIT_FAILURE;
+		if (argc >= 7) {
+			FILE* report = fopen(argv[6], "w");
+			if (report == NULL) printf("error when opening %s\n", argv[6]);
+			else {
+				compare_with_baseline(&baseline, &current, report);
+				fclose(report);
+			}
 		}
+		free_benchmark_entries(&baseline);
+	}
 
-		if (strcmp(al_get_path_extension(al_create_path(al_get_fs_entry_name(image))), ".bmp"))
-		{
-			image_amount--;
-			i--;
-			continue;
+	free_benchmark_entries(&current);
+	return exit_code;
+}
+
+/*!
+* Polecenia --fuzz i --write-fuzz-corpus. Domyślnie --fuzz sprawdza obrazy z folderu Images i 10000 losowych obrazów.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns EXIT_FAILURE, jeśli któryś algorytm nie zgadza się z wzorcowym, inaczej EXIT_SUCCESS.
+*/
+int run_fuzz_command(int argc, char** argv)
+{
+	if (!strcmp(argv[1], "--write-fuzz-corpus")) {
+		return write_fuzz_corpus(argc >= 4 ? argv[3] : "Images", argv[2]) > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+	}
+
+	uint32_t iterations = argc >= 3 ? (uint32_t)strtoul(argv[2], NULL, 10) : 10000;
+	uint64_t seed = argc >= 4 ? strtoull(argv[3], NULL, 10) : GENERATOR_DEFAULT_SEED;
+	uint32_t mismatches = fuzz_directory(argc >= 5 ? argv[4] : "Images", seed);
+	mismatches += fuzz_random_images(iterations, seed);
+	return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*!
+* Polecenie --distance-map, wypełnia obraz algorytmem BFS (domyślnie QUEUE_BASED_FOUR_WAY) z zapisem mapy odległości
+* i zapisuje ją do pliku: wiersz po wierszu, DISTANCE_MAP_BITS bitów na piksel w kolejności bajtów procesora,
+* DISTANCE_UNREACHED dla pikseli poza obszarem. Na konsolę wypisuje najdalszy piksel obszaru, a po równoległym BFS histogram jego poziomów.
+* \param int argc Ilość argumentów.
+* \param char** argv Argumenty programu.
+* \returns Kod wyjścia programu.
+*/
+int run_distance_map_command(int argc, char** argv)
+{
+	Image image;
+	uint32_t start_x, start_y;
+	if (!load_headless_image(argv[2], &image, &start_x, &start_y)) return EXIT_FAILURE;
+
+	uint32_t x = parse_start_coordinate(argv[3], start_x);
+	uint32_t y = parse_start_coordinate(argv[4], start_y);
+	algorithm_t algorithm = argc >= 7 ? (algorithm_t)strtoul(argv[6], NULL, 10) : QUEUE_BASED_FOUR_WAY;
+	if ((algorithm != QUEUE_BASED_FOUR_WAY && algorithm != PARALLEL_BFS_FOUR_WAY) || x >= image.width || y >= image.height) {
+		printf("distance map needs a start point inside the image and algorithm %u or %u\n", QUEUE_BASED_FOUR_WAY, PARALLEL_BFS_FOUR_WAY);
+		stbi_image_free(image.as_array);
+		return EXIT_FAILURE;
+	}
+
+	Color_t current_color = { 0 };
+	get_pixel_color(&current_color, x, y, &image);
+	set_distance_map_enabled(true);
+	flood_fill(algorithm, x, y, &image, current_color);
+	//! Po równoległym BFS wypisujemy też histogram poziomów, skrócony do co najwyżej 8 przedziałów ze średnią ilością pikseli na poziom.
+	uint64_t level_amount = 0;
+	const uint64_t* histogram = bfs_frontier_histogram(&level_amount);
+	if (level_amount > 0) {
+		uint64_t bucket_amount = level_amount < 8 ? level_amount : 8;
+		printf("Levels:");
+		for (uint64_t bucket = 0; bucket < bucket_amount; bucket++) {
+			uint64_t first = level_amount * bucket / bucket_amount;
+			uint64_t last = level_amount * (bucket + 1) / bucket_amount;
+			uint64_t pixels = 0;
+			for (uint64_t level = first; level < last; level++) pixels += histogram[level];
+			printf(" %llu-%llu: %.1f", first, last - 1, (double)pixels / (last - first));
 		}
-		const char* image_path = al_get_fs_entry_name(image);
-		const char* image_name = al_get_path_filename(al_create_path(image_path));
-		const char image_folder[128] = "Images/";
-		strcat_s(image_folder, strlen(image_folder) + strlen(image_name) + 1, image_name);
+		printf(" px/level\n");
+	}
 
-		image_names[i] = al_ustr_new(image_folder);
+	uint32_t width, height;
+	const distance_t* distances = last_distance_map(&width, &height);
+	bool written = false;
+	if (distances) {
+		//! Najdalszy piksel szukamy tak, jak robiłoby to osobne wyszukiwanie ścieżki.
+		uint64_t reached = 0;
+		uint64_t farthest = 0;
+		for (uint64_t i = 0; i < (uint64_t)width * height; i++) {
+			if (distances[i] == DISTANCE_UNREACHED) continue;
+			reached++;
+			if (distances[i] > distances[farthest] || distances[farthest] == DISTANCE_UNREACHED) farthest = i;
+		}
+		printf(
+			"Distance map: %ux%u, %d-bit, %llu reached pixels, farthest (%llu, %llu) at %llu steps%s\n",
+			width,
+			height,
+			DISTANCE_MAP_BITS,
+			reached,
+			farthest % width,
+			farthest / width,
+			(uint64_t)distances[farthest],
+			distances[farthest] == DISTANCE_UNREACHED - 1 ? " or more" : ""
+		);
+
+		FILE* file = fopen(argv[5], "wb");
+		if (file == NULL) printf("error when opening %s\n", argv[5]);
+		else {
+			written = fwrite(distances, sizeof(distance_t), (size_t)width * height, file) == (size_t)width * height;
+			written = fclose(file) == 0 && written;
+		}
+	}
+	else {
+		printf("not enough memory for the distance map\n");
 	}
 
-	IMAGE_AMOUNT = image_amount;
+	set_distance_map_enabled(false);
+	stbi_image_free(image.as_array);
+	return written ? EXIT_SUCCESS : EXIT_FAILURE;
+}
 
-	al_destroy_fs_entry(image);
-	al_close_directory(images_directory);
-	al_destroy_fs_entry(images_directory);
-	al_destroy_path(path);
+//! Sprawdza inicjalizacje pierwszych funkcji w init_allegro(), w przypadku błędu kończy działanie aplikacji.
+//! \param bool checked_function Sprawdzana funkcja z Allegro5.
+void check_init(bool checked_function)
+{
+	if (!checked_function)
+	{
+		printf("%s", "Error initializing function, refer to debugger.");
+		exit(EXIT_FAILURE);
+	}
 }
 
 /*!
@@ -157,7 +682,7 @@ void load_fonts() {
 }
 
 /*!
-* Sprząta po bibliotece Allegro, zwalniając czcionki, nazwy zdjęć, kolejkę zdarzeń oraz okno.
+* Sprząta po bibliotece Allegro, zwalniając czcionki, kolejkę zdarzeń oraz okno. Nazwy zdjęć zwalnia destroy_image_index().
 * \param ALLEGRO_EVENT_QUEUE** queue Zwalniana kolejka zdarzeń.
 * \param ALLEGRO_DISPLAY** display Zwalniane okno.
 */
@@ -168,9 +693,6 @@ void clean_up_allegro(ALLEGRO_EVENT_QUEUE** queue, ALLEGRO_DISPLAY** display)
 
 	al_destroy_event_queue(*queue);
 	al_destroy_display(*display);
-	for (uint32_t i = 0; i < IMAGE_AMOUNT; i++) {
-		al_ustr_free(image_names[i]);
-	}
 }
 
 /*!
@@ -186,6 +708,16 @@ void quantize_mouse_position(uint32_t image_width, uint32_t* mouse_x, uint32_t*
 	*mouse_y /= (float)window_height / image_width;
 }
 
+/*!
+* Zgłasza do wczytania w tle poprzedni i następny obraz z image_names, żeby zmiana zdjęcia nie czekała na dekodowanie.
+* Następny obraz zgłaszany jest jako ostatni, więc zostanie wczytany jako pierwszy.
+*/
+void prefetch_neighbour_images() {
+	if (IMAGE_AMOUNT < 2) return;
+	prefetch_image(al_cstr(image_names[(current_image + IMAGE_AMOUNT - 1) % IMAGE_AMOUNT]));
+	prefetch_image(al_cstr(image_names[(current_image + 1) % IMAGE_AMOUNT]));
+}
+
 /*!
 * Zwraca true, jeśli uzytkownik kliknął na obraz.
 * Obliczenia wykonuje na podstawie pozycji wskażnika, wymiarów obrazu oraz współczynnika skalowania obrazu.
@@ -239,8 +771,11 @@ void init_allegro(ALLEGRO_EVENT_QUEUE** queue, ALLEGRO_DISPLAY** display)
 /*!
 * Główna pętla odpowiadająca za wyświetlenie obrazu, odczytywania kliknięcia myszy, oraz naciśnięcia klawiatury.
 * Spacja:	zmiana trybu wyświetlania
-* Tab:		zmiana zdjęcia
-* R:		reset zdjęcia
+* Tab:		zmiana zdjęcia, nieaktywna przy pustym folderze
+* R:		reset zdjęcia, nieaktywny przy pustym folderze
+* L:		wypełnienie wszystkich obszarów zdjęcia różnymi kolorami
+* S:		zapis obecnego stanu zdjęcia do Checkpoint.qoi
+* H:		nakładka z mapą cieplną odczytów pikseli przez ostatnie wypełnianie, gdy MEASURE_VISIT_HEATMAP jest różne od 0
 * Strzałki: zmiana algorytmu
 * \param ALLEGRO_EVENT_QUEUE* queue Kolejka zdarzeń.
 * \param ALLEGRO_DISPLAY* display Okno.
@@ -251,6 +786,7 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 
 	//! Początkowe wczytanie pierwszego obrazu
 	load_image(&image, image_names[current_image]);
+	prefetch_neighbour_images();
 
 	bool show_measure_result = false;
 
@@ -261,26 +797,51 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 
 	bool break_loop = false;
 
+	//! Co sekundę sprawdzamy, czy w folderze z obrazami pojawiły się nowe pliki
+	ALLEGRO_TIMER* index_timer = al_create_timer(1.0);
+	al_register_event_source(queue, al_get_timer_event_source(index_timer));
+	al_start_timer(index_timer);
+
+#if TRACE_TIMELINE
+	//! Początek obsługi ostatniego kliknięcia, odcinek "click" kończy się po wyświetleniu jego wyniku
+	double click_start = -1;
+#endif
+
 	while (!break_loop)
 	{
 		al_clear_to_color(al_map_rgb(0, 0, 0));
 		//! Wyświetlenie obrazu skalowanego tak, żeby wypełniał odpowiednio duzy obszar
-		al_draw_scaled_bitmap(
-			image.image,
-			0,
-			0,
-			image.width,
-			image.height,
-			0,
-			0,
-			image.width * image.scale,
-			image.height * image.scale,
-			0
-		);
+		TRACE_BEGIN(draw_span);
+		//! Bitmapy nie ma, jeśli żadnego obrazu nie udało się jeszcze wczytać
+		if (image.image) {
+			al_draw_scaled_bitmap(
+				image.image,
+				0,
+				0,
+				image.width,
+				image.height,
+				0,
+				0,
+				image.width * image.scale,
+				image.height * image.scale,
+				0
+			);
+		}
+		//! Mapa cieplna odczytów ostatniego wypełniania, półprzezroczysta, nad obrazem
+		if (show_measure_result) draw_visit_heatmap(&image);
+		TRACE_END(draw_span, "al_draw_scaled_bitmap");
 
 		//! Wyświetlenie prawego panelu
+		TRACE_BEGIN(panel_span);
 		show_right_panel(current_algorithm, show_measure_result);
+		TRACE_END(panel_span, "show_right_panel");
 		al_flip_display();
+#if TRACE_TIMELINE
+		if (click_start >= 0) {
+			record_trace_span("click", click_start);
+			click_start = -1;
+		}
+#endif
 
 
 
@@ -295,6 +856,9 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 
 				//! Został naciśnięty lewy przycisk myszy
 			case 1:
+#if TRACE_TIMELINE
+				click_start = trace_now();
+#endif
 
 				//! Wczytujemy niezmieniona pozycje kursora wzgledem okna.
 				al_get_mouse_state(&mouse_state);
@@ -302,6 +866,9 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 				//! Ignorujemy, jeśli nie kliknęliśmy na obraz.
 				if (!check_if_clicked_on_image(mouse_state, image)) continue;
 
+				//! Tryb wizualizacji sam zapisuje i wczytuje Result.bmp, więc najpierw czekamy na zapis poprzedniego wyniku.
+				if (visualisation_mode) flush_result_writer();
+
 				// Jeśli kliknięte na obraz, rozpoczynamy wypełnianie.
 				fill_with_color(&image, current_algorithm, mouse_state.x, mouse_state.y);
 
@@ -310,11 +877,14 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 				* konieczne jest poczekanie po ostatnim wykonaniu funkcji wypełniania.
 				*/
 				if (visualisation_mode) al_rest(0.1);
-				//! Po wypełnianiu zdjęcie zapisujemy na dysku.
-				save_image_to_bmp("Images/Result.bmp", image.as_array, image.stb_x, image.stb_y, image.stb_comp);
+				//! Po wypełnianiu zdjęcie zapisujemy na dysku w tle, kolejne kliknięcia nie czekają na zapis.
+				queue_result_write("Images/Result.bmp", &image);
 
-				//! Zapisane zdjęcie ponownie wczytujemy do wyświetlenia.
-				load_image(&image, al_ustr_new("Images/Result.bmp")); // wczytujemy od nowa
+				//! Bitmapę do wyświetlenia odświeżamy z tablicy pikseli, bez ponownego wczytywania zapisanego pliku.
+				TRACE_BEGIN(bitmap_span);
+				update_image_bitmap(&image);
+				update_visit_heatmap_bitmap(&image);
+				TRACE_END(bitmap_span, "update_image_bitmap");
 
 				//! Po udanym wypełnieniu prawy panel ma wyświetlić wyniki
 				show_measure_result = true;
@@ -346,14 +916,45 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 
 				//! W przypadku klawisza TAB zmieniamy zdjęcie
 			case ALLEGRO_KEY_TAB:
+				if (IMAGE_AMOUNT == 0) break;
 				show_measure_result = false;
 				current_image = (current_image + 1) % IMAGE_AMOUNT;
 				load_image(&image, image_names[current_image]);
+				prefetch_neighbour_images();
+				break;
+
+				//! W przypadku klawisza L wypełniamy wszystkie obszary zdjęcia, zapisujemy je i odświeżamy bitmapę
+			case ALLEGRO_KEY_L:
+				if (image.as_array == NULL) break;
+				recolor_all_regions(&image);
+				clear_visit_heatmap();
+				queue_result_write("Images/Result.bmp", &image);
+				update_image_bitmap(&image);
+				show_measure_result = true;
+				break;
+
+				//! W przypadku klawisza H włączamy albo wyłączamy mapę cieplną, liczniki zbierane są od następnego wypełniania
+			case ALLEGRO_KEY_H:
+#if MEASURE_VISIT_HEATMAP
+				set_visit_heatmap_enabled(!visit_heatmap_enabled());
+				printf("Heatmap: %s\n", visit_heatmap_enabled() ? "on, fill to record visits" : "off");
+#else
+				printf("Heatmap: unavailable, build with MEASURE_VISIT_HEATMAP 1\n");
+#endif
+				break;
+
+				//! W przypadku klawisza S zapisujemy obecny stan zdjęcia w szybkim, bezstratnym formacie QOI
+			case ALLEGRO_KEY_S:
+				if (image.as_array == NULL) break;
+				queue_result_write("Checkpoint.qoi", &image);
 				break;
 
 				//! W przypadku klawisza R odświeżamy zdjęcie(ponownie wczytujemy z dysku)
 			case ALLEGRO_KEY_R:
+				if (IMAGE_AMOUNT == 0) break;
 				show_measure_result = false;
+				//! Plik mógł się zmienić na dysku, więc pomijamy zdekodowaną wcześniej kopię z pamięci podręcznej.
+				forget_cached_image(al_cstr(image_names[current_image]));
 				load_image(&image, image_names[current_image]);
 				break;
 
@@ -377,6 +978,35 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 			break;
 
 
+			//! Przy zmianach w folderze odświeżamy indeks obrazów, obecny obraz odszukujemy po nazwie
+		case ALLEGRO_EVENT_TIMER:
+			if (image_index_changed()) {
+				ALLEGRO_USTR* current_name = IMAGE_AMOUNT > 0 ? al_ustr_dup(image_names[current_image]) : NULL;
+				if (refresh_image_index()) {
+					uint32_t found_image = IMAGE_AMOUNT;
+					for (uint32_t i = 0; current_name && i < IMAGE_AMOUNT; i++) {
+						if (al_ustr_equal(image_names[i], current_name)) found_image = i;
+					}
+					//! Jeśli folder jest pusty, obraz zostaje na ekranie, ale jego nazwa została zwolniona, a TAB i R nic nie robią
+					if (IMAGE_AMOUNT == 0) {
+						current_image = 0;
+						image.path = NULL;
+					}
+					//! Jeśli obecny obraz zniknął, wczytujemy obraz, który zajął jego miejsce
+					else if (found_image == IMAGE_AMOUNT) {
+						current_image = current_image < IMAGE_AMOUNT ? current_image : IMAGE_AMOUNT - 1;
+						show_measure_result = false;
+						load_image(&image, image_names[current_image]);
+					}
+					else {
+						current_image = found_image;
+					}
+					prefetch_neighbour_images();
+				}
+				if (current_name) al_ustr_free(current_name);
+			}
+			break;
+
 			//! W przypadku wyłączenia okna  pętla zostaje przerwana, a instrukcje w funkcji main() poprawnie zakończą działanie aplikacji
 		case ALLEGRO_EVENT_DISPLAY_CLOSE:
 			break_loop = true;
@@ -385,6 +1015,8 @@ void main_loop(ALLEGRO_EVENT_QUEUE* queue, ALLEGRO_DISPLAY* display)
 	}
 
 	//! W przypadku przerwania pętli usuwamy zdjęcia z pamięci przed zakończeniem działania aplikacji
+	al_destroy_timer(index_timer);
+	destroy_visit_heatmap();
 	clean_up_image(&image);
 }
 
@@ -406,6 +1038,8 @@ void fill_with_color(Image* image, algorithm_t algorithm, uint32_t mouse_x, uint
 	measure_values.duration = 0;
 	measure_values.current_stack_height = 0;
 	measure_values.max_stack_height = 0;
+	measure_values.region_count = 0;
+	measure_values.megapixels_per_second = 0;
 
 	//! Zmieniamy pozycje kursora wzgledem okna na koordynaty obrazu.
 	quantize_mouse_position(image->width, &mouse_x, &mouse_y);
@@ -421,6 +1055,8 @@ void fill_with_color(Image* image, algorithm_t algorithm, uint32_t mouse_x, uint
 	//! Zapamiętujemy stan czasu i cykli zegara po zakończeniu algorytmu wypełniania
 	uint64_t clock_end = __rdtsc();
 	clock_t time_end = clock();
+	//! Obwód obszaru liczymy już poza mierzonym czasem
+	finish_region_stats(image);
 
 	//! W trybie wizualizacji liczenie czasu i cykli zegara pomijamy
 	if (visualisation_mode) return;
@@ -429,3 +1065,25 @@ void fill_with_color(Image* image, algorithm_t algorithm, uint32_t mouse_x, uint
 	measure_values.duration = time_end - time_start;
 	measure_values.clock_cycle_count = clock_end - clock_start;
 }
+
+
+/*!
+* Wypełnia wszystkie obszary obrazu różnymi kolorami w jednym przebiegu etykietowania.
+* Ustawia w strukturze MeasureValues ilość obszarów, czas działania, ilość cykli zegara oraz przepustowość w megapikselach na sekundę.
+* \param Image* image Wypełniany obraz.
+*/
+void recolor_all_regions(Image* image) {
+	memset(&measure_values, 0, sizeof(measure_values));
+
+	double time_start = al_get_time();
+	uint64_t clock_start = __rdtsc();
+	measure_values.region_count = fill_all_regions(image, NULL, 0, NULL);
+	uint64_t clock_end = __rdtsc();
+	double time_end = al_get_time();
+
+	measure_values.duration = (time_end - time_start) * 1000;
+	measure_values.clock_cycle_count = clock_end - clock_start;
+	if (time_end > time_start) {
+		measure_values.megapixels_per_second = (double)image->width * image->height / (time_end - time_start) / 1000000.0;
+	}
+}
\ No newline at end of file
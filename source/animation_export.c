@@ -0,0 +1,417 @@
+//! \file animation_export.c Zapisywanie animacji wypełniania do pliku Y4M, GIF albo surowych klatek RGB, bez okna i bez zapisu Result.bmp po każdym kroku.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "animation_export.h"
+#include "fill_algorithms.h"
+#include "image_management.h"
+#include "values.h"
+
+//! Ilość klatek, które mogą czekać na zakodowanie. Gdy wszystkie są zajęte, wypełnianie czeka na wątek kodujący.
+#define ANIMATION_FRAME_BUFFERS 4
+//! Ilość klatek na sekundę zapisywana w nagłówku Y4M i opóźnieniu klatek GIF.
+#define ANIMATION_FRAME_RATE 25
+
+//! Rozmiar tablicy mieszającej słownika LZW, potęga dwójki większa od 4096 kodów.
+#define GIF_HASH_SIZE 8192
+#define GIF_CLEAR_CODE 256
+#define GIF_END_CODE 257
+#define GIF_MAX_CODES 4096
+//! Indeks palety GIF zarezerwowany dla koloru wypełnienia, pierwsze 216 to sześcian 6x6x6.
+#define GIF_REPLACEMENT_INDEX 216
+
+typedef enum animation_format_t {
+	ANIMATION_Y4M,
+	ANIMATION_GIF,
+	ANIMATION_RAW
+} animation_format_t;
+
+//! Stan kodera LZW dla jednej klatki GIF.
+typedef struct GifEncoder {
+	int32_t hash_keys[GIF_HASH_SIZE]; //! prefiks << 8 | bajt, powiększone o 1, zero oznacza wolne miejsce
+	uint16_t hash_codes[GIF_HASH_SIZE];
+	uint32_t bits;
+	uint32_t bit_count;
+	uint8_t block[255];
+	uint32_t block_size;
+} GifEncoder;
+
+//! Stan eksportu animacji. Pierścień klatek jest chroniony przez mutex.
+typedef struct AnimationExport {
+	FILE* file;
+	animation_format_t format;
+	uint32_t width;
+	uint32_t height;
+	uint64_t pixels_per_frame;
+	uint64_t pixels_since_frame;
+
+	uint8_t* frames[ANIMATION_FRAME_BUFFERS];
+	uint32_t first_frame;
+	uint32_t frame_amount;
+	uint8_t* encode_buffer; //! płaszczyzny YUV albo indeksy palety GIF
+	GifEncoder* gif;
+	uint64_t written_frames;
+
+	ALLEGRO_MUTEX* mutex;
+	ALLEGRO_COND* changed;
+	ALLEGRO_THREAD* thread;
+	bool finished;
+} AnimationExport;
+
+static AnimationExport animation = { 0 };
+
+/*!
+* Zapisuje liczbę 16-bitową w kolejności little endian.
+* \param uint16_t value Zapisywana liczba.
+*/
+static void write_u16_to_file(uint16_t value) {
+	fputc(value & 0xFF, animation.file);
+	fputc(value >> 8, animation.file);
+}
+
+/*!
+* Zamienia klatkę RGB na trzy płaszczyzny Y, Cb, Cr (4:4:4, BT.601, ograniczony zakres) i zapisuje ją do pliku Y4M.
+* \param const uint8_t* frame Klatka RGB.
+*/
+static void write_y4m_frame(const uint8_t* frame) {
+	uint64_t pixel_amount = (uint64_t)animation.width * animation.height;
+	uint8_t* y_plane = animation.encode_buffer;
+	uint8_t* u_plane = y_plane + pixel_amount;
+	uint8_t* v_plane = u_plane + pixel_amount;
+
+	for (uint64_t i = 0; i < pixel_amount; i++) {
+		int32_t r = frame[i * 3];
+		int32_t g = frame[i * 3 + 1];
+		int32_t b = frame[i * 3 + 2];
+		y_plane[i] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+		u_plane[i] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+		v_plane[i] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+	}
+
+	fputs("FRAME\n", animation.file);
+	fwrite(animation.encode_buffer, 1, pixel_amount * 3, animation.file);
+}
+
+//! Zapisuje zebrany blok danych GIF (maksymalnie 255 bajtów) poprzedzony jego długością.
+static void gif_flush_block() {
+	if (animation.gif->block_size == 0) return;
+	fputc(animation.gif->block_size, animation.file);
+	fwrite(animation.gif->block, 1, animation.gif->block_size, animation.file);
+	animation.gif->block_size = 0;
+}
+
+/*!
+* Dopisuje kod LZW do strumienia bitów, od najmłodszego bitu.
+* \param uint32_t code Zapisywany kod.
+* \param uint32_t code_size Ilość bitów kodu.
+*/
+static void gif_put_code(uint32_t code, uint32_t code_size) {
+	GifEncoder* gif = animation.gif;
+	gif->bits |= code << gif->bit_count;
+	gif->bit_count += code_size;
+	while (gif->bit_count >= 8) {
+		gif->block[gif->block_size++] = gif->bits & 0xFF;
+		gif->bits >>= 8;
+		gif->bit_count -= 8;
+		if (gif->block_size == sizeof(gif->block)) gif_flush_block();
+	}
+}
+
+/*!
+* Zwraca miejsce w tablicy mieszającej dla klucza: miejsce z tym kluczem albo pierwsze wolne.
+* \param int32_t key Klucz prefiks << 8 | bajt, powiększony o 1.
+*/
+static uint32_t gif_find_slot(int32_t key) {
+	uint32_t slot = ((uint32_t)key * 2654435761u) >> 19;
+	while (animation.gif->hash_keys[slot] != 0 && animation.gif->hash_keys[slot] != key) {
+		slot = (slot + 1) & (GIF_HASH_SIZE - 1);
+	}
+	return slot;
+}
+
+/*!
+* Zwraca indeks palety dla koloru: kolor wypełnienia ma własny indeks, pozostałe są zaokrąglane do sześcianu 6x6x6.
+* \param const uint8_t* pixel Składowe RGB piksela.
+*/
+static uint8_t gif_palette_index(const uint8_t* pixel) {
+	if (pixel[0] == replacement_color.r && pixel[1] == replacement_color.g && pixel[2] == replacement_color.b) {
+		return GIF_REPLACEMENT_INDEX;
+	}
+	return (uint8_t)(((pixel[0] * 5 + 127) / 255) * 36 + ((pixel[1] * 5 + 127) / 255) * 6 + (pixel[2] * 5 + 127) / 255);
+}
+
+/*!
+* Koduje klatkę RGB jako obraz GIF z 8-bitowymi indeksami palety i zapisuje ją razem z opóźnieniem klatki.
+* \param const uint8_t* frame Klatka RGB.
+*/
+static void write_gif_frame(const uint8_t* frame) {
+	uint64_t pixel_amount = (uint64_t)animation.width * animation.height;
+	uint8_t* indices = animation.encode_buffer;
+	for (uint64_t i = 0; i < pixel_amount; i++) {
+		indices[i] = gif_palette_index(frame + i * 3);
+	}
+
+	//! Rozszerzenie sterujące grafiką: opóźnienie w setnych sekundy, klatka zostaje pod następną.
+	fputc(0x21, animation.file);
+	fputc(0xF9, animation.file);
+	fputc(4, animation.file);
+	fputc(0x04, animation.file);
+	write_u16_to_file(100 / ANIMATION_FRAME_RATE);
+	fputc(0, animation.file);
+	fputc(0, animation.file);
+
+	//! Opis obrazu na całą klatkę, bez lokalnej palety.
+	fputc(0x2C, animation.file);
+	write_u16_to_file(0);
+	write_u16_to_file(0);
+	write_u16_to_file((uint16_t)animation.width);
+	write_u16_to_file((uint16_t)animation.height);
+	fputc(0, animation.file);
+
+	GifEncoder* gif = animation.gif;
+	memset(gif->hash_keys, 0, sizeof(gif->hash_keys));
+	gif->bits = 0;
+	gif->bit_count = 0;
+	gif->block_size = 0;
+	uint32_t code_size = 9;
+	uint32_t next_code = GIF_END_CODE + 1;
+
+	fputc(8, animation.file);
+	gif_put_code(GIF_CLEAR_CODE, code_size);
+
+	uint32_t prefix = indices[0];
+	for (uint64_t i = 1; i < pixel_amount; i++) {
+		int32_t key = (int32_t)((prefix << 8) | indices[i]) + 1;
+		uint32_t slot = gif_find_slot(key);
+		if (gif->hash_keys[slot] == key) {
+			prefix = gif->hash_codes[slot];
+			continue;
+		}
+
+		gif_put_code(prefix, code_size);
+		if (next_code < GIF_MAX_CODES) {
+			if (next_code == (1u << code_size)) code_size++;
+			gif->hash_keys[slot] = key;
+			gif->hash_codes[slot] = (uint16_t)next_code++;
+		}
+		else {
+			//! Słownik jest pełny, zaczynamy go od nowa.
+			gif_put_code(GIF_CLEAR_CODE, code_size);
+			memset(gif->hash_keys, 0, sizeof(gif->hash_keys));
+			code_size = 9;
+			next_code = GIF_END_CODE + 1;
+		}
+		prefix = indices[i];
+	}
+	gif_put_code(prefix, code_size);
+	gif_put_code(GIF_END_CODE, code_size);
+
+	if (gif->bit_count > 0) gif_put_code(0, 8 - gif->bit_count);
+	gif_flush_block();
+	fputc(0, animation.file);
+}
+
+//! Zapisuje nagłówek pliku w wybranym formacie. Surowe klatki RGB nie mają nagłówka.
+static void write_animation_header() {
+	if (animation.format == ANIMATION_Y4M) {
+		fprintf(animation.file, "YUV4MPEG2 W%u H%u F%u:1 Ip A1:1 C444\n", animation.width, animation.height, ANIMATION_FRAME_RATE);
+	}
+	else if (animation.format == ANIMATION_GIF) {
+		fwrite("GIF89a", 1, 6, animation.file);
+		write_u16_to_file((uint16_t)animation.width);
+		write_u16_to_file((uint16_t)animation.height);
+		fputc(0xF7, animation.file); //! globalna paleta 256 kolorów
+		fputc(0, animation.file);
+		fputc(0, animation.file);
+
+		uint8_t palette[256 * 3] = { 0 };
+		for (uint32_t i = 0; i < 216; i++) {
+			palette[i * 3] = (uint8_t)((i / 36) * 51);
+			palette[i * 3 + 1] = (uint8_t)((i / 6 % 6) * 51);
+			palette[i * 3 + 2] = (uint8_t)((i % 6) * 51);
+		}
+		palette[GIF_REPLACEMENT_INDEX * 3] = replacement_color.r;
+		palette[GIF_REPLACEMENT_INDEX * 3 + 1] = replacement_color.g;
+		palette[GIF_REPLACEMENT_INDEX * 3 + 2] = replacement_color.b;
+		fwrite(palette, 1, sizeof(palette), animation.file);
+
+		//! Rozszerzenie NETSCAPE2.0, animacja zapętla się bez końca.
+		fwrite("\x21\xFF\x0BNETSCAPE2.0\x03\x01\x00\x00\x00", 1, 19, animation.file);
+	}
+}
+
+/*!
+* Wątek kodujący klatki z pierścienia i zapisujący je do pliku. Kończy po opróżnieniu pierścienia, gdy wypełnianie się skończyło.
+* \param ALLEGRO_THREAD* thread Wątek Allegro.
+* \param void* arg Nieużywany.
+*/
+static void* animation_thread(ALLEGRO_THREAD* thread, void* arg) {
+	uint64_t frame_size = (uint64_t)animation.width * animation.height * 3;
+
+	al_lock_mutex(animation.mutex);
+	while (true) {
+		while (animation.frame_amount == 0 && !animation.finished) {
+			al_wait_cond(animation.changed, animation.mutex);
+		}
+		if (animation.frame_amount == 0) break;
+		uint8_t* frame = animation.frames[animation.first_frame];
+		al_unlock_mutex(animation.mutex);
+
+		switch (animation.format) {
+		case ANIMATION_Y4M:
+			write_y4m_frame(frame);
+			break;
+		case ANIMATION_GIF:
+			write_gif_frame(frame);
+			break;
+		default:
+			fwrite(frame, 1, frame_size, animation.file);
+			break;
+		}
+		animation.written_frames++;
+
+		al_lock_mutex(animation.mutex);
+		animation.first_frame = (animation.first_frame + 1) % ANIMATION_FRAME_BUFFERS;
+		animation.frame_amount--;
+		al_broadcast_cond(animation.changed);
+	}
+	al_unlock_mutex(animation.mutex);
+	return NULL;
+}
+
+/*!
+* Kopiuje obecny stan obrazu do wolnej klatki pierścienia. Czeka, jeśli wątek kodujący nie nadąża.
+* \param Image* image Wypełniany obraz.
+*/
+static void queue_animation_frame(Image* image) {
+	al_lock_mutex(animation.mutex);
+	while (animation.frame_amount == ANIMATION_FRAME_BUFFERS) {
+		al_wait_cond(animation.changed, animation.mutex);
+	}
+	uint8_t* frame = animation.frames[(animation.first_frame + animation.frame_amount) % ANIMATION_FRAME_BUFFERS];
+	al_unlock_mutex(animation.mutex);
+
+	//! Wątek kodujący nie używa tej klatki, dopóki nie zwiększymy frame_amount, więc kopiujemy bez blokady.
+	copy_row_major_pixels(frame, image);
+
+	al_lock_mutex(animation.mutex);
+	animation.frame_amount++;
+	al_broadcast_cond(animation.changed);
+	al_unlock_mutex(animation.mutex);
+}
+
+/*!
+* Wywoływana przez algorytm wypełniania po każdym pikselu, co pixels_per_frame pikseli dodaje klatkę.
+* \param Image* image Wypełniany obraz.
+*/
+static void record_animation_step(Image* image) {
+	if (++animation.pixels_since_frame < animation.pixels_per_frame) return;
+	animation.pixels_since_frame = 0;
+	queue_animation_frame(image);
+}
+
+//! Zwalnia bufory i obiekty synchronizacji eksportu oraz zamyka plik.
+static void free_animation() {
+	for (uint32_t i = 0; i < ANIMATION_FRAME_BUFFERS; i++) free(animation.frames[i]);
+	free(animation.encode_buffer);
+	free(animation.gif);
+	if (animation.changed) al_destroy_cond(animation.changed);
+	if (animation.mutex) al_destroy_mutex(animation.mutex);
+	if (animation.file) fclose(animation.file);
+	memset(&animation, 0, sizeof(animation));
+}
+
+/*!
+* Wypełnia obraz szybką wersją algorytmu i zapisuje przebieg wypełniania jako animację, bez wyświetlania i bez zapisu Result.bmp po każdym kroku.
+* Format zależy od rozszerzenia pliku: .y4m (YUV 4:4:4), .gif (paleta 6x6x6 i dokładny kolor wypełnienia), inne to surowe klatki RGB24 jedna za drugą.
+* Pierwsza klatka pokazuje obraz przed wypełnieniem, ostatnia po nim. Klatki koduje osobny wątek.
+* \param const char* path Ścieżka pliku wyjściowego.
+* \param Image* image Wypełniany obraz, zostaje zmieniony.
+* \param algorithm_t algorithm Wybrany algorytm.
+* \param uint32_t x Pozycja X punktu startowego.
+* \param uint32_t y Pozycja Y punktu startowego.
+* \param uint64_t pixels_per_frame Ilość wypełnionych pikseli przypadająca na jedną klatkę.
+* \returns true, jeśli animacja została zapisana.
+*/
+bool export_fill_animation(const char* path, Image* image, algorithm_t algorithm, uint32_t x, uint32_t y, uint64_t pixels_per_frame) {
+	if (x >= image->width || y >= image->height) {
+		printf("Start point %u %u is outside the image\n", x, y);
+		return false;
+	}
+
+	animation.width = image->width;
+	animation.height = image->height;
+	animation.pixels_per_frame = pixels_per_frame ? pixels_per_frame : 1;
+	animation.format = has_file_extension(path, ".y4m") ? ANIMATION_Y4M
+		: has_file_extension(path, ".gif") ? ANIMATION_GIF
+		: ANIMATION_RAW;
+
+	if (animation.format == ANIMATION_GIF && (image->width > UINT16_MAX || image->height > UINT16_MAX)) {
+		printf("Image is too large for GIF\n");
+		return false;
+	}
+
+	uint64_t frame_size = (uint64_t)image->width * image->height * 3;
+	bool allocated = true;
+	for (uint32_t i = 0; i < ANIMATION_FRAME_BUFFERS; i++) {
+		animation.frames[i] = malloc(frame_size);
+		allocated = allocated && animation.frames[i] != NULL;
+	}
+	if (animation.format == ANIMATION_Y4M) animation.encode_buffer = malloc(frame_size);
+	if (animation.format == ANIMATION_GIF) {
+		animation.encode_buffer = malloc(frame_size / 3);
+		animation.gif = malloc(sizeof(GifEncoder));
+		allocated = allocated && animation.gif != NULL;
+	}
+	allocated = allocated && (animation.format == ANIMATION_RAW || animation.encode_buffer != NULL);
+
+	animation.file = fopen(path, "wb");
+	animation.mutex = al_create_mutex();
+	animation.changed = al_create_cond();
+	if (!allocated || animation.file == NULL || animation.mutex == NULL || animation.changed == NULL) {
+		printf("error when exporting animation to %s\n", path);
+		free_animation();
+		return false;
+	}
+
+	write_animation_header();
+	animation.thread = al_create_thread(animation_thread, NULL);
+	if (animation.thread == NULL) {
+		free_animation();
+		return false;
+	}
+	al_start_thread(animation.thread);
+
+	double start = al_get_time();
+	queue_animation_frame(image);
+
+	Color_t current_color = { 0 };
+	get_pixel_color(&current_color, x, y, image);
+
+	//! Zawsze używamy szybkiej wersji algorytmu, kroki zbiera record_animation_step.
+	bool previous_visualisation_mode = visualisation_mode;
+	visualisation_mode = false;
+	set_fill_step_callback(record_animation_step);
+	flood_fill(algorithm, x, y, image, current_color);
+	set_fill_step_callback(NULL);
+	visualisation_mode = previous_visualisation_mode;
+
+	if (animation.pixels_since_frame > 0) queue_animation_frame(image);
+
+	al_lock_mutex(animation.mutex);
+	animation.finished = true;
+	al_broadcast_cond(animation.changed);
+	al_unlock_mutex(animation.mutex);
+	al_destroy_thread(animation.thread);
+
+	if (animation.format == ANIMATION_GIF) fputc(0x3B, animation.file);
+	bool success = !ferror(animation.file);
+	success = fclose(animation.file) == 0 && success;
+	animation.file = NULL;
+	printf("Animation: %llu frames to %s in %.2f s\n", (unsigned long long)animation.written_frames, path, al_get_time() - start);
+	free_animation();
+	return success;
+}
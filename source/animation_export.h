@@ -0,0 +1,11 @@
+//! \file animation_export.h Zapisywanie animacji wypełniania do pliku wideo.
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "values.h"
+
+//! Domyślna ilość wypełnionych pikseli przypadających na jedną klatkę animacji.
+#define ANIMATION_DEFAULT_PIXELS_PER_FRAME 1000
+
+bool export_fill_animation(const char*, Image*, algorithm_t, uint32_t, uint32_t, uint64_t);
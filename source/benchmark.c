@@ -0,0 +1,448 @@
+//! \file benchmark.c Pomiar czasu wypełniania w wielu powtórzeniach: rozgrzewka, obraz odtwarzany z kopii w pamięci, zimna lub ciepła pamięć podręczna, statystyki z odrzuceniem pomiarów odstających.
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <intrin.h>
+#pragma intrinsic(__rdtsc)
+#include <allegro5/allegro.h>
+#include "benchmark.h"
+#include "fill_algorithms.h"
+#include "image_management.h"
+#include "hardware_counters.h"
+#include "image_generator.h"
+#include "values.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define BENCHMARK_CLFLUSH 1
+#else
+#define BENCHMARK_CLFLUSH 0
+//! Rozmiar bufora przepisywanego w celu wyparcia obrazu z pamięci podręcznej, gdy nie ma instrukcji clflush.
+#define BENCHMARK_CACHE_SWEEP_SIZE (64 * 1024 * 1024)
+#endif
+
+//! Wynik jednego powtórzenia.
+typedef struct BenchmarkRun {
+	double duration; //! w milisekundach
+	uint64_t cycles;
+	HardwareCounters counters;
+} BenchmarkRun;
+
+/*!
+* Porównuje dwa powtórzenia po czasie trwania, używana przez qsort.
+* \param const void* first Pierwsze powtórzenie.
+* \param const void* second Drugie powtórzenie.
+*/
+static int compare_runs(const void* first, const void* second) {
+	double difference = ((const BenchmarkRun*)first)->duration - ((const BenchmarkRun*)second)->duration;
+	return (difference > 0) - (difference < 0);
+}
+
+/*!
+* Porównuje dwie liczby, używana przez qsort.
+* \param const void* first Pierwsza liczba.
+* \param const void* second Druga liczba.
+*/
+static int compare_doubles(const void* first, const void* second) {
+	double difference = *(const double*)first - *(const double*)second;
+	return (difference > 0) - (difference < 0);
+}
+
+/*!
+* Zwraca medianę posortowanej tablicy czasów powtórzeń.
+* \param const BenchmarkRun* runs Posortowane powtórzenia.
+* \param uint32_t amount Ilość powtórzeń.
+*/
+static double median_duration(const BenchmarkRun* runs, uint32_t amount) {
+	return amount % 2 ? runs[amount / 2].duration : (runs[amount / 2 - 1].duration + runs[amount / 2].duration) / 2;
+}
+
+/*!
+* Usuwa obraz z pamięci podręcznej procesora: instrukcją clflush dla każdej linii albo, bez niej, przepisując duży bufor.
+* \param Image* image Obraz, którego piksele mają zostać usunięte z pamięci podręcznej.
+*/
+static void flush_image_from_cache(Image* image) {
+	uint64_t size = image_buffer_size(image);
+#if BENCHMARK_CLFLUSH
+	for (uint64_t offset = 0; offset < size; offset += 64) {
+		_mm_clflush(image->as_array + offset);
+	}
+	_mm_clflush(image->as_array + size - 1);
+	_mm_mfence();
+#else
+	static uint8_t* sweep = NULL;
+	if (sweep == NULL) sweep = malloc(BENCHMARK_CACHE_SWEEP_SIZE);
+	if (sweep == NULL) return;
+	for (uint64_t offset = 0; offset < BENCHMARK_CACHE_SWEEP_SIZE; offset += 64) {
+		sweep[offset]++;
+	}
+#endif
+}
+
+/*!
+* Sprawdza, czy wypełnianie zmieniło kolor piksela.
+* \param const Image* pristine Obraz przed wypełnieniem.
+* \param const Image* filled Obraz po wypełnieniu, w tym samym układzie pikseli.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+*/
+static bool is_filled_pixel(const Image* pristine, const Image* filled, uint32_t x, uint32_t y) {
+	uint64_t offset = pixel_offset(pristine, x, y);
+	return memcmp(filled->as_array + offset, pristine->as_array + offset, 3) != 0;
+}
+
+/*!
+* Wyznacza pole, prostokąt ograniczający, środek i obwód obszaru z różnicy obrazów, jednym przejściem poza mierzonym czasem
+* i niezależnie od MEASURE_REGION_STATS. Obwód liczony jest tak jak w finish_region_stats: piksel leży na obwodzie,
+* gdy któryś z jego czterech sąsiadów jest poza obrazem albo nie zmienił koloru.
+* \param const Image* pristine Obraz przed wypełnieniem.
+* \param const Image* filled Obraz po wypełnieniu, w tym samym układzie pikseli.
+* \param BenchmarkResult* result Wyniki pomiaru, do których trafiają statystyki obszaru.
+*/
+static void measure_region(const Image* pristine, const Image* filled, BenchmarkResult* result) {
+	uint64_t sum_x = 0;
+	uint64_t sum_y = 0;
+	result->min_x = UINT32_MAX;
+	result->min_y = UINT32_MAX;
+	for (uint32_t y = 0; y < pristine->height; y++) {
+		for (uint32_t x = 0; x < pristine->width; x++) {
+			if (!is_filled_pixel(pristine, filled, x, y)) continue;
+
+			result->filled_pixels++;
+			if (x < result->min_x) result->min_x = x;
+			if (y < result->min_y) result->min_y = y;
+			if (x > result->max_x) result->max_x = x;
+			if (y > result->max_y) result->max_y = y;
+			sum_x += x;
+			sum_y += y;
+			if (x == 0 || y == 0 || x + 1 >= pristine->width || y + 1 >= pristine->height
+				|| !is_filled_pixel(pristine, filled, x - 1, y)
+				|| !is_filled_pixel(pristine, filled, x + 1, y)
+				|| !is_filled_pixel(pristine, filled, x, y - 1)
+				|| !is_filled_pixel(pristine, filled, x, y + 1)
+				) {
+				result->perimeter_pixels++;
+			}
+		}
+	}
+
+	if (result->filled_pixels == 0) {
+		result->min_x = 0;
+		result->min_y = 0;
+		return;
+	}
+	result->centroid_x = (double)sum_x / result->filled_pixels;
+	result->centroid_y = (double)sum_y / result->filled_pixels;
+}
+
+//! Mierzone wypełnianie: dostaje świeżą kopię obrazu i dane przekazane do measure_fill.
+typedef void (*measured_fill_t)(Image*, const void*);
+
+//! Dane wypełniania jednym algorytmem od jednego punktu, dla fill_from_point.
+typedef struct PointFill {
+	algorithm_t algorithm;
+	uint32_t x;
+	uint32_t y;
+	Color_t current_color;
+} PointFill;
+
+//! Dane wypełniania wielu punktów startowych, dla fill_seeds_in_batch i fill_seeds_separately.
+typedef struct SeedsFill {
+	Seed_t* seeds;
+	uint32_t seed_amount;
+	algorithm_t algorithm; //! algorytm osobnych wywołań flood_fill
+} SeedsFill;
+
+/*!
+* Wypełnia obraz jednym algorytmem od jednego punktu.
+* \param Image* image Modyfikowany obraz.
+* \param const void* context PointFill.
+*/
+static void fill_from_point(Image* image, const void* context) {
+	const PointFill* fill = context;
+	flood_fill(fill->algorithm, fill->x, fill->y, image, fill->current_color);
+}
+
+/*!
+* Wypełnia obszary wszystkich punktów startowych jednym wywołaniem flood_fill_batch.
+* \param Image* image Modyfikowany obraz.
+* \param const void* context SeedsFill.
+*/
+static void fill_seeds_in_batch(Image* image, const void* context) {
+	const SeedsFill* fill = context;
+	flood_fill_batch(fill->seeds, fill->seed_amount, image, NULL);
+}
+
+/*!
+* Wypełnia obszary punktów startowych po kolei, osobnym flood_fill dla każdego punktu, z kolorem punktu jako kolorem wypełnienia.
+* Punkty poza obrazem i w kolorze swojego wypełnienia są pomijane.
+* \param Image* image Modyfikowany obraz.
+* \param const void* context SeedsFill.
+*/
+static void fill_seeds_separately(Image* image, const void* context) {
+	const SeedsFill* fill = context;
+	Color_t previous_replacement_color = replacement_color;
+	for (uint32_t i = 0; i < fill->seed_amount; i++) {
+		const Seed_t* seed = &fill->seeds[i];
+		if (seed->x >= image->width || seed->y >= image->height) continue;
+
+		Color_t current_color = { 0 };
+		get_pixel_color(&current_color, seed->x, seed->y, image);
+		if (current_color.r == seed->color.r && current_color.g == seed->color.g && current_color.b == seed->color.b) continue;
+
+		replacement_color = seed->color;
+		flood_fill(fill->algorithm, seed->x, seed->y, image, current_color);
+	}
+	replacement_color = previous_replacement_color;
+}
+
+/*!
+* Mierzy czas wypełniania w wielu powtórzeniach.
+* Przed każdym powtórzeniem obraz jest odtwarzany z nietkniętej kopii w pamięci, bez ponownego dekodowania pliku,
+* a przy zimnej pamięci podręcznej dodatkowo usuwany z pamięci podręcznej procesora. Powtórzenia rozgrzewające nie są liczone.
+* Pomiary odstające od mediany o więcej niż BENCHMARK_OUTLIER_THRESHOLD (zmodyfikowany z-score z MAD) są odrzucane.
+* Zawsze używa szybkiej wersji algorytmów. Statystyki obszaru liczy po pomiarze z obrazu po ostatnim powtórzeniu, patrz measure_region.
+* \param Image* pristine Obraz przed wypełnieniem, w dowolnym układzie pikseli, nie jest zmieniany.
+* \param measured_fill_t fill Mierzone wypełnianie.
+* \param const void* context Przekazywany do fill.
+* \param const BenchmarkOptions* options Ilość powtórzeń, rozgrzewek i rodzaj pamięci podręcznej.
+* \param BenchmarkResult* result Wyniki pomiaru, bez algorytmu.
+* \returns true, jeśli pomiar się udał.
+*/
+static bool measure_fill(Image* pristine, measured_fill_t fill, const void* context, const BenchmarkOptions* options, BenchmarkResult* result) {
+	if (options->runs == 0) return false;
+
+	uint64_t size = image_buffer_size(pristine);
+	Image image = *pristine;
+	image.as_array = malloc(size);
+	BenchmarkRun* runs = malloc(sizeof(BenchmarkRun) * options->runs);
+	double* deviations = malloc(sizeof(double) * options->runs);
+	if (image.as_array == NULL || runs == NULL || deviations == NULL) {
+		free(image.as_array);
+		free(runs);
+		free(deviations);
+		return false;
+	}
+
+	bool previous_visualisation_mode = visualisation_mode;
+	visualisation_mode = false;
+
+	for (uint32_t i = 0; i < options->warmup_runs + options->runs; i++) {
+		memcpy(image.as_array, pristine->as_array, size);
+		if (options->cold_cache) flush_image_from_cache(&image);
+		memset(&measure_values, 0, sizeof(measure_values));
+
+		double time_start = al_get_time();
+		uint64_t cycles_start = __rdtsc();
+		fill(&image, context);
+		uint64_t cycles = __rdtsc() - cycles_start;
+		double duration = (al_get_time() - time_start) * 1000;
+		finish_region_stats(&image);
+
+		if (i < options->warmup_runs) continue;
+		runs[i - options->warmup_runs].duration = duration;
+		runs[i - options->warmup_runs].cycles = cycles;
+		runs[i - options->warmup_runs].counters = measure_values.hardware_counters;
+	}
+	visualisation_mode = previous_visualisation_mode;
+
+	memset(result, 0, sizeof(BenchmarkResult));
+	result->cold_cache = options->cold_cache;
+
+	measure_region(pristine, &image, result);
+
+	//! Mediana i MAD ze wszystkich pomiarów.
+	qsort(runs, options->runs, sizeof(BenchmarkRun), compare_runs);
+	double median = median_duration(runs, options->runs);
+	for (uint32_t i = 0; i < options->runs; i++) {
+		deviations[i] = fabs(runs[i].duration - median);
+	}
+	qsort(deviations, options->runs, sizeof(double), compare_doubles);
+	result->mad = options->runs % 2
+		? deviations[options->runs / 2]
+		: (deviations[options->runs / 2 - 1] + deviations[options->runs / 2]) / 2;
+
+	//! Pomiary są posortowane, więc pozostawione tworzą spójny przedział [first, last].
+	uint32_t first = 0;
+	uint32_t last = options->runs - 1;
+	if (result->mad > 0) {
+		double threshold = BENCHMARK_OUTLIER_THRESHOLD * 1.4826 * result->mad;
+		while (median - runs[first].duration > threshold) first++;
+		while (runs[last].duration - median > threshold) last--;
+	}
+	BenchmarkRun* kept = runs + first;
+	result->runs = last - first + 1;
+	result->rejected_runs = options->runs - result->runs;
+
+	result->min = kept[0].duration;
+	result->median = median_duration(kept, result->runs);
+	result->p95 = kept[(uint32_t)ceil(0.95 * result->runs) - 1].duration;
+	for (uint32_t i = 0; i < result->runs; i++) result->mean += kept[i].duration;
+	result->mean /= result->runs;
+	for (uint32_t i = 0; i < result->runs; i++) result->stddev += (kept[i].duration - result->mean) * (kept[i].duration - result->mean);
+	result->stddev = result->runs > 1 ? sqrt(result->stddev / (result->runs - 1)) : 0;
+	result->median_cycles = kept[(result->runs - 1) / 2].cycles;
+	result->counters = kept[(result->runs - 1) / 2].counters;
+
+	free(image.as_array);
+	free(runs);
+	free(deviations);
+	return true;
+}
+
+/*!
+* Mierzy czas wypełnienia obrazu od podanego punktu w wielu powtórzeniach, patrz measure_fill.
+* \param Image* pristine Obraz przed wypełnieniem, w dowolnym układzie pikseli, nie jest zmieniany.
+* \param algorithm_t algorithm Mierzony algorytm.
+* \param uint32_t x Pozycja X punktu startowego.
+* \param uint32_t y Pozycja Y punktu startowego.
+* \param const BenchmarkOptions* options Ilość powtórzeń, rozgrzewek i rodzaj pamięci podręcznej.
+* \param BenchmarkResult* result Wyniki pomiaru.
+* \returns true, jeśli pomiar się udał.
+*/
+bool run_benchmark(Image* pristine, algorithm_t algorithm, uint32_t x, uint32_t y, const BenchmarkOptions* options, BenchmarkResult* result) {
+	if (x >= pristine->width || y >= pristine->height) return false;
+
+	PointFill fill = { algorithm, x, y, { 0 } };
+	get_pixel_color(&fill.current_color, x, y, pristine);
+	if (!measure_fill(pristine, fill_from_point, &fill, options, result)) return false;
+	result->algorithm = algorithm;
+	return true;
+}
+
+/*!
+* Mierzy wypełnianie wielu punktów startowych: jednym wywołaniem flood_fill_batch i osobnym flood_fill dla każdego punktu.
+* Osobne wywołania wyznaczają obszary z kolorów po poprzednich wypełnieniach, więc przy punktach w kolorach sąsiednich
+* obszarów ilość wypełnionych pikseli obu pomiarów może się różnić.
+* \param Image* pristine Obraz przed wypełnieniem, nie jest zmieniany.
+* \param Seed_t* seeds Punkty startowe z kolorami wypełnienia.
+* \param uint32_t seed_amount Ilość punktów startowych.
+* \param algorithm_t algorithm Algorytm osobnych wywołań flood_fill.
+* \param const BenchmarkOptions* options Ilość powtórzeń, rozgrzewek i rodzaj pamięci podręcznej.
+* \param BenchmarkResult* batch_result Wyniki flood_fill_batch.
+* \param BenchmarkResult* separate_result Wyniki osobnych wywołań flood_fill.
+* \returns true, jeśli oba pomiary się udały.
+*/
+bool run_batch_benchmark(Image* pristine, Seed_t* seeds, uint32_t seed_amount, algorithm_t algorithm, const BenchmarkOptions* options, BenchmarkResult* batch_result, BenchmarkResult* separate_result) {
+	SeedsFill fill = { seeds, seed_amount, algorithm };
+	if (!measure_fill(pristine, fill_seeds_in_batch, &fill, options, batch_result)) return false;
+	if (!measure_fill(pristine, fill_seeds_separately, &fill, options, separate_result)) return false;
+	batch_result->algorithm = algorithm;
+	separate_result->algorithm = algorithm;
+	return true;
+}
+
+/*!
+* Mierzy wszystkie algorytmy na każdym wzorze z image_generator.h, na kwadratowych obrazach od 1 KP, co rząd wielkości, aż do podanej ilości megapikseli.
+* Obrazy są generowane w pamięci z domyślnym ziarnem i parametrem i nazywane tak jak ich opis, np. maze:1000x1000:1.
+* \param double megapixels Największy mierzony rozmiar obrazu.
+* \param const BenchmarkOptions* options Ilość powtórzeń, rozgrzewek i rodzaj pamięci podręcznej.
+* \param benchmark_callback_t callback Wywoływana po każdym pomiarze.
+* \param void* context Przekazywany do callback.
+* \returns true, jeśli wszystkie pomiary się udały.
+*/
+bool run_benchmark_suite(double megapixels, const BenchmarkOptions* options, benchmark_callback_t callback, void* context) {
+	const uint32_t sizes[GENERATOR_SIZE_AMOUNT] = GENERATOR_SIZES;
+	double max_pixels = megapixels * 1000000 * 1.001;
+
+	for (uint32_t size = 0; size < GENERATOR_SIZE_AMOUNT && (double)sizes[size] * sizes[size] <= max_pixels; size++) {
+		for (uint32_t pattern = 0; pattern < PATTERN_AMOUNT; pattern++) {
+			char name[64];
+			snprintf(name, sizeof(name), "%s:%ux%u:%u", pattern_names[pattern], sizes[size], sizes[size], GENERATOR_DEFAULT_SEED);
+
+			Image image;
+			uint32_t x, y;
+			if (!generate_image_from_spec(name, &image, &x, &y)) {
+				printf("error when generating %s\n", name);
+				return false;
+			}
+
+			for (uint32_t algorithm = 0; algorithm < ALGORITHM_AMOUNT; algorithm++) {
+				BenchmarkResult result;
+				if (!run_benchmark(&image, algorithm, x, y, options, &result)) {
+					free(image.as_array);
+					return false;
+				}
+				callback(name, &result, context);
+			}
+			free(image.as_array);
+		}
+	}
+	return true;
+}
+
+/*!
+* Wypisuje wyniki pomiaru na konsolę.
+* \param const char* image_name Nazwa mierzonego obrazu.
+* \param const BenchmarkResult* result Wyniki pomiaru.
+*/
+void print_benchmark_result(const char* image_name, const BenchmarkResult* result) {
+	printf(
+		"%s %s (%s): median %.3f ms, min %.3f ms, p95 %.3f ms, stddev %.3f ms, %u runs, %u rejected, %llu px, %.1f cycles/px, "
+		"bounds (%u, %u) - (%u, %u), centroid (%.1f, %.1f), perimeter %llu px\n",
+		image_name,
+		algorithm_names[result->algorithm],
+		result->cold_cache ? "cold" : "warm",
+		result->median,
+		result->min,
+		result->p95,
+		result->stddev,
+		result->runs,
+		result->rejected_runs,
+		(unsigned long long)result->filled_pixels,
+		(double)result->median_cycles / (result->filled_pixels > 0 ? result->filled_pixels : 1),
+		result->min_x,
+		result->min_y,
+		result->max_x,
+		result->max_y,
+		result->centroid_x,
+		result->centroid_y,
+		(unsigned long long)result->perimeter_pixels
+	);
+}
+
+/*!
+* Zapisuje wiersz nagłówka pliku CSV z wynikami pomiarów.
+* \param FILE* file Plik CSV.
+*/
+void write_benchmark_csv_header(FILE* file) {
+	fprintf(file, "image,algorithm,cache,runs,rejected_runs,min_ms,median_ms,p95_ms,mean_ms,stddev_ms,mad_ms,median_cycles,filled_pixels,min_x,min_y,max_x,max_y,centroid_x,centroid_y,perimeter_pixels");
+	write_hardware_counters_csv_header(file);
+	fputc('\n', file);
+}
+
+/*!
+* Zapisuje wyniki pomiaru jako wiersz pliku CSV.
+* \param FILE* file Plik CSV.
+* \param const char* image_name Nazwa mierzonego obrazu.
+* \param const BenchmarkResult* result Wyniki pomiaru.
+*/
+void write_benchmark_csv(FILE* file, const char* image_name, const BenchmarkResult* result) {
+	fprintf(
+		file,
+		"%s,%s,%s,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%llu,%llu,%u,%u,%u,%u,%.2f,%.2f,%llu",
+		image_name,
+		algorithm_names[result->algorithm],
+		result->cold_cache ? "cold" : "warm",
+		result->runs,
+		result->rejected_runs,
+		result->min,
+		result->median,
+		result->p95,
+		result->mean,
+		result->stddev,
+		result->mad,
+		(unsigned long long)result->median_cycles,
+		(unsigned long long)result->filled_pixels,
+		result->min_x,
+		result->min_y,
+		result->max_x,
+		result->max_y,
+		result->centroid_x,
+		result->centroid_y,
+		(unsigned long long)result->perimeter_pixels
+	);
+	write_hardware_counters_csv(file, &result->counters);
+	fputc('\n', file);
+}
@@ -0,0 +1,56 @@
+//! \file benchmark.h Powtarzalne pomiary czasu wypełniania ze statystykami.
+
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "values.h"
+
+//! Domyślna ilość mierzonych powtórzeń.
+#define BENCHMARK_DEFAULT_RUNS 30
+//! Domyślna ilość powtórzeń rozgrzewających, które nie są mierzone.
+#define BENCHMARK_DEFAULT_WARMUP_RUNS 3
+//! Pomiar jest odrzucany, gdy jego zmodyfikowany z-score (odległość od mediany w jednostkach 1.4826 * MAD) przekracza tę wartość.
+#define BENCHMARK_OUTLIER_THRESHOLD 3.5
+
+//! Ustawienia pomiaru.
+typedef struct BenchmarkOptions {
+	uint32_t runs;
+	uint32_t warmup_runs;
+	bool cold_cache; //! przed każdym powtórzeniem obraz jest usuwany z pamięci podręcznej procesora
+} BenchmarkOptions;
+
+//! Wyniki pomiaru jednego algorytmu, czasy w milisekundach liczone po odrzuceniu pomiarów odstających.
+typedef struct BenchmarkResult {
+	algorithm_t algorithm;
+	bool cold_cache;
+	uint32_t runs;
+	uint32_t rejected_runs;
+	double min;
+	double median;
+	double p95;
+	double mean;
+	double stddev;
+	double mad; //! mediana odchyleń bezwzględnych od mediany, liczona przed odrzuceniem pomiarów
+	uint64_t median_cycles;
+	uint64_t filled_pixels; //! pole obszaru: piksele, których kolor zmieniło wypełnianie
+	//! Prostokąt ograniczający, środek i obwód obszaru, liczone po pomiarze, gdy filled_pixels jest większe od 0
+	uint32_t min_x;
+	uint32_t min_y;
+	uint32_t max_x;
+	uint32_t max_y;
+	double centroid_x;
+	double centroid_y;
+	uint64_t perimeter_pixels;
+	HardwareCounters counters; //! liczniki sprzętowe powtórzenia z medianą czasu
+} BenchmarkResult;
+
+//! Wywoływana dla każdego wyniku run_benchmark_suite: nazwa obrazu, wyniki pomiaru i wskaźnik przekazany do run_benchmark_suite.
+typedef void (*benchmark_callback_t)(const char*, const BenchmarkResult*, void*);
+
+bool run_benchmark(Image*, algorithm_t, uint32_t, uint32_t, const BenchmarkOptions*, BenchmarkResult*);
+bool run_batch_benchmark(Image*, Seed_t*, uint32_t, algorithm_t, const BenchmarkOptions*, BenchmarkResult*, BenchmarkResult*);
+bool run_benchmark_suite(double, const BenchmarkOptions*, benchmark_callback_t, void*);
+void print_benchmark_result(const char*, const BenchmarkResult*);
+void write_benchmark_csv_header(FILE*);
+void write_benchmark_csv(FILE*, const char*, const BenchmarkResult*);
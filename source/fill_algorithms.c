@@ -1,24 +1,325 @@
 ﻿//! \file fill_algorithms.c Algorytmy wypełniania.
 
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
 #include <allegro5/allegro.h>
 #include <allegro5/allegro_image.h>
 #include <allegro5/allegro_primitives.h>
 
+//! Atomowe ustawienie i wyzerowanie bitu, zwracają poprzednią wartość bitu. Używane przez równoległy BFS.
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma intrinsic(__rdtsc)
+#define ATOMIC_BIT_TEST_AND_SET(target, bit) _interlockedbittestandset((target), (bit))
+#define ATOMIC_BIT_TEST_AND_RESET(target, bit) _interlockedbittestandreset((target), (bit))
+#else
+#include <x86intrin.h>
+#define ATOMIC_BIT_TEST_AND_SET(target, bit) ((__atomic_fetch_or((target), 1L << (bit), __ATOMIC_SEQ_CST) >> (bit)) & 1)
+#define ATOMIC_BIT_TEST_AND_RESET(target, bit) ((__atomic_fetch_and((target), ~(1L << (bit)), __ATOMIC_SEQ_CST) >> (bit)) & 1)
+#endif
+
 #include "right_panel.h"
 #include "queue.h"
 #include "values.h"
 #include "image_management.h"
+#include "hardware_counters.h"
+#include "trace.h"
+#include "stack_guard.h"
+#include "visit_heatmap.h"
 
 void stack_based_recursive_four_way(uint32_t, uint32_t, Image*, Color_t);
 void stack_based_recursive_eight_way(uint32_t, uint32_t, Image*, Color_t);
 void queue_based_four_way(uint32_t, uint32_t, Image*, Color_t);
 void scanline_recursive(uint32_t, uint32_t, Image*, Color_t);
+void painter_four_way(uint32_t, uint32_t, Image*, Color_t);
+void parallel_bfs_four_way(uint32_t, uint32_t, Image*, Color_t);
+void raster_sweep_four_way(uint32_t, uint32_t, Image*, Color_t);
+void scanline_recursive_eight_way(uint32_t, uint32_t, Image*, Color_t);
 
 void stack_based_recursive_four_way_visualize(uint32_t, uint32_t, Image*, Color_t);
 void stack_based_recursive_eight_way_visualize(uint32_t, uint32_t, Image*, Color_t);
 void queue_based_four_way_visualize(uint32_t, uint32_t, Image*, Color_t);
 void scanline_recursive_visualize(uint32_t, uint32_t, Image*, Color_t);
+static uint64_t fill_without_recursion(uint32_t, uint32_t, Image*, Color_t, bool);
+
+#if MEASURE_REGION_STATS
+//! Bitmapa pikseli wypełnionych przez obecne wypełnianie, bit na piksel w kolejności pikseli obrazu, NULL gdy zabrakło pamięci.
+//! Bity ostatniego obszaru czyści finish_region_stats, a gdy nikt jej nie wywołał, następne start_region_stats.
+static uint64_t* region_bitmap = NULL;
+static uint64_t region_bitmap_capacity = 0; //! ilość słów 64-bitowych, na które jest zaalokowana pamięć
+
+//! Prostokąt ograniczający i szerokość obrazu ostatniego obszaru, którego bity nie zostały jeszcze wyczyszczone.
+static bool region_bitmap_dirty = false;
+static uint32_t dirty_min_x, dirty_min_y, dirty_max_x, dirty_max_y;
+static uint64_t dirty_width;
+
+//! Sprawdza, czy piksel o podanym indeksie został wypełniony przez obecne wypełnianie.
+static inline bool is_region_pixel(uint64_t index) {
+	return (region_bitmap[index >> 6] >> (index & 63)) & 1;
+}
+
+//! Czyści bity ostatniego obszaru: całe słowa obejmujące każdy wiersz jego prostokąta ograniczającego.
+static void clear_region_bitmap() {
+	for (uint32_t y = dirty_min_y; y <= dirty_max_y; y++) {
+		uint64_t first_word = (y * dirty_width + dirty_min_x) >> 6;
+		uint64_t last_word = (y * dirty_width + dirty_max_x) >> 6;
+		memset(&region_bitmap[first_word], 0, (size_t)(last_word - first_word + 1) * sizeof(uint64_t));
+	}
+	region_bitmap_dirty = false;
+}
+
+/*!
+* Zeruje statystyki obszaru przed wypełnianiem. Prostokąt ograniczający zaczyna jako pusty.
+* Czyści bity poprzedniego obszaru, jeśli nie zrobiło tego finish_region_stats,
+* i powiększa bitmapę wypełnionych pikseli, jeśli obraz jest większy niż poprzednie.
+* \param const Image* image Wypełniany obraz.
+*/
+static void start_region_stats(const Image* image) {
+	measure_values.area = 0;
+	measure_values.min_x = UINT32_MAX;
+	measure_values.min_y = UINT32_MAX;
+	measure_values.max_x = 0;
+	measure_values.max_y = 0;
+	measure_values.sum_x = 0;
+	measure_values.sum_y = 0;
+	measure_values.perimeter_pixels = 0;
+
+	uint64_t words = ((uint64_t)image->width * image->height + 63) / 64;
+	if (words > region_bitmap_capacity) {
+		free(region_bitmap);
+		region_bitmap = calloc((size_t)words, sizeof(uint64_t));
+		region_bitmap_capacity = region_bitmap ? words : 0;
+		region_bitmap_dirty = false;
+	}
+	else if (region_bitmap_dirty) {
+		clear_region_bitmap();
+	}
+}
+
+/*!
+* Zapamiętuje prostokąt ograniczający obszaru po wypełnianiu, żeby finish_region_stats albo następne wypełnianie wyczyściło jego bity.
+* \param const Image* image Wypełniony obraz.
+*/
+static void end_region_stats(const Image* image) {
+	if (region_bitmap == NULL || measure_values.area == 0) return;
+
+	region_bitmap_dirty = true;
+	dirty_min_x = measure_values.min_x;
+	dirty_min_y = measure_values.min_y;
+	dirty_max_x = measure_values.max_x;
+	dirty_max_y = measure_values.max_y;
+	dirty_width = image->width;
+}
+
+/*!
+* Dolicza właśnie wypełniony piksel do statystyk obszaru w strukturze MeasureValues:
+* pola, prostokąta ograniczającego i sumy współrzędnych do wyznaczenia środka. Obwód liczy finish_region_stats.
+* Piksel zaznaczony już w bitmapie nie jest liczony drugi raz.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+* \param const Image* image Modyfikowany obraz.
+*/
+static void record_region_pixel(uint32_t x, uint32_t y, const Image* image) {
+	if (region_bitmap) {
+		uint64_t index = (uint64_t)y * image->width + x;
+		if (is_region_pixel(index)) return;
+		region_bitmap[index >> 6] |= 1ull << (index & 63);
+	}
+
+	measure_values.area++;
+	if (x < measure_values.min_x) measure_values.min_x = x;
+	if (y < measure_values.min_y) measure_values.min_y = y;
+	if (x > measure_values.max_x) measure_values.max_x = x;
+	if (y > measure_values.max_y) measure_values.max_y = y;
+	measure_values.sum_x += x;
+	measure_values.sum_y += y;
+}
+
+//! Dolicza piksel do statystyk obszaru, bez MEASURE_REGION_STATS nie generuje żadnego kodu.
+#define RECORD_REGION_PIXEL(x, y, image) record_region_pixel(x, y, image)
+#else
+#define RECORD_REGION_PIXEL(x, y, image)
+#endif
+
+/*!
+* Liczy piksele obwodu ostatniego obszaru z bitmapy wypełnionych pikseli i czyści ją w prostokącie ograniczającym.
+* Piksel leży na obwodzie, gdy któryś z jego czterech sąsiadów jest poza obrazem albo nie został wypełniony przez to wypełnianie,
+* więc piksele, które już wcześniej miały kolor wypełnienia, nie są liczone jako część obszaru.
+* flood_fill jej nie wywołuje, żeby przejście po obszarze nie wliczało się do mierzonego czasu: wywołuje się ją po zatrzymaniu pomiaru.
+* Bez MEASURE_REGION_STATS nic nie robi.
+* \param const Image* image Obraz wypełniony przez ostatnie flood_fill.
+*/
+void finish_region_stats(const Image* image) {
+#if MEASURE_REGION_STATS
+	if (!region_bitmap_dirty) return;
+
+	uint64_t width = image->width;
+	for (uint32_t y = dirty_min_y; y <= dirty_max_y; y++) {
+		for (uint32_t x = dirty_min_x; x <= dirty_max_x; x++) {
+			uint64_t index = y * width + x;
+			if (!is_region_pixel(index)) continue;
+			if (x == 0 || y == 0 || x + 1 >= image->width || y + 1 >= image->height
+				|| !is_region_pixel(index - 1)
+				|| !is_region_pixel(index + 1)
+				|| !is_region_pixel(index - width)
+				|| !is_region_pixel(index + width)
+				) {
+				measure_values.perimeter_pixels++;
+			}
+		}
+	}
+	clear_region_bitmap();
+#endif
+}
+
+//! Funkcja wywoływana po każdym pikselu wypełnionym przez szybkie algorytmy, NULL wyłącza nagrywanie kroków.
+static fill_step_t fill_step = NULL;
+
+//! Zgłasza wypełniony piksel do nagrywania kroków, bez ustawionej funkcji kosztuje jedno porównanie.
+#define RECORD_FILL_STEP(image) if (fill_step) fill_step(image)
+
+/*!
+* Ustawia funkcję wywoływaną po każdym pikselu wypełnionym przez szybkie algorytmy, np. do zapisu animacji.
+* \param fill_step_t callback Wywoływana funkcja albo NULL, żeby wyłączyć nagrywanie kroków.
+*/
+void set_fill_step_callback(fill_step_t callback) {
+	fill_step = callback;
+}
+
+//! Mapa odległości pikseli od klikniętego piksela zapisywana przez algorytmy BFS, NULL gdy jest wyłączona albo zabrakło pamięci.
+static distance_t* distance_map = NULL;
+static bool distance_map_enabled = false;
+static uint64_t distance_map_capacity = 0; //! ilość odległości, na które jest zaalokowana pamięć
+static uint32_t distance_map_width = 0;
+static uint32_t distance_map_height = 0;
+//! Zakres indeksów, w którym poprzednie wypełnianie mogło zapisać odległości. Poza nim mapa ma wszędzie DISTANCE_UNREACHED.
+static uint64_t distance_map_dirty_begin = UINT64_MAX;
+static uint64_t distance_map_dirty_end = 0;
+
+/*!
+* Włącza albo wyłącza zapisywanie mapy odległości przez queue_based_four_way i parallel_bfs_four_way.
+* Włączenie działa od następnego wypełniania, wyłączenie zwalnia mapę.
+* \param bool enabled Czy zapisywać mapę odległości.
+*/
+void set_distance_map_enabled(bool enabled) {
+	distance_map_enabled = enabled;
+	if (!enabled) {
+		free(distance_map);
+		distance_map = NULL;
+		distance_map_capacity = 0;
+	}
+}
+
+/*!
+* Zwraca mapę odległości ostatniego wypełniania, wiersz po wierszu. Pikselom, do których algorytm nie dotarł albo który nie zapisuje
+* odległości, odpowiada DISTANCE_UNREACHED. Mapa jest ważna do następnego wypełniania.
+* \param uint32_t* width Szerokość mapy.
+* \param uint32_t* height Wysokość mapy.
+* \returns Mapa odległości albo NULL, gdy jest wyłączona.
+*/
+const distance_t* last_distance_map(uint32_t* width, uint32_t* height) {
+	*width = distance_map_width;
+	*height = distance_map_height;
+	return distance_map;
+}
+
+/*!
+* Przygotowuje mapę odległości przed wypełnianiem obrazu, wywoływana przez flood_fill. Gdy mapa jest wyłączona, nic nie robi.
+* \param const Image* image Wypełniany obraz.
+*/
+static void start_distance_map(const Image* image) {
+	if (!distance_map_enabled) return;
+
+	uint64_t pixel_amount = (uint64_t)image->width * image->height;
+	//! DISTANCE_UNREACHED ma wszystkie bity ustawione. Całą mapę czyścimy tylko po alokacji, potem wystarczy
+	//! wyczyścić zakres zapisany przez poprzednie wypełnianie, więc koszt zależy od wielkości obszaru, a nie obrazu.
+	if (pixel_amount > distance_map_capacity) {
+		free(distance_map);
+		distance_map = malloc(sizeof(distance_t) * pixel_amount);
+		distance_map_capacity = distance_map ? pixel_amount : 0;
+		if (distance_map) memset(distance_map, 0xFF, sizeof(distance_t) * pixel_amount);
+	}
+	else if (distance_map_dirty_begin <= distance_map_dirty_end) {
+		memset(distance_map + distance_map_dirty_begin, 0xFF, sizeof(distance_t) * (distance_map_dirty_end - distance_map_dirty_begin + 1));
+	}
+	distance_map_dirty_begin = UINT64_MAX;
+	distance_map_dirty_end = 0;
+	if (distance_map == NULL) return;
+
+	distance_map_width = image->width;
+	distance_map_height = image->height;
+}
+
+/*!
+* Rozszerza zakres mapy odległości czyszczony przed następnym wypełnianiem.
+* \param uint64_t begin Pierwszy zapisany indeks.
+* \param uint64_t end Ostatni zapisany indeks.
+*/
+static void mark_distance_map_dirty(uint64_t begin, uint64_t end) {
+	if (begin < distance_map_dirty_begin) distance_map_dirty_begin = begin;
+	if (end > distance_map_dirty_end) distance_map_dirty_end = end;
+}
+
+/*!
+* Krok wizualizacji: zapisuje zdjęcie, czeka chwilę, ponownie je ładuje i wyświetla razem z prawym panelem,
+* tak jak wersje algorytmów z przyrostkiem _visualize.
+* \param Image* image Modyfikowany obraz.
+*/
+static void show_visualization_step(Image* image) {
+	save_image_to_bmp("Images/Result.bmp", image);
+	al_rest(0.1);
+	al_destroy_bitmap(image->image);
+	image->image = al_load_bitmap("Images/Result.bmp");
+	al_clear_to_color(al_map_rgb(0, 0, 0));
+	al_draw_scaled_bitmap(
+		image->image,
+		0,
+		0,
+		image->width,
+		image->height,
+		0,
+		0,
+		image->width * image->scale,
+		image->height * image->scale,
+		0
+	);
+	show_right_panel(current_algorithm, true);
+	al_flip_display();
+}
+
+/*!
+* Wizualizacja algorytmu, który nie ma osobnej wersji _visualize: wykonuje szybką wersję,
+* pokazując obraz po każdym wypełnionym pikselu przez funkcję nagrywania kroków.
+* \param void (*fill)(uint32_t, uint32_t, Image*, Color_t) Szybka wersja algorytmu.
+* \param uint32_t mouse_x Pozycja piksela na osi X.
+* \param uint32_t mouse_y Pozycja piksela na osi Y.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor obecnego piksela.
+*/
+static void visualize_fill_steps(void (*fill)(uint32_t, uint32_t, Image*, Color_t), uint32_t mouse_x, uint32_t mouse_y, Image* image, Color_t current_color) {
+	fill_step_t previous_step = fill_step;
+	fill_step = show_visualization_step;
+	fill(mouse_x, mouse_y, image, current_color);
+	fill_step = previous_step;
+}
+
+/*!
+* Zwraca ilość pikseli wypełnionych przez ostatnie wypełnianie, do wyliczania odczytów i zapisów na piksel:
+* pole obszaru ze statystyk obszaru, a gdy ich nie ma (MEASURE_REGION_STATS równe 0 albo tryb wizualizacji), ilość zapisów pikseli.
+* \returns Ilość wypełnionych pikseli, co najmniej 1.
+*/
+uint64_t filled_pixel_amount() {
+	uint64_t filled_pixels = 0;
+#if MEASURE_REGION_STATS
+	filled_pixels = measure_values.area;
+#endif
+#if MEASURE_PIXEL_ACCESSES
+	if (filled_pixels == 0) filled_pixels = measure_values.pixel_writes;
+#endif
+	return filled_pixels > 0 ? filled_pixels : 1;
+}
 
 /*!
 * Funkcja wywołująca wypełnienie na podstawie obecnego algorytmu przekazywanego jako argument.
@@ -30,6 +331,33 @@ void scanline_recursive_visualize(uint32_t, uint32_t, Image*, Color_t);
 * \param Color_t current_color Kolor klikniętego piksela.
 */
 void flood_fill(algorithm_t algorithm, uint32_t mouse_x, uint32_t mouse_y, Image* image, Color_t current_color) {
+#if MEASURE_REGION_STATS
+	start_region_stats(image);
+#endif
+
+#if MEASURE_PIXEL_ACCESSES
+	measure_values.pixel_reads = 0;
+	measure_values.pixel_writes = 0;
+	measure_values.rejected_pixel_accesses = 0;
+#endif
+	measure_values.boundary_steps = 0;
+	measure_values.bfs_levels = 0;
+	measure_values.bfs_max_frontier = 0;
+	measure_values.bfs_threads = 0;
+	measure_values.sweep_count = 0;
+	measure_values.incomplete_fills = 0;
+#if MEASURE_VISIT_HEATMAP
+	start_visit_heatmap(image);
+#endif
+	start_distance_map(image);
+
+	start_stack_guard();
+
+#if MEASURE_HARDWARE_COUNTERS
+	start_hardware_counters();
+#endif
+	TRACE_BEGIN(fill_span);
+
 	switch (algorithm) {
 	case STACK_BASED_RECURSIVE_FOUR_WAY:
 		visualisation_mode
@@ -51,9 +379,37 @@ void flood_fill(algorithm_t algorithm, uint32_t mouse_x, uint32_t mouse_y, Image
 			? scanline_recursive_visualize(mouse_x, mouse_y, image, current_color)
 			: scanline_recursive(mouse_x, mouse_y, image, current_color);
 		break;
+	case PAINTER_FOUR_WAY:
+		visualisation_mode
+			? visualize_fill_steps(painter_four_way, mouse_x, mouse_y, image, current_color)
+			: painter_four_way(mouse_x, mouse_y, image, current_color);
+		break;
+	case PARALLEL_BFS_FOUR_WAY:
+		visualisation_mode
+			? visualize_fill_steps(parallel_bfs_four_way, mouse_x, mouse_y, image, current_color)
+			: parallel_bfs_four_way(mouse_x, mouse_y, image, current_color);
+		break;
+	case RASTER_SWEEP_FOUR_WAY:
+		visualisation_mode
+			? visualize_fill_steps(raster_sweep_four_way, mouse_x, mouse_y, image, current_color)
+			: raster_sweep_four_way(mouse_x, mouse_y, image, current_color);
+		break;
+	case SCANLINE_RECURSIVE_EIGHT_WAY:
+		visualisation_mode
+			? visualize_fill_steps(scanline_recursive_eight_way, mouse_x, mouse_y, image, current_color)
+			: scanline_recursive_eight_way(mouse_x, mouse_y, image, current_color);
+		break;
 	default:
 		break;
 	}
+	TRACE_END(fill_span, "flood_fill");
+
+#if MEASURE_HARDWARE_COUNTERS
+	stop_hardware_counters(&measure_values.hardware_counters);
+#endif
+#if MEASURE_REGION_STATS
+	end_region_stats(image);
+#endif
 }
 
 /*!
@@ -75,6 +431,16 @@ void stack_based_recursive_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* i
 	measure_values.current_stack_height++;
 	if (measure_values.max_stack_height < measure_values.current_stack_height) {
 		measure_values.max_stack_height = measure_values.current_stack_height;
+
+		//! Wchodzimy głębiej niż dotąd, więc mierzymy stos i przed jego końcem przechodzimy na wersję iteracyjną.
+		//! Tej głębokości nie zapisujemy jako osiągniętej, żeby kolejne wejście na nią też zostało sprawdzone.
+		if (stack_guard_exceeded()) {
+			measure_values.max_stack_height--;
+			measure_values.stack_fallback_count++;
+			fill_without_recursion(mouse_x, mouse_y, image, current_color, false);
+			measure_values.current_stack_height--;
+			return;
+		}
 	}
 
 	//! Sprawdzamy czy jestesmy poza obszarem zdjęcia.
@@ -102,6 +468,8 @@ void stack_based_recursive_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* i
 		&& current_pixel_color.b == current_color.b
 		) {
 		swap_color(image, mouse_x, mouse_y);
+		RECORD_REGION_PIXEL(mouse_x, mouse_y, image);
+		RECORD_FILL_STEP(image);
 	}
 	//! Kiedy kolor jest inny, kończymy działanie obecnej funkcji, zmiejszając zmienną liczącą wysokość stosu.
 	else {
@@ -138,6 +506,16 @@ void stack_based_recursive_eight_way(uint32_t mouse_x, uint32_t mouse_y, Image*
 	measure_values.current_stack_height++;
 	if (measure_values.max_stack_height < measure_values.current_stack_height) {
 		measure_values.max_stack_height = measure_values.current_stack_height;
+
+		//! Wchodzimy głębiej niż dotąd, więc mierzymy stos i przed jego końcem przechodzimy na wersję iteracyjną.
+		//! Tej głębokości nie zapisujemy jako osiągniętej, żeby kolejne wejście na nią też zostało sprawdzone.
+		if (stack_guard_exceeded()) {
+			measure_values.max_stack_height--;
+			measure_values.stack_fallback_count++;
+			fill_without_recursion(mouse_x, mouse_y, image, current_color, true);
+			measure_values.current_stack_height--;
+			return;
+		}
 	}
 
 	//! Sprawdzamy czy jestesmy poza obszarem zdjęcia.
@@ -165,6 +543,8 @@ void stack_based_recursive_eight_way(uint32_t mouse_x, uint32_t mouse_y, Image*
 		&& current_pixel_color.b == current_color.b
 		) {
 		swap_color(image, mouse_x, mouse_y);
+		RECORD_REGION_PIXEL(mouse_x, mouse_y, image);
+		RECORD_FILL_STEP(image);
 	}
 	//! Kiedy kolor jest inny, kończymy działanie obecnej funkcji, zmiejszając zmienną liczącą wysokość stosu.
 	else {
@@ -190,6 +570,7 @@ void stack_based_recursive_eight_way(uint32_t mouse_x, uint32_t mouse_y, Image*
 * Zamienia kolor bierzącego piksela na kolor wypełnienia, a następnie sąsiednie piksele wstawia do kolejki.
 * Każdy piksel z kolejki jest sprawdzany, czy jest konieczność zmiany jego koloru. Jeśli tak,
 * zmienia się jego kolor, a sąsiednie dla niego piksele zostają wstawione do kolejki.
+* Przy włączonej mapie odległości zapisuje w niej odległość każdego wypełnionego piksela od klikniętego.
 * \param uint32_t mouse_x Pozycja piksela na osi X.
 * \param uint32_t mouse_y Pozycja piksela na osi Y.
 * \param Image* image Modyfikowany obraz.
@@ -218,10 +599,18 @@ void queue_based_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* image, Colo
 	uint32_t position_x;
 	uint32_t position_y;
 
+	//! Odległość pikseli z obecnego poziomu przeszukiwania i ostatni węzeł tego poziomu. Wszystko, co dodamy do kolejki
+	//! przed jego zdjęciem, należy do następnego poziomu, więc wypełniony piksel kosztuje jeden zapis do mapy odległości.
+	distance_t distance = 0;
+	QueueNode* level_end = queue.tail;
+	uint64_t distance_begin = UINT64_MAX;
+	uint64_t distance_end = 0;
+
 	//! Pętla badająca każde współrzędne piksela w kolejce aż do momentu zwolnienia kolejki 
 	while (queue.head != NULL) {
 
 		//! Wczytujemy nową pozycje piksela
+		bool level_finished = queue.head == level_end;
 		dequeue(&queue, &position_x, &position_y);
 
 		//! Odczytujemy kolor badanego piksela
@@ -235,6 +624,14 @@ void queue_based_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* image, Colo
 			&& current_color.b == current_pixel_color.b
 			) {
 			swap_color(image, position_x, position_y);
+			RECORD_REGION_PIXEL(position_x, position_y, image);
+			RECORD_FILL_STEP(image);
+			if (distance_map) {
+				uint64_t index = (uint64_t)position_y * image->width + position_x;
+				distance_map[index] = distance;
+				if (index < distance_begin) distance_begin = index;
+				if (index > distance_end) distance_end = index;
+			}
 			if (position_x > 0) {
 				enqueue(&queue, position_x - 1, position_y); // lewo
 			}
@@ -249,7 +646,13 @@ void queue_based_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* image, Colo
 			}
 		}
 
+		//! Zdjęliśmy ostatni węzeł poziomu, więc w kolejce jest już tylko następny poziom.
+		if (level_finished) {
+			level_end = queue.tail;
+			if (distance < DISTANCE_UNREACHED - 1) distance++;
+		}
 	}
+	if (distance_map) mark_distance_map_dirty(distance_begin, distance_end);
 }
 
 /*!
@@ -268,6 +671,16 @@ void scanline_recursive(int mouse_x, int mouse_y, Image* image, Color_t current_
 	measure_values.current_stack_height++;
 	if (measure_values.max_stack_height < measure_values.current_stack_height) {
 		measure_values.max_stack_height = measure_values.current_stack_height;
+
+		//! Wchodzimy głębiej niż dotąd, więc mierzymy stos i przed jego końcem przechodzimy na wersję iteracyjną.
+		//! Tej głębokości nie zapisujemy jako osiągniętej, żeby kolejne wejście na nią też zostało sprawdzone.
+		if (stack_guard_exceeded()) {
+			measure_values.max_stack_height--;
+			measure_values.stack_fallback_count++;
+			fill_without_recursion(mouse_x, mouse_y, image, current_color, false);
+			measure_values.current_stack_height--;
+			return;
+		}
 	}
 
 	//! Sprawdzamy czy jestesmy poza widocznym obszarem.
@@ -300,12 +713,15 @@ void scanline_recursive(int mouse_x, int mouse_y, Image* image, Color_t current_
 		}
 		else {
 			swap_color(image, right_x, mouse_y);
+			RECORD_REGION_PIXEL(right_x, mouse_y, image);
+			RECORD_FILL_STEP(image);
 		}
 	}
 
 	//! Sprawdzamy piksele na lewo od badanego piksela, jeśli kolor jest taki sam jak ten, na który kliknęliśmy, zmieniamy go.
 	uint32_t left_x = mouse_x - 1;
-	for (left_x; left_x > 0 && left_x < image->width; --left_x) {
+	//! Po kolumnie 0 left_x przekręca się do UINT32_MAX, więc warunek left_x < image->width kończy też pętlę na lewej krawędzi.
+	for (left_x; left_x < image->width; --left_x) {
 
 		get_pixel_color(&current_pixel_color, left_x, mouse_y, image);
 
@@ -317,12 +733,13 @@ void scanline_recursive(int mouse_x, int mouse_y, Image* image, Color_t current_
 		}
 		else {
 			swap_color(image, left_x, mouse_y);
+			RECORD_REGION_PIXEL(left_x, mouse_y, image);
+			RECORD_FILL_STEP(image);
 		}
 	}
 
-	if (left_x != 0) {
-		++left_x;
-	}
+	//! left_x wskazuje pierwszy piksel na lewo od paska, który nie został zamalowany, albo UINT32_MAX.
+	++left_x;
 
 	//! Sprawdzamy piksele od lewej strony wypełnionego paska do prawej.
 	//! Jeśli wykryjemy powyżej lub poniżej nich wypełniany kolor, rekursywnie wykonujemy scanline_recursive().
@@ -350,6 +767,850 @@ void scanline_recursive(int mouse_x, int mouse_y, Image* image, Color_t current_
 	measure_values.current_stack_height--;
 }
 
+/*!
+* Algorytm wypełniania powierzchni połączonej także po przekątnych. Działa w sposób rekurencyjny, tak jak scanline_recursive.
+* Wypełnia poziomą linię na kolor wypełnienia, a następnie szuka pikseli do wypełnienia w wierszu wyżej i niżej,
+* w oknie szerszym o jeden piksel z każdej strony linii, bo piksele po skosie od jej końców też z nią sąsiadują.
+* Dla każdego znalezionego piksela wywołuje samą siebie.
+* \param uint32_t mouse_x Pozycja piksela na osi X.
+* \param uint32_t mouse_y Pozycja piksela na osi Y.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor obecnego piksela.
+*/
+void scanline_recursive_eight_way(uint32_t mouse_x, uint32_t mouse_y, Image* image, Color_t current_color) {
+
+	//! Zwiększamy o 1 ilość wywołań funkcji
+	measure_values.recursion_count += 1;
+	measure_values.current_stack_height++;
+	if (measure_values.max_stack_height < measure_values.current_stack_height) {
+		measure_values.max_stack_height = measure_values.current_stack_height;
+
+		//! Wchodzimy głębiej niż dotąd, więc mierzymy stos i przed jego końcem przechodzimy na wersję iteracyjną.
+		//! Tej głębokości nie zapisujemy jako osiągniętej, żeby kolejne wejście na nią też zostało sprawdzone.
+		if (stack_guard_exceeded()) {
+			measure_values.max_stack_height--;
+			measure_values.stack_fallback_count++;
+			fill_without_recursion(mouse_x, mouse_y, image, current_color, true);
+			measure_values.current_stack_height--;
+			return;
+		}
+	}
+
+	//! Sprawdzamy czy jestesmy poza widocznym obszarem.
+	if (mouse_x >= image->width || mouse_y >= image->height) {
+		//! Jesli tak, to wychodzimy z funkcji, stos rekurencyjnych wywołań zmniejsza się o 1.
+		measure_values.current_stack_height--;
+		return;
+	}
+
+	//! Sprawdzamy czy weszliśmy na kolor taki sam jakim malujemy
+	if (replacement_color.r == current_color.r && replacement_color.g == current_color.g && replacement_color.b == current_color.b) {
+		//! Jesli tak, to wychodzimy z funkcji, stos rekurencyjnych wywołań zmniejsza się o 1.
+		measure_values.current_stack_height--;
+		return;
+	}
+
+	Color_t current_pixel_color = { 0 };
+
+	//! Sprawdzamy piksele na prawo od badanego piksela, jeśli kolor jest taki sam jak ten, na który kliknęliśmy, zmieniamy go.
+	uint32_t right_x = 0;
+	for (right_x = mouse_x; right_x < image->width; ++right_x) {
+
+		get_pixel_color(&current_pixel_color, right_x, mouse_y, image);
+
+		if (current_pixel_color.r != current_color.r
+			|| current_pixel_color.g != current_color.g
+			|| current_pixel_color.b != current_color.b
+			) {
+			break;
+		}
+		else {
+			swap_color(image, right_x, mouse_y);
+			RECORD_REGION_PIXEL(right_x, mouse_y, image);
+			RECORD_FILL_STEP(image);
+		}
+	}
+
+	//! Kliknięty piksel nie był w kolorze obszaru, więc nie ma czego wypełniać.
+	if (right_x == mouse_x) {
+		measure_values.current_stack_height--;
+		return;
+	}
+
+	//! Sprawdzamy piksele na lewo od badanego piksela, jeśli kolor jest taki sam jak ten, na który kliknęliśmy, zmieniamy go.
+	uint32_t left_x = mouse_x - 1;
+	//! Po kolumnie 0 left_x przekręca się do UINT32_MAX, więc warunek left_x < image->width kończy też pętlę na lewej krawędzi.
+	for (; left_x < image->width; --left_x) {
+
+		get_pixel_color(&current_pixel_color, left_x, mouse_y, image);
+
+		if (current_pixel_color.r != current_color.r
+			|| current_pixel_color.g != current_color.g
+			|| current_pixel_color.b != current_color.b
+			) {
+			break;
+		}
+		else {
+			swap_color(image, left_x, mouse_y);
+			RECORD_REGION_PIXEL(left_x, mouse_y, image);
+			RECORD_FILL_STEP(image);
+		}
+	}
+
+	//! Okno obejmuje wypełniony pasek oraz piksel przed nim i za nim: od left_x (pierwszego niezamalowanego na lewo) do right_x włącznie.
+	//! Na lewej krawędzi left_x jest równe UINT32_MAX, a right_x na prawej równe szerokości, takie kolumny pomijamy.
+	uint32_t window_start = left_x < image->width ? left_x : 0;
+	uint32_t window_end = right_x < image->width ? right_x : image->width - 1;
+
+	//! Jeśli wykryjemy w oknie powyżej lub poniżej wypełniany kolor, rekursywnie wykonujemy scanline_recursive_eight_way().
+	for (uint32_t x = window_start; x <= window_end; ++x) {
+
+		if (mouse_y > 0) {
+			get_pixel_color(&current_pixel_color, x, mouse_y - 1, image);
+			if (
+				current_pixel_color.r == current_color.r
+				&& current_pixel_color.g == current_color.g
+				&& current_pixel_color.b == current_color.b
+				) {
+				scanline_recursive_eight_way(x, mouse_y - 1, image, current_color);
+			}
+		}
+
+		if (mouse_y + 1 < image->height) {
+			get_pixel_color(&current_pixel_color, x, mouse_y + 1, image);
+			if (
+				current_pixel_color.r == current_color.r
+				&& current_pixel_color.g == current_color.g
+				&& current_pixel_color.b == current_color.b
+				) {
+				scanline_recursive_eight_way(x, mouse_y + 1, image, current_color);
+			}
+		}
+	}
+
+	measure_values.current_stack_height--;
+}
+
+//! Kierunki ruchu malarza w kolejności obrotu w prawo: wschód, południe, zachód, północ (oś Y rośnie w dół obrazu).
+static const int32_t painter_dx[4] = { 1, 0, -1, 0 };
+static const int32_t painter_dy[4] = { 0, 1, 0, -1 };
+
+//! Stan malarza: piksel, na którym stoi, i kierunek, w którym patrzy. Prawą ręką dotyka piksela spoza obszaru.
+typedef struct Painter {
+	uint32_t x;
+	uint32_t y;
+	uint32_t direction;
+} Painter;
+
+/*!
+* Sprawdza, czy piksel należy do jeszcze niewypełnionej części obszaru. Piksele poza obrazem do niej nie należą.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor wypełnianego obszaru.
+* \param uint32_t x Pozycja X piksela, współrzędna -1 przekręca się i jest poza obrazem.
+* \param uint32_t y Pozycja Y piksela.
+* \param uint32_t skip_x Pozycja X piksela traktowanego jak już wypełniony, UINT32_MAX gdy takiego nie ma.
+* \param uint32_t skip_y Pozycja Y piksela traktowanego jak już wypełniony.
+*/
+static bool painter_inside(Image* image, Color_t current_color, uint32_t x, uint32_t y, uint32_t skip_x, uint32_t skip_y) {
+	if (x >= image->width || y >= image->height || (x == skip_x && y == skip_y)) return false;
+	Color_t pixel_color = { 0 };
+	get_pixel_color(&pixel_color, x, y, image);
+	return pixel_color.r == current_color.r && pixel_color.g == current_color.g && pixel_color.b == current_color.b;
+}
+
+/*!
+* Jeden krok po krawędzi obszaru z prawą ręką na ścianie: gdy przed malarzem jest ściana, obraca się w lewo,
+* gdy piksel po skosie z przodu po prawej należy do obszaru, wchodzi na niego i obraca się w prawo, a w pozostałych przypadkach idzie prosto.
+* \param Painter* painter Przesuwany malarz.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor wypełnianego obszaru.
+* \param uint32_t skip_x Pozycja X piksela traktowanego jak już wypełniony, UINT32_MAX gdy takiego nie ma.
+* \param uint32_t skip_y Pozycja Y piksela traktowanego jak już wypełniony.
+* \returns Obrót malarza: -1 w lewo, 0 prosto, 1 w prawo.
+*/
+static int32_t painter_step(Painter* painter, Image* image, Color_t current_color, uint32_t skip_x, uint32_t skip_y) {
+	measure_values.boundary_steps++;
+
+	uint32_t direction = painter->direction;
+	uint32_t right = (direction + 1) & 3;
+	uint32_t front_x = painter->x + painter_dx[direction];
+	uint32_t front_y = painter->y + painter_dy[direction];
+
+	if (!painter_inside(image, current_color, front_x, front_y, skip_x, skip_y)) {
+		painter->direction = (direction + 3) & 3;
+		return -1;
+	}
+
+	uint32_t corner_x = front_x + painter_dx[right];
+	uint32_t corner_y = front_y + painter_dy[right];
+	if (painter_inside(image, current_color, corner_x, corner_y, skip_x, skip_y)) {
+		painter->x = corner_x;
+		painter->y = corner_y;
+		painter->direction = right;
+		return 1;
+	}
+
+	painter->x = front_x;
+	painter->y = front_y;
+	return 0;
+}
+
+//! Sprawdza, czy dwa stany malarza są takie same.
+static bool painter_equal(const Painter* first, const Painter* second) {
+	return first->x == second->x && first->y == second->y && first->direction == second->direction;
+}
+
+/*!
+* Dzieli sąsiadów piksela należących do obszaru na grupy połączone ze sobą przez piksele po skosie.
+* Jedna grupa oznacza, że po wypełnieniu piksela reszta obszaru na pewno pozostaje spójna.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor wypełnianego obszaru.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+* \param uint8_t* groups Tablica 4 numerów grup sąsiadów w kolejności kierunków malarza, 4 dla sąsiadów spoza obszaru.
+* \returns Ilość grup, 0 gdy piksel nie ma sąsiadów w obszarze.
+*/
+static uint32_t painter_groups(Image* image, Color_t current_color, uint32_t x, uint32_t y, uint8_t* groups) {
+	bool neighbour[4];
+	bool linked[4]; //! linked[i] - sąsiedzi i oraz i + 1 są połączeni przez piksel między nimi
+	for (uint32_t i = 0; i < 4; i++) {
+		neighbour[i] = painter_inside(image, current_color, x + painter_dx[i], y + painter_dy[i], UINT32_MAX, UINT32_MAX);
+	}
+	for (uint32_t i = 0; i < 4; i++) {
+		uint32_t next = (i + 1) & 3;
+		linked[i] = neighbour[i] && neighbour[next]
+			&& painter_inside(image, current_color, x + painter_dx[i] + painter_dx[next], y + painter_dy[i] + painter_dy[next], UINT32_MAX, UINT32_MAX);
+	}
+
+	//! Zaczynamy od sąsiada, który nie jest połączony z poprzednim, jeśli taki jest.
+	uint32_t start = 4;
+	for (uint32_t i = 0; i < 4; i++) {
+		if (neighbour[i] && !linked[(i + 3) & 3]) {
+			start = i;
+			break;
+		}
+	}
+
+	uint32_t amount = 0;
+	for (uint32_t i = 0; i < 4; i++) groups[i] = 4;
+	for (uint32_t step = 0; step < 4; step++) {
+		uint32_t i = ((start == 4 ? 0 : start) + step) & 3;
+		if (!neighbour[i]) continue;
+		if (amount == 0 || !linked[(i + 3) & 3]) amount++;
+		groups[i] = (uint8_t)(amount - 1);
+	}
+	return amount;
+}
+
+/*!
+* Sprawdza, czy po wypełnieniu piksela z kilkoma grupami sąsiadów reszta obszaru pozostaje spójna.
+* Z każdej grupy rusza malarz z prawą ręką na badanym pikselu i okrąża krawędź, na której on leży.
+* Malarze idą na zmianę. Gdy któryś dotknie wszystkich grup, są one połączone.
+* Gdy któryś wróci na start bez tego, jego grupa zostałaby odcięta od pozostałych.
+* Pamięć jest stała, a czas ograniczony długością najkrótszej z obchodzonych krawędzi.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor wypełnianego obszaru.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+* \param const uint8_t* groups Numery grup sąsiadów z painter_groups.
+* \param uint32_t group_amount Ilość grup, od 2 do 4.
+*/
+static bool painter_can_remove(Image* image, Color_t current_color, uint32_t x, uint32_t y, const uint8_t* groups, uint32_t group_amount) {
+	Painter walkers[4];
+	Painter starts[4];
+	uint32_t touched[4];
+	uint32_t all_groups = (1u << group_amount) - 1;
+
+	//! Malarz w sąsiedzie w kierunku i stoi przodem w kierunku i + 1, żeby prawa ręka była na badanym pikselu.
+	for (uint32_t walker = 0; walker < group_amount; walker++) {
+		uint32_t i = 0;
+		while (groups[i] != walker) i++;
+		walkers[walker] = (Painter){ x + painter_dx[i], y + painter_dy[i], (i + 1) & 3 };
+		starts[walker] = walkers[walker];
+		touched[walker] = 1u << walker;
+	}
+
+	for (;;) {
+		for (uint32_t walker = 0; walker < group_amount; walker++) {
+			Painter* painter = &walkers[walker];
+			painter_step(painter, image, current_color, x, y);
+
+			//! Prawa ręka na badanym pikselu oznacza, że malarz stoi w jego sąsiedzie w kierunku direction - 1.
+			uint32_t right = (painter->direction + 1) & 3;
+			if (painter->x + painter_dx[right] == x && painter->y + painter_dy[right] == y) {
+				touched[walker] |= 1u << groups[(painter->direction + 3) & 3];
+				if (touched[walker] == all_groups) return true;
+			}
+			if (painter_equal(painter, &starts[walker])) return false;
+		}
+	}
+}
+
+/*!
+* Wypełnia piksel malarza i dolicza go do statystyk.
+* \param Painter* painter Malarz stojący na wypełnianym pikselu.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor wypełnianego obszaru.
+*/
+static void painter_paint(Painter* painter, Image* image, Color_t current_color) {
+	swap_color(image, painter->x, painter->y);
+	RECORD_REGION_PIXEL(painter->x, painter->y, image);
+	RECORD_FILL_STEP(image);
+}
+
+/*!
+* Ustawia malarza na zewnętrznej krawędzi obszaru. Idzie w lewo do ściany i obchodzi krawędź, licząc obroty:
+* zewnętrzna krawędź obchodzona z prawą ręką na ścianie daje cztery obroty w lewo, krawędź dziury cztery w prawo.
+* Z krawędzi dziury przechodzi na piksel na lewo od jej najbardziej wysuniętego w lewo piksela i powtarza,
+* więc malarz przesuwa się w lewo aż do zewnętrznej krawędzi.
+* \param Painter* painter Malarz stojący w obszarze, na wyjściu stoi na zewnętrznej krawędzi.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor wypełnianego obszaru.
+*/
+static void painter_find_outer_edge(Painter* painter, Image* image, Color_t current_color) {
+	for (;;) {
+		while (painter_inside(image, current_color, painter->x - 1, painter->y, UINT32_MAX, UINT32_MAX)) painter->x--;
+		painter->direction = 1; // patrzy na południe, prawa ręka na ścianie po lewej
+
+		Painter walker = *painter;
+		int32_t turns = 0;
+		uint32_t hole_x = UINT32_MAX;
+		uint32_t hole_y = 0;
+		do {
+			turns += painter_step(&walker, image, current_color, UINT32_MAX, UINT32_MAX);
+			uint32_t right = (walker.direction + 1) & 3;
+			if (walker.x + painter_dx[right] < hole_x) {
+				hole_x = walker.x + painter_dx[right];
+				hole_y = walker.y + painter_dy[right];
+			}
+		} while (!painter_equal(&walker, painter));
+
+		if (turns < 0) return;
+
+		//! Dziura leży w całości w obrazie, a piksel na lewo od niej należy do obszaru.
+		painter->x = hole_x - 1;
+		painter->y = hole_y;
+	}
+}
+
+/*!
+* Algorytm wypełniania w stałej pamięci, bez rekurencji, kolejki i mapy odwiedzonych pikseli.
+* Malarz chodzi po zewnętrznej krawędzi niewypełnionej części obszaru z prawą ręką na ścianie
+* i wypełnia piksel, na którym stoi, jeśli reszta obszaru pozostanie spójna, więc nigdy nie zamaluje sobie drogi.
+* Piksel, którego sąsiedzi są połączeni po skosie, wypełnia od razu. Gdy obejdzie całą krawędź bez wypełnienia piksela,
+* obszar ma pętlę: przez tyle kroków, ile miało okrążenie, sprawdza też pozostałe piksele w painter_can_remove
+* i wypełnia te, które pętle przerywają. Poza tym oknem nie sprawdza pikseli łączących części obszaru, bo każde sprawdzenie
+* takiego piksela kosztuje obejście mniejszej z części.
+* Zapamiętuje tylko swój stan, stan z ostatniego wypełnienia i dwa liczniki kroków. Ilość kroków po krawędzi zapisuje w boundary_steps.
+* Okrążenie ze sprawdzaniem zawsze coś wypełnia: krawędź zewnętrzna przechodzi przez drzewo bloków dwuspójnych i mostów,
+* a blok będący liściem tego drzewa ma na niej piksel należący tylko do niego - koniec mostu albo wypukły narożnik
+* zewnętrznego cyklu bloku, którego sąsiedzi spoza cyklu leżą na zewnątrz. Wypełnienie takiego piksela nie rozspójnia obszaru.
+* \param uint32_t mouse_x Pozycja piksela na osi X.
+* \param uint32_t mouse_y Pozycja piksela na osi Y.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor obecnego piksela.
+*/
+void painter_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* image, Color_t current_color) {
+
+	//! Zwiększamy o 1 ilość wywołań funkcji
+	measure_values.recursion_count += 1;
+
+	//! Sprawdzamy czy weszliśmy na kolor taki sam jakim malujemy
+	if (replacement_color.r == current_color.r && replacement_color.g == current_color.g && replacement_color.b == current_color.b) return;
+	if (!painter_inside(image, current_color, mouse_x, mouse_y, UINT32_MAX, UINT32_MAX)) return;
+
+	Painter painter = { mouse_x, mouse_y, 0 };
+	painter_find_outer_edge(&painter, image, current_color);
+
+	//! Stan po ostatnim wypełnieniu. Powrót do niego oznacza okrążenie całej krawędzi bez wypełnienia piksela.
+	Painter mark = painter;
+	uint64_t lap_steps = 0; //! kroki od ostatniego wypełnienia
+	uint64_t checking_steps = 0; //! ile jeszcze kroków sprawdzamy piksele łączące części obszaru
+
+	for (;;) {
+		uint8_t groups[4];
+		uint32_t group_amount = painter_groups(image, current_color, painter.x, painter.y, groups);
+
+		//! Piksel bez sąsiadów w obszarze jest jego ostatnim pikselem.
+		if (group_amount == 0) {
+			painter_paint(&painter, image, current_color);
+			return;
+		}
+
+		if (group_amount == 1 || (checking_steps > 0 && painter_can_remove(image, current_color, painter.x, painter.y, groups, group_amount))) {
+			painter_paint(&painter, image, current_color);
+
+			//! Przechodzimy na sąsiada w obszarze, w kolejności prawo, przód, lewo, tył, z prawą ręką na wypełnionym pikselu.
+			for (uint32_t turn = 0; turn < 4; turn++) {
+				uint32_t direction = (painter.direction + 5 - turn) & 3;
+				if (groups[direction] == 4) continue;
+				painter.x += painter_dx[direction];
+				painter.y += painter_dy[direction];
+				painter.direction = (direction + 1) & 3;
+				break;
+			}
+			mark = painter;
+			lap_steps = 0;
+			continue;
+		}
+
+		//! Idziemy po krawędzi do następnego piksela.
+		uint32_t previous_x = painter.x;
+		uint32_t previous_y = painter.y;
+		do {
+			painter_step(&painter, image, current_color, UINT32_MAX, UINT32_MAX);
+			lap_steps++;
+			if (checking_steps > 0) checking_steps--;
+			if (painter_equal(&painter, &mark)) {
+				//! Na zewnętrznej krawędzi zawsze leży piksel, którego wypełnienie nie rozspójnia obszaru, patrz opis funkcji.
+				assert(checking_steps == 0);
+				checking_steps = lap_steps;
+				lap_steps = 0;
+			}
+		} while (painter.x == previous_x && painter.y == previous_y);
+	}
+}
+
+//! Poziomy ostatniego równoległego BFS: ilość pikseli w odległości 0, 1, 2, ... od klikniętego piksela.
+static uint64_t* frontier_histogram = NULL;
+static uint64_t frontier_histogram_capacity = 0;
+
+/*!
+* Zwraca histogram poziomów ostatniego wypełniania równoległym BFS.
+* \param uint64_t* level_amount Ilość zapisanych poziomów, 0 gdy ostatnie wypełnianie nie było równoległym BFS.
+* \returns Tablica ilości pikseli na kolejnych poziomach, ważna do następnego wypełniania równoległym BFS.
+*/
+const uint64_t* bfs_frontier_histogram(uint64_t* level_amount) {
+	*level_amount = measure_values.bfs_levels < frontier_histogram_capacity ? measure_values.bfs_levels : frontier_histogram_capacity;
+	return frontier_histogram;
+}
+
+struct ParallelBfs;
+
+//! Stan jednego wątku równoległego BFS.
+typedef struct BfsWorker {
+	struct ParallelBfs* bfs;
+	uint32_t index;
+	ALLEGRO_THREAD* thread;
+	uint32_t* next; //! piksele następnego poziomu zajęte przez ten wątek
+	uint64_t next_size;
+	uint64_t next_capacity;
+	bool out_of_memory;
+	uint64_t pixel_reads;
+	uint64_t pixel_writes;
+} BfsWorker;
+
+//! Stan równoległego BFS wspólny dla wszystkich wątków.
+typedef struct ParallelBfs {
+	Image* image;
+	Color_t current_color;
+	volatile long* visited; //! bit na piksel, ustawiany atomowo przez wątek, który zajmuje piksel
+	distance_t distance; //! odległość pikseli zajmowanych w obecnym poziomie, do mapy odległości
+	uint32_t* order; //! zajęte piksele jako y * width + x, poziom po poziomie
+	uint64_t level_start; //! początek obecnego poziomu w order
+	uint64_t level_end; //! koniec obecnego poziomu w order
+	uint32_t thread_amount;
+	ALLEGRO_MUTEX* mutex;
+	ALLEGRO_COND* level_started;
+	ALLEGRO_COND* level_finished;
+	uint64_t level; //! numer poziomu przekazanego wątkom, wątki czekają na jego zmianę
+	uint32_t finished_workers;
+	bool stop;
+	BfsWorker workers[PARALLEL_BFS_MAX_THREADS];
+} ParallelBfs;
+
+/*!
+* Zajmuje piksel, jeśli jest w kolorze obszaru i nie zajął go jeszcze inny wątek, i dopisuje go do następnego poziomu wątku.
+* Kolor piksela zmienia się dopiero po ustawieniu jego bitu, więc odczyt koloru przed zajęciem nie wymaga synchronizacji.
+* \param BfsWorker* worker Wątek zajmujący piksel.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+*/
+static void bfs_claim_pixel(BfsWorker* worker, uint32_t x, uint32_t y) {
+	ParallelBfs* bfs = worker->bfs;
+	Image* image = bfs->image;
+	uint32_t index = y * image->width + x;
+	if (((unsigned long)bfs->visited[index >> 5] >> (index & 31)) & 1) return;
+
+	uint8_t* pixel = image->as_array + pixel_offset(image, x, y);
+	worker->pixel_reads++;
+	if (pixel[0] != bfs->current_color.r || pixel[1] != bfs->current_color.g || pixel[2] != bfs->current_color.b) return;
+	if (ATOMIC_BIT_TEST_AND_SET(&bfs->visited[index >> 5], index & 31)) return;
+
+	if (worker->next_size == worker->next_capacity) {
+		uint64_t capacity = worker->next_capacity ? worker->next_capacity * 2 : 1024;
+		uint32_t* next = realloc(worker->next, sizeof(uint32_t) * capacity);
+		//! Bez pamięci oddajemy piksel, dokończy go fill_without_recursion po zakończeniu poziomu.
+		if (next == NULL) {
+			ATOMIC_BIT_TEST_AND_RESET(&bfs->visited[index >> 5], index & 31);
+			worker->out_of_memory = true;
+			return;
+		}
+		worker->next = next;
+		worker->next_capacity = capacity;
+	}
+	worker->next[worker->next_size++] = index;
+	if (distance_map) distance_map[index] = bfs->distance;
+
+	pixel[0] = replacement_color.r;
+	pixel[1] = replacement_color.g;
+	pixel[2] = replacement_color.b;
+	worker->pixel_writes++;
+	//! Nagrywanie kroków działa tylko jednym wątkiem, patrz parallel_bfs_four_way.
+	RECORD_FILL_STEP(image);
+}
+
+/*!
+* Przegląda sąsiadów części obecnego poziomu przypadającej na wątek. Poziom jest dzielony na thread_amount równych części.
+* \param BfsWorker* worker Wątek przeglądający poziom.
+* \param uint32_t part_amount Na ile części dzielimy poziom, 1 gdy cały poziom przegląda jeden wątek.
+*/
+static void bfs_expand_level(BfsWorker* worker, uint32_t part_amount) {
+	ParallelBfs* bfs = worker->bfs;
+	uint64_t level_size = bfs->level_end - bfs->level_start;
+	uint64_t begin = bfs->level_start + level_size * worker->index / part_amount;
+	uint64_t end = bfs->level_start + level_size * (worker->index + 1) / part_amount;
+	uint32_t width = bfs->image->width;
+	uint32_t height = bfs->image->height;
+
+	for (uint64_t i = begin; i < end; i++) {
+		uint32_t x = bfs->order[i] % width;
+		uint32_t y = bfs->order[i] / width;
+		if (x > 0) bfs_claim_pixel(worker, x - 1, y); // lewo
+		if (y > 0) bfs_claim_pixel(worker, x, y - 1); // gora
+		if (x < width - 1) bfs_claim_pixel(worker, x + 1, y); // prawo
+		if (y < height - 1) bfs_claim_pixel(worker, x, y + 1); // dol
+	}
+}
+
+/*!
+* Wątek równoległego BFS: czeka na kolejny poziom, przegląda swoją część i zgłasza jej zakończenie.
+* \param ALLEGRO_THREAD* thread Wątek Allegro.
+* \param void* arg Struktura BfsWorker wątku.
+*/
+static void* parallel_bfs_thread(ALLEGRO_THREAD* thread, void* arg) {
+	BfsWorker* worker = arg;
+	ParallelBfs* bfs = worker->bfs;
+	uint64_t level = 0;
+
+	al_lock_mutex(bfs->mutex);
+	for (;;) {
+		while (bfs->level == level && !bfs->stop) al_wait_cond(bfs->level_started, bfs->mutex);
+		if (bfs->stop) break;
+		level = bfs->level;
+		al_unlock_mutex(bfs->mutex);
+
+		bfs_expand_level(worker, bfs->thread_amount);
+
+		al_lock_mutex(bfs->mutex);
+		if (++bfs->finished_workers == bfs->thread_amount - 1) al_signal_cond(bfs->level_finished);
+	}
+	al_unlock_mutex(bfs->mutex);
+	return NULL;
+}
+
+/*!
+* Dopisuje ilość pikseli poziomu do histogramu poziomów. Gdy brakuje pamięci, histogram kończy się na wcześniejszych poziomach.
+* \param uint64_t level Numer poziomu, czyli odległość jego pikseli od klikniętego piksela.
+* \param uint64_t size Ilość pikseli poziomu.
+*/
+static void record_frontier_size(uint64_t level, uint64_t size) {
+	if (level >= frontier_histogram_capacity) {
+		uint64_t capacity = frontier_histogram_capacity ? frontier_histogram_capacity * 2 : 256;
+		uint64_t* histogram = realloc(frontier_histogram, sizeof(uint64_t) * capacity);
+		if (histogram == NULL) return;
+		frontier_histogram = histogram;
+		frontier_histogram_capacity = capacity;
+	}
+	frontier_histogram[level] = size;
+}
+
+/*!
+* Algorytm wypełniania przeszukiwaniem wszerz, przetwarzający cały poziom (piksele w tej samej odległości od klikniętego) naraz
+* na kilku wątkach. Każdy wątek przegląda sąsiadów swojej części poziomu, zajmuje piksele atomowym ustawieniem bitu
+* w mapie odwiedzonych pikseli i zapisuje je do własnego bufora następnego poziomu. Po zakończeniu poziomu bufory
+* są dopisywane do wspólnej tablicy, w której piksele ułożone są według odległości od klikniętego piksela.
+* Małe poziomy, oraz wszystkie podczas wizualizacji i nagrywania kroków, przetwarza sam wątek wywołujący.
+* Ilość pikseli na każdym poziomie zwraca bfs_frontier_histogram, a numer poziomu piksela, przy włączonej mapie odległości, trafia do niej. Liczniki odczytów pikseli dla mapy cieplnej nie są
+* zwiększane, bo nie są bezpieczne dla wielu wątków, a statystyki obszaru liczone są po wypełnieniu.
+* \param uint32_t mouse_x Pozycja piksela na osi X.
+* \param uint32_t mouse_y Pozycja piksela na osi Y.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor obecnego piksela.
+*/
+void parallel_bfs_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* image, Color_t current_color) {
+
+	//! Zwiększamy o 1 ilość wywołań funkcji
+	measure_values.recursion_count += 1;
+
+	//! Sprawdzamy czy weszliśmy na kolor taki sam jakim malujemy
+	if (replacement_color.r == current_color.r && replacement_color.g == current_color.g && replacement_color.b == current_color.b) return;
+	if (mouse_x >= image->width || mouse_y >= image->height) return;
+
+	//! Piksele numerujemy liczbami 32-bitowymi, większe obrazy, tak jak brak pamięci, wypełniamy kolejką.
+	uint64_t pixel_amount = (uint64_t)image->width * image->height;
+	ParallelBfs* bfs = calloc(1, sizeof(ParallelBfs));
+	if (bfs == NULL || pixel_amount > UINT32_MAX) {
+		free(bfs);
+		queue_based_four_way(mouse_x, mouse_y, image, current_color);
+		return;
+	}
+	bfs->image = image;
+	bfs->current_color = current_color;
+	bfs->visited = calloc((pixel_amount + 31) / 32, sizeof(long));
+	bfs->order = malloc(sizeof(uint32_t) * pixel_amount);
+	bfs->mutex = al_create_mutex();
+	bfs->level_started = al_create_cond();
+	bfs->level_finished = al_create_cond();
+	if (bfs->visited == NULL || bfs->order == NULL || bfs->mutex == NULL || bfs->level_started == NULL || bfs->level_finished == NULL) {
+		if (bfs->mutex) al_destroy_mutex(bfs->mutex);
+		if (bfs->level_started) al_destroy_cond(bfs->level_started);
+		if (bfs->level_finished) al_destroy_cond(bfs->level_finished);
+		free((void*)bfs->visited);
+		free(bfs->order);
+		free(bfs);
+		queue_based_four_way(mouse_x, mouse_y, image, current_color);
+		return;
+	}
+
+	//! Wątek wywołujący jest wątkiem 0. Nagrywanie kroków wywołuje funkcje Allegro, więc wtedy nie uruchamiamy innych wątków.
+	int cpu_count = al_get_cpu_count();
+	bfs->thread_amount = fill_step || cpu_count < 1 ? 1 : cpu_count < PARALLEL_BFS_MAX_THREADS ? cpu_count : PARALLEL_BFS_MAX_THREADS;
+	for (uint32_t i = 0; i < bfs->thread_amount; i++) {
+		bfs->workers[i].bfs = bfs;
+		bfs->workers[i].index = i;
+	}
+	for (uint32_t i = 1; i < bfs->thread_amount; i++) {
+		bfs->workers[i].thread = al_create_thread(parallel_bfs_thread, &bfs->workers[i]);
+		if (bfs->workers[i].thread == NULL) {
+			bfs->thread_amount = i;
+			break;
+		}
+		al_start_thread(bfs->workers[i].thread);
+	}
+	measure_values.bfs_threads = bfs->thread_amount;
+
+	//! Poziom 0 to sam kliknięty piksel.
+	bfs->level_end = 0;
+	BfsWorker* caller = &bfs->workers[0];
+	bfs_claim_pixel(caller, mouse_x, mouse_y);
+	if (caller->next_size > 0) bfs->order[0] = caller->next[0];
+	bfs->level_end = caller->next_size;
+	caller->next_size = 0;
+
+	bool out_of_memory = caller->out_of_memory;
+	uint64_t expanded_start = 0; //! początek ostatnio przeglądanego poziomu
+	while (bfs->level_end > bfs->level_start && !out_of_memory) {
+		expanded_start = bfs->level_start;
+		uint64_t level_size = bfs->level_end - bfs->level_start;
+		record_frontier_size(measure_values.bfs_levels, level_size);
+		measure_values.bfs_levels++;
+		bfs->distance = measure_values.bfs_levels < DISTANCE_UNREACHED ? (distance_t)measure_values.bfs_levels : DISTANCE_UNREACHED - 1;
+		if (level_size > measure_values.bfs_max_frontier) measure_values.bfs_max_frontier = level_size;
+
+		if (bfs->thread_amount > 1 && level_size >= PARALLEL_BFS_MIN_FRONTIER) {
+			al_lock_mutex(bfs->mutex);
+			bfs->level++;
+			bfs->finished_workers = 0;
+			al_broadcast_cond(bfs->level_started);
+			al_unlock_mutex(bfs->mutex);
+
+			bfs_expand_level(caller, bfs->thread_amount);
+
+			al_lock_mutex(bfs->mutex);
+			while (bfs->finished_workers < bfs->thread_amount - 1) al_wait_cond(bfs->level_finished, bfs->mutex);
+			al_unlock_mutex(bfs->mutex);
+		}
+		else {
+			bfs_expand_level(caller, 1);
+		}
+
+		//! Bufory wątków dopisujemy za obecnym poziomem, tworzą razem następny poziom.
+		bfs->level_start = bfs->level_end;
+		for (uint32_t i = 0; i < bfs->thread_amount; i++) {
+			BfsWorker* worker = &bfs->workers[i];
+			if (worker->next_size > 0) memcpy(bfs->order + bfs->level_end, worker->next, sizeof(uint32_t) * worker->next_size);
+			bfs->level_end += worker->next_size;
+			worker->next_size = 0;
+			out_of_memory |= worker->out_of_memory;
+		}
+	}
+
+	al_lock_mutex(bfs->mutex);
+	bfs->stop = true;
+	al_broadcast_cond(bfs->level_started);
+	al_unlock_mutex(bfs->mutex);
+	for (uint32_t i = 0; i < bfs->thread_amount; i++) {
+		if (bfs->workers[i].thread) al_destroy_thread(bfs->workers[i].thread);
+#if MEASURE_PIXEL_ACCESSES
+		measure_values.pixel_reads += bfs->workers[i].pixel_reads;
+		measure_values.pixel_writes += bfs->workers[i].pixel_writes;
+#endif
+		free(bfs->workers[i].next);
+	}
+
+	//! Statystyki obszaru liczymy dopiero teraz, jednym wątkiem.
+	for (uint64_t i = 0; i < bfs->level_end; i++) {
+		RECORD_REGION_PIXEL(bfs->order[i] % image->width, bfs->order[i] / image->width, image);
+	}
+	if (distance_map) {
+		for (uint64_t i = 0; i < bfs->level_end; i++) mark_distance_map_dirty(bfs->order[i], bfs->order[i]);
+	}
+
+	//! Po braku pamięci kończymy wypełnianie od sąsiadów dwóch ostatnich poziomów, wśród nich są piksele oddane przez wątki.
+	if (out_of_memory) {
+		fill_without_recursion(mouse_x, mouse_y, image, current_color, false);
+		for (uint64_t i = expanded_start; i < bfs->level_end; i++) {
+			uint32_t x = bfs->order[i] % image->width;
+			uint32_t y = bfs->order[i] / image->width;
+			fill_without_recursion(x - 1, y, image, current_color, false);
+			fill_without_recursion(x + 1, y, image, current_color, false);
+			fill_without_recursion(x, y - 1, image, current_color, false);
+			fill_without_recursion(x, y + 1, image, current_color, false);
+		}
+	}
+
+	al_destroy_cond(bfs->level_started);
+	al_destroy_cond(bfs->level_finished);
+	al_destroy_mutex(bfs->mutex);
+	free((void*)bfs->visited);
+	free(bfs->order);
+	free(bfs);
+}
+
+/*!
+* Jedno przejście rastra algorytmu raster_sweep_four_way. Przejście w przód idzie wiersz po wierszu w dół, w tył - w górę.
+* W każdym wierszu piksele obszaru przejmują flagę osiągnięcia najpierw od wiersza poprzedniego w kierunku przejścia,
+* a gdy coś przejęły, także od sąsiadów w wierszu, w prawo i w lewo. Pętla po wierszu poprzednim i liczenie osiągniętych pikseli nie mają
+* rozgałęzień ani zależności między pikselami, więc kompilator może je zwektoryzować. Przejścia po wierszu są sekwencyjne, ale też bez rozgałęzień.
+* Przejście zaczyna się od pierwszego wiersza z osiągniętymi pikselami i kończy na pustym wierszu za ostatnim z nich.
+* \param const uint8_t* inside Dla każdego piksela 1, jeśli ma kolor obszaru, inaczej 0.
+* \param uint8_t* reached Dla każdego piksela 1, jeśli został osiągnięty z klikniętego piksela, inaczej 0.
+* \param uint32_t* row_counts Ilość osiągniętych pikseli w każdym wierszu.
+* \param uint32_t width Szerokość obrazu.
+* \param uint32_t height Wysokość obrazu.
+* \param bool forward true dla przejścia w dół, false dla przejścia w górę.
+* \param uint32_t* first_row Pierwszy wiersz z osiągniętymi pikselami, aktualizowany po przejściu.
+* \param uint32_t* last_row Ostatni wiersz z osiągniętymi pikselami, aktualizowany po przejściu.
+* \returns Ilość pikseli osiągniętych w tym przejściu.
+*/
+static uint64_t raster_sweep(const uint8_t* inside, uint8_t* reached, uint32_t* row_counts, uint32_t width, uint32_t height, bool forward, uint32_t* first_row, uint32_t* last_row) {
+	uint64_t changed = 0;
+	uint32_t start = forward ? *first_row : *last_row;
+	uint32_t end = forward ? *last_row : *first_row; //! za tym wierszem przejście kończy się na pierwszym pustym wierszu
+
+	for (uint32_t y = start; y < height; y += forward ? 1 : -1) {
+		uint8_t* row = reached + (uint64_t)y * width;
+		const uint8_t* row_inside = inside + (uint64_t)y * width;
+
+		//! Wiersz po przejściu jest domknięty w poziomie, więc jeśli poprzedni wiersz nic do niego nie dodał, nie przechodzimy go dalej.
+		uint8_t added = 0;
+		if (y != start) {
+			const uint8_t* previous = forward ? row - width : row + width;
+			for (uint32_t x = 0; x < width; x++) {
+				uint8_t next = row_inside[x] & previous[x] & (row[x] ^ 1);
+				added |= next;
+				row[x] |= next;
+			}
+		}
+
+		uint32_t count = row_counts[y];
+		if (y == start || added) {
+			for (uint32_t x = 1; x < width; x++) row[x] |= row_inside[x] & row[x - 1];
+			for (uint32_t x = width - 1; x > 0; x--) row[x - 1] |= row_inside[x - 1] & row[x];
+
+			count = 0;
+			for (uint32_t x = 0; x < width; x++) count += row[x];
+			changed += count - row_counts[y];
+			row_counts[y] = count;
+		}
+
+		if (count > 0) {
+			if (y < *first_row) *first_row = y;
+			if (y > *last_row) *last_row = y;
+		}
+		//! Za ostatnim osiągniętym wierszem pusty wiersz zatrzymuje przejście, dalej nic nie może się zmienić.
+		else if (forward ? y > end : y < end) {
+			break;
+		}
+	}
+	return changed;
+}
+
+/*!
+* Algorytm wypełniania przejściami rastra, bez kolejki i stosu. Zaznacza kliknięty piksel jako osiągnięty, a następnie na zmianę
+* przechodzi obraz w dół i w górę, przenosząc flagę osiągnięcia na piksele obszaru sąsiadujące z osiągniętymi.
+* Kończy, gdy przejście nie osiągnie żadnego nowego piksela, i wypełnia osiągnięte piksele.
+* Obszar wypukły wymaga dwóch lub trzech przejść, ale każdy zakręt obszaru, który wraca w górę, na przykład spirala, kosztuje kolejne przejście.
+* Ilość przejść zapisuje w polu sweep_count struktury MeasureValues.
+* \param uint32_t mouse_x Pozycja piksela na osi X.
+* \param uint32_t mouse_y Pozycja piksela na osi Y.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor obecnego piksela.
+*/
+void raster_sweep_four_way(uint32_t mouse_x, uint32_t mouse_y, Image* image, Color_t current_color) {
+
+	//! Zwiększamy o 1 ilość wywołań funkcji
+	measure_values.recursion_count += 1;
+
+	//! Sprawdzamy czy weszliśmy na kolor taki sam jakim malujemy
+	if (replacement_color.r == current_color.r && replacement_color.g == current_color.g && replacement_color.b == current_color.b) return;
+	if (mouse_x >= image->width || mouse_y >= image->height) return;
+
+	//! Bez pamięci na flagi wypełniamy kolejką.
+	uint64_t pixel_amount = (uint64_t)image->width * image->height;
+	uint8_t* inside = malloc(pixel_amount);
+	uint8_t* reached = calloc(pixel_amount, 1);
+	uint32_t* row_counts = calloc(image->height, sizeof(uint32_t));
+	if (inside == NULL || reached == NULL || row_counts == NULL) {
+		free(inside);
+		free(reached);
+		free(row_counts);
+		queue_based_four_way(mouse_x, mouse_y, image, current_color);
+		return;
+	}
+
+	//! Kolory pikseli odczytujemy raz, przejścia korzystają już tylko z flag.
+	for (uint32_t y = 0; y < image->height; y++) {
+		for (uint32_t x = 0; x < image->width; x++) {
+			Color_t pixel_color = { 0 };
+			get_pixel_color(&pixel_color, x, y, image);
+			inside[(uint64_t)y * image->width + x] = pixel_color.r == current_color.r && pixel_color.g == current_color.g && pixel_color.b == current_color.b;
+		}
+	}
+
+	uint64_t seed = (uint64_t)mouse_y * image->width + mouse_x;
+	if (inside[seed]) {
+		reached[seed] = 1;
+		row_counts[mouse_y] = 1;
+		uint32_t first_row = mouse_y;
+		uint32_t last_row = mouse_y;
+
+		//! Przejście bez zmian po innym przejściu oznacza, że flagi są domknięte w obu kierunkach.
+		bool forward = true;
+		uint64_t changed;
+		do {
+			changed = raster_sweep(inside, reached, row_counts, image->width, image->height, forward, &first_row, &last_row);
+			measure_values.sweep_count++;
+			forward = !forward;
+		} while (changed > 0 || measure_values.sweep_count == 1);
+
+		for (uint32_t y = first_row; y <= last_row; y++) {
+			const uint8_t* row = reached + (uint64_t)y * image->width;
+			for (uint32_t x = 0; x < image->width; x++) {
+				if (!row[x]) continue;
+				swap_color(image, x, y);
+				RECORD_REGION_PIXEL(x, y, image);
+				RECORD_FILL_STEP(image);
+			}
+		}
+	}
+
+	free(inside);
+	free(reached);
+	free(row_counts);
+}
+
 /*!
 * Algorytm wypełniający powierzchnię.
 * Zmienia kolor obecnego piksela, a następnie wywołuje samą siebie dla sąsiednich pikseli.
@@ -401,7 +1662,7 @@ void stack_based_recursive_four_way_visualize(uint32_t mouse_x, uint32_t mouse_y
 		* Po zmianie koloru piksela zapisujemy zdjęcie, czekamy chwilę(żeby poprawnie pokazać wypełnianie krok po kroku),
 		* ponownie ładujemy zdjęcie i wyświetlamy je oraz prawy panel z wynikami
 		*/
-		save_image_to_bmp("Images/Result.bmp", image->as_array, image->stb_x, image->stb_y, image->stb_comp);
+		save_image_to_bmp("Images/Result.bmp", image);
 		al_rest(0.1);
 		al_destroy_bitmap(image->image);
 		image->image = al_load_bitmap("Images/Result.bmp");
@@ -488,7 +1749,7 @@ void stack_based_recursive_eight_way_visualize(uint32_t mouse_x, uint32_t mouse_
 		&& current_pixel_color.b == current_color.b
 		) {
 		swap_color(image, mouse_x, mouse_y);
-		save_image_to_bmp("Images/Result.bmp", image->as_array, image->stb_x, image->stb_y, image->stb_comp);
+		save_image_to_bmp("Images/Result.bmp", image);
 		al_rest(0.1);
 		al_destroy_bitmap(image->image);
 		image->image = al_load_bitmap("Images/Result.bmp");
@@ -584,7 +1845,7 @@ void queue_based_four_way_visualize(uint32_t mouse_x, uint32_t mouse_y, Image* i
 			&& current_color.b == current_pixel_color.b
 			) {
 			swap_color(image, position_x, position_y);
-			save_image_to_bmp("Images/Result.bmp", image->as_array, image->stb_x, image->stb_y, image->stb_comp);
+			save_image_to_bmp("Images/Result.bmp", image);
 			al_rest(0.1);
 			al_destroy_bitmap(image->image);
 			image->image = al_load_bitmap("Images/Result.bmp");
@@ -682,7 +1943,7 @@ void scanline_recursive_visualize(int mouse_x, int mouse_y, Image* image, Color_
 		}
 	}
 	uint32_t left_x = mouse_x - 1;
-	for (left_x; left_x >= 0 && left_x < image->width; --left_x) {
+	for (left_x; left_x < image->width; --left_x) {
 
 		get_pixel_color(&current_pixel_color, left_x, mouse_y, image);
 
@@ -698,9 +1959,8 @@ void scanline_recursive_visualize(int mouse_x, int mouse_y, Image* image, Color_
 	}
 
 
-	if (left_x != 0) {
-		++left_x;
-	}
+	//! left_x wskazuje pierwszy piksel na lewo od paska, który nie został zamalowany, albo UINT32_MAX.
+	++left_x;
 
 	//! Sprawdzamy piksele od lewej strony wypełnionego paska do prawej.
 	//! Jeśli wykryjemy powyżej lub poniżej nich wypełniany kolor, rekursywnie wykonujemy scanline_recursive().
@@ -714,7 +1974,7 @@ void scanline_recursive_visualize(int mouse_x, int mouse_y, Image* image, Color_
 			&& current_pixel_color.b == current_color.b
 			) {
 			//------------------------////
-			save_image_to_bmp("Images/Result.bmp", image->as_array, image->stb_x, image->stb_y, image->stb_comp);
+			save_image_to_bmp("Images/Result.bmp", image);
 			al_rest(0.1);
 			al_destroy_bitmap(image->image);
 			image->image = al_load_bitmap("Images/Result.bmp");
@@ -745,7 +2005,7 @@ void scanline_recursive_visualize(int mouse_x, int mouse_y, Image* image, Color_
 			&& current_pixel_color.b == current_color.b
 			) {
 			//------------------------////
-			save_image_to_bmp("Images/Result.bmp", image->as_array, image->stb_x, image->stb_y, image->stb_comp);
+			save_image_to_bmp("Images/Result.bmp", image);
 			al_rest(0.1);
 			al_destroy_bitmap(image->image);
 			image->image = al_load_bitmap("Images/Result.bmp");
@@ -772,4 +2032,429 @@ void scanline_recursive_visualize(int mouse_x, int mouse_y, Image* image, Color_
 	}
 
 	measure_values.current_stack_height--;
+}
+
+//! Współrzędne piksela przechowywane na stosie roboczym wypełniania wsadowego.
+typedef struct BatchPoint {
+	uint32_t x;
+	uint32_t y;
+} BatchPoint;
+
+//! Stos roboczy wypełniania wsadowego, jego pamięć jest współdzielona przez wszystkie punkty startowe.
+typedef struct BatchStack {
+	BatchPoint* points;
+	uint64_t size;
+	uint64_t capacity;
+} BatchStack;
+
+/*!
+* Funkcja odkładająca współrzędne piksela na stos roboczy. W razie potrzeby podwaja jego pojemność.
+* \param BatchStack* stack Stos roboczy.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+* \returns true dla powodzenia operacji, false dla niepowodzenia.
+*/
+static bool batch_push(BatchStack* stack, uint32_t x, uint32_t y) {
+	if (stack->size == stack->capacity) {
+		uint64_t new_capacity = stack->capacity ? stack->capacity * 2 : 1024;
+		BatchPoint* new_points = realloc(stack->points, sizeof(BatchPoint) * new_capacity);
+		if (new_points == NULL) return false;
+		stack->points = new_points;
+		stack->capacity = new_capacity;
+	}
+	stack->points[stack->size].x = x;
+	stack->points[stack->size].y = y;
+	stack->size++;
+	return true;
+}
+
+/*!
+* Sprawdza, czy piksel można dołączyć do wypełnianego obszaru:
+* nie był jeszcze odwiedzony w obecnym wsadzie i ma taki sam kolor jak kliknięty piksel.
+* \param Image* image Badany obraz.
+* \param uint8_t* visited Mapa bitowa odwiedzonych pikseli.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+* \param Color_t current_color Kolor obszaru.
+*/
+static bool batch_should_fill(Image* image, uint8_t* visited, uint32_t x, uint32_t y, Color_t current_color) {
+	uint64_t index = (uint64_t)y * image->width + x;
+	if (visited[index >> 3] & (1 << (index & 7))) return false;
+
+	Color_t current_pixel_color = { 0 };
+	get_pixel_color(&current_pixel_color, x, y, image);
+	return current_pixel_color.r == current_color.r
+		&& current_pixel_color.g == current_color.g
+		&& current_pixel_color.b == current_color.b;
+}
+
+/*!
+* Zgłasza przerwanie wypełniania iteracyjnego z braku pamięci na stos roboczy: dolicza je do incomplete_fills
+* w strukturze MeasureValues, a przy pierwszym przerwaniu w wypełnianiu wypisuje błąd, bo obszar zostaje wypełniony tylko częściowo.
+*/
+static void report_incomplete_fill() {
+	if (measure_values.incomplete_fills++ == 0) puts("error when allocating fill stack, region filled partially\n");
+}
+
+/*!
+* Wypełnia piksel po pikselu część obszaru, której odcinka nie udało się odłożyć na wspólny stos, na osobnym, nowym stosie.
+* Tak jak batch_fill_region zaznacza piksele w mapie odwiedzonych, więc wynik jest taki sam jak bez braku pamięci.
+* \param Image* image Modyfikowany obraz.
+* \param uint8_t* visited Mapa bitowa odwiedzonych pikseli.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+* \param Color_t current_color Kolor obszaru.
+* \param Color_t color Kolor wypełnienia.
+* \param uint64_t* filled_pixels Zwiększana o ilość wypełnionych pikseli.
+* \returns false, jeśli i na ten stos zabrakło pamięci, a część obszaru nie została wypełniona.
+*/
+static bool batch_fill_separately(Image* image, uint8_t* visited, uint32_t x, uint32_t y, Color_t current_color, Color_t color, uint64_t* filled_pixels) {
+	BatchStack stack = { NULL, 0, 0 };
+	if (!batch_push(&stack, x, y)) {
+		report_incomplete_fill();
+		return false;
+	}
+
+	while (stack.size > 0) {
+		BatchPoint point = stack.points[--stack.size];
+		if (!batch_should_fill(image, visited, point.x, point.y, current_color)) continue;
+
+		uint64_t index = (uint64_t)point.y * image->width + point.x;
+		visited[index >> 3] |= 1 << (index & 7);
+		set_pixel_color(image, point.x, point.y, color);
+		(*filled_pixels)++;
+
+		if ((point.x > 0 && !batch_push(&stack, point.x - 1, point.y))
+			|| (point.x + 1 < image->width && !batch_push(&stack, point.x + 1, point.y))
+			|| (point.y > 0 && !batch_push(&stack, point.x, point.y - 1))
+			|| (point.y + 1 < image->height && !batch_push(&stack, point.x, point.y + 1))
+			) {
+			free(stack.points);
+			report_incomplete_fill();
+			return false;
+		}
+	}
+
+	free(stack.points);
+	return true;
+}
+
+/*!
+* Wypełnia jeden obszar w ramach wsadu, linia po linii, korzystając ze wspólnego stosu roboczego i mapy odwiedzonych pikseli.
+* Odwiedzone piksele są oznaczane w mapie, dzięki czemu nie ma potrzeby sprawdzania, czy kolor wypełnienia jest taki sam jak kolor obszaru.
+* Odcinek, którego nie udało się odłożyć na stos, wypełnia od razu batch_fill_separately.
+* \param Image* image Modyfikowany obraz.
+* \param uint8_t* visited Mapa bitowa odwiedzonych pikseli.
+* \param BatchStack* stack Stos roboczy.
+* \param Seed_t seed Punkt startowy i kolor wypełnienia.
+* \param uint64_t* filled_pixels Ilość wypełnionych pikseli.
+* \returns false, jeśli zabrakło pamięci na wspólny stos i część obszaru została wypełniona osobno.
+*/
+static bool batch_fill_region(Image* image, uint8_t* visited, BatchStack* stack, Seed_t seed, uint64_t* filled_pixels) {
+	*filled_pixels = 0;
+
+	Color_t current_color = { 0 };
+	get_pixel_color(&current_color, seed.x, seed.y, image);
+
+	stack->size = 0;
+	if (!batch_push(stack, seed.x, seed.y)) {
+		batch_fill_separately(image, visited, seed.x, seed.y, current_color, seed.color, filled_pixels);
+		return false;
+	}
+	bool pushed_all = true;
+
+	while (stack->size > 0) {
+		stack->size--;
+		uint32_t x = stack->points[stack->size].x;
+		uint32_t y = stack->points[stack->size].y;
+
+		if (!batch_should_fill(image, visited, x, y, current_color)) continue;
+
+		//! Szukamy lewego i prawego końca linii.
+		uint32_t left_x = x;
+		while (left_x > 0 && batch_should_fill(image, visited, left_x - 1, y, current_color)) left_x--;
+		uint32_t right_x = x;
+		while (right_x + 1 < image->width && batch_should_fill(image, visited, right_x + 1, y, current_color)) right_x++;
+
+		//! Wypełniamy linię i zaznaczamy ją jako odwiedzoną.
+		for (uint32_t i = left_x; i <= right_x; i++) {
+			uint64_t index = (uint64_t)y * image->width + i;
+			visited[index >> 3] |= 1 << (index & 7);
+			set_pixel_color(image, i, y, seed.color);
+		}
+		*filled_pixels += right_x - left_x + 1;
+
+		//! Na stos odkładamy początek każdego odcinka do wypełnienia powyżej i poniżej linii.
+		for (int32_t direction = -1; direction <= 1; direction += 2) {
+			if ((direction < 0 && y == 0) || (direction > 0 && y + 1 >= image->height)) continue;
+			uint32_t next_y = y + direction;
+			bool in_span = false;
+			for (uint32_t i = left_x; i <= right_x; i++) {
+				if (batch_should_fill(image, visited, i, next_y, current_color)) {
+					if (!in_span) {
+						if (!batch_push(stack, i, next_y)) {
+							batch_fill_separately(image, visited, i, next_y, current_color, seed.color, filled_pixels);
+							pushed_all = false;
+						}
+						in_span = true;
+					}
+				}
+				else {
+					in_span = false;
+				}
+			}
+		}
+	}
+
+	return pushed_all;
+}
+
+/*!
+* Iteracyjna wersja wypełniania czterokierunkowego albo ośmiokierunkowego, na którą przechodzą algorytmy rekurencyjne,
+* gdy kończy im się stos, a także wypełnianie wielu punktów bez mapy odwiedzonych i równoległy BFS bez pamięci na kolejkę.
+* Zamiast stosu wywołań korzysta ze stosu roboczego na stercie. Przejścia algorytmów rekurencyjnych liczą one same w stack_fallback_count.
+* Gdy zabraknie pamięci na stos roboczy, wypełnianie jest przerywane i zgłaszane przez report_incomplete_fill.
+* \param uint32_t x Pozycja X piksela, od którego wypełnianie jest kontynuowane.
+* \param uint32_t y Pozycja Y piksela, od którego wypełnianie jest kontynuowane.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t current_color Kolor wypełnianego obszaru.
+* \param bool eight_way true dla sąsiedztwa ośmiokierunkowego, false dla czterokierunkowego.
+* \returns Ilość wypełnionych pikseli.
+*/
+static uint64_t fill_without_recursion(uint32_t x, uint32_t y, Image* image, Color_t current_color, bool eight_way) {
+	if (x >= image->width || y >= image->height) return 0;
+	if (replacement_color.r == current_color.r && replacement_color.g == current_color.g && replacement_color.b == current_color.b) return 0;
+
+	uint64_t filled_pixels = 0;
+	BatchStack stack = { NULL, 0, 0 };
+	if (!batch_push(&stack, x, y)) {
+		report_incomplete_fill();
+		return 0;
+	}
+
+	while (stack.size > 0) {
+		BatchPoint point = stack.points[--stack.size];
+
+		Color_t current_pixel_color = { 0 };
+		get_pixel_color(&current_pixel_color, point.x, point.y, image);
+		if (current_pixel_color.r != current_color.r
+			|| current_pixel_color.g != current_color.g
+			|| current_pixel_color.b != current_color.b
+			) {
+			continue;
+		}
+
+		swap_color(image, point.x, point.y);
+		RECORD_REGION_PIXEL(point.x, point.y, image);
+		RECORD_FILL_STEP(image);
+		filled_pixels++;
+
+		//! Sąsiadów poza obrazem (także po przekręceniu się współrzędnej 0 - 1) pomijamy.
+		for (int32_t dy = -1; dy <= 1; dy++) {
+			for (int32_t dx = -1; dx <= 1; dx++) {
+				if ((dx == 0 && dy == 0) || (!eight_way && dx != 0 && dy != 0)) continue;
+				uint32_t next_x = point.x + dx;
+				uint32_t next_y = point.y + dy;
+				if (next_x >= image->width || next_y >= image->height) continue;
+				if (!batch_push(&stack, next_x, next_y)) {
+					free(stack.points);
+					report_incomplete_fill();
+					return filled_pixels;
+				}
+			}
+		}
+	}
+
+	free(stack.points);
+	return filled_pixels;
+}
+
+/*!
+* Wypełnianie wsadowe. Dla każdego punktu startowego z tablicy seeds wypełnia jego obszar kolorem z tego punktu.
+* Wszystkie punkty korzystają z jednej mapy bitowej odwiedzonych pikseli oraz jednego stosu roboczego.
+* Punkt, który trafia w obszar wypełniony przez wcześniejszy punkt, jest pomijany i oznaczany w statystykach.
+* Obszary wyznaczane są na podstawie kolorów sprzed wypełniania, kolejne punkty nie łączą się z obszarami już wypełnionymi.
+* Gdy zabraknie pamięci na stos, część obszaru wypełnia osobno batch_fill_separately. Gdy zabraknie jej na mapę odwiedzonych pikseli,
+* każdy punkt jest wypełniany jak osobnym flood_fill, a obszary wyznaczają kolory po poprzednich wypełnieniach.
+* Oba przypadki są oznaczane w SeedStats::fell_back, a obszar, któremu pamięci zabrakło także na osobne wypełnianie, w SeedStats::incomplete.
+* \param Seed_t* seeds Tablica punktów startowych.
+* \param uint32_t seed_amount Ilość punktów startowych.
+* \param Image* image Modyfikowany obraz.
+* \param SeedStats* stats Tablica o długości seed_amount na statystyki każdego punktu, może być NULL.
+* \returns Ilość wypełnionych obszarów.
+*/
+uint32_t flood_fill_batch(Seed_t* seeds, uint32_t seed_amount, Image* image, SeedStats* stats) {
+	uint64_t pixel_amount = (uint64_t)image->width * image->height;
+	uint8_t* visited = calloc((pixel_amount + 7) / 8, 1);
+
+	BatchStack stack = { NULL, 0, 0 };
+	uint32_t filled_regions = 0;
+	measure_values.incomplete_fills = 0;
+
+	for (uint32_t i = 0; i < seed_amount; i++) {
+		SeedStats seed_stats = { 0 };
+
+		if (seeds[i].x < image->width && seeds[i].y < image->height) {
+			uint64_t index = (uint64_t)seeds[i].y * image->width + seeds[i].x;
+			seed_stats.already_filled = visited && (visited[index >> 3] & (1 << (index & 7))) != 0;
+
+			if (!seed_stats.already_filled) {
+				uint64_t incomplete_fills = measure_values.incomplete_fills;
+				uint64_t clock_start = __rdtsc();
+				if (visited) {
+					seed_stats.fell_back = !batch_fill_region(image, visited, &stack, seeds[i], &seed_stats.filled_pixels);
+				}
+				else {
+					Color_t current_color = { 0 };
+					get_pixel_color(&current_color, seeds[i].x, seeds[i].y, image);
+					Color_t previous_replacement_color = replacement_color;
+					replacement_color = seeds[i].color;
+					seed_stats.filled_pixels = fill_without_recursion(seeds[i].x, seeds[i].y, image, current_color, false);
+					replacement_color = previous_replacement_color;
+					seed_stats.fell_back = true;
+				}
+				seed_stats.clock_cycle_count = __rdtsc() - clock_start;
+				seed_stats.incomplete = measure_values.incomplete_fills != incomplete_fills;
+				filled_regions++;
+			}
+		}
+
+		if (stats != NULL) stats[i] = seed_stats;
+	}
+
+	free(stack.points);
+	free(visited);
+	return filled_regions;
+}
+
+/*!
+* Funkcja szukająca reprezentanta etykiety w strukturze zbiorów rozłącznych, przy okazji skraca ścieżkę do korzenia.
+* \param uint32_t* parent Tablica rodziców etykiet.
+* \param uint32_t label Szukana etykieta.
+* \returns Etykieta będąca korzeniem zbioru.
+*/
+static uint32_t find_label_root(uint32_t* parent, uint32_t label) {
+	while (parent[label] != label) {
+		parent[label] = parent[parent[label]];
+		label = parent[label];
+	}
+	return label;
+}
+
+/*!
+* Funkcja łącząca dwa zbiory etykiet. Korzeniem zostaje mniejsza etykieta, dzięki czemu kolejność obszarów odpowiada kolejności ich pojawienia się w obrazie.
+* \param uint32_t* parent Tablica rodziców etykiet.
+* \param uint32_t first Pierwsza etykieta.
+* \param uint32_t second Druga etykieta.
+* \returns Etykieta będąca korzeniem połączonego zbioru.
+*/
+static uint32_t union_labels(uint32_t* parent, uint32_t first, uint32_t second) {
+	first = find_label_root(parent, first);
+	second = find_label_root(parent, second);
+	if (first < second) {
+		parent[second] = first;
+		return first;
+	}
+	parent[first] = second;
+	return second;
+}
+
+/*!
+* Wypełnia każdy spójny (czterokierunkowo) obszar obrazu innym kolorem, bez szukania punktów startowych.
+* Obraz jest przeglądany jeden raz wiersz po wierszu, każdy piksel porównywany jest z sąsiadem po lewej i powyżej,
+* a połączone etykiety łączone są w strukturze zbiorów rozłącznych.
+* Drugi przebieg po tablicy etykiet nadaje obszarom kolejne numery od 0 i zmienia kolory pikseli.
+* \param Image* image Modyfikowany obraz.
+* \param Color_t* palette Paleta kolorów, obszar o numerze n dostaje kolor palette[n % palette_size]. Dla NULL kolor wyznaczany jest z numeru obszaru.
+* \param uint32_t palette_size Ilość kolorów w palecie.
+* \param uint32_t* labels Tablica width * height na numery obszarów każdego piksela, może być NULL.
+* \returns Ilość obszarów w obrazie.
+*/
+uint32_t fill_all_regions(Image* image, Color_t* palette, uint32_t palette_size, uint32_t* labels) {
+	uint64_t pixel_amount = (uint64_t)image->width * image->height;
+	if (pixel_amount == 0) return 0;
+
+	bool own_labels = labels == NULL;
+	if (own_labels) labels = malloc(sizeof(uint32_t) * pixel_amount);
+	//! Tymczasowych etykiet nie może być więcej niż pikseli.
+	uint32_t* parent = malloc(sizeof(uint32_t) * pixel_amount);
+	if (labels == NULL || parent == NULL) {
+		if (own_labels) free(labels);
+		free(parent);
+		return 0;
+	}
+
+	uint32_t next_label = 0;
+	Color_t pixel_color = { 0 };
+	Color_t left_color = { 0 };
+	Color_t up_color = { 0 };
+
+	//! Pierwszy przebieg: tymczasowe etykiety i łączenie sąsiednich obszarów o tym samym kolorze.
+	for (uint32_t y = 0; y < image->height; y++) {
+		for (uint32_t x = 0; x < image->width; x++) {
+			uint64_t index = (uint64_t)y * image->width + x;
+			get_pixel_color(&pixel_color, x, y, image);
+
+			bool same_as_left = false;
+			bool same_as_up = false;
+			if (x > 0) {
+				get_pixel_color(&left_color, x - 1, y, image);
+				same_as_left = left_color.r == pixel_color.r && left_color.g == pixel_color.g && left_color.b == pixel_color.b;
+			}
+			if (y > 0) {
+				get_pixel_color(&up_color, x, y - 1, image);
+				same_as_up = up_color.r == pixel_color.r && up_color.g == pixel_color.g && up_color.b == pixel_color.b;
+			}
+
+			if (same_as_left && same_as_up) {
+				labels[index] = union_labels(parent, labels[index - 1], labels[index - image->width]);
+			}
+			else if (same_as_left) {
+				labels[index] = labels[index - 1];
+			}
+			else if (same_as_up) {
+				labels[index] = labels[index - image->width];
+			}
+			else {
+				parent[next_label] = next_label;
+				labels[index] = next_label++;
+			}
+		}
+	}
+
+	//! Spłaszczamy zbiory, korzeń jest zawsze mniejszy od pozostałych etykiet zbioru, więc wystarczy przejście w kolejności rosnącej.
+	for (uint32_t label = 0; label < next_label; label++) {
+		parent[label] = parent[parent[label]];
+	}
+
+	//! Korzenie zbiorów dostają kolejne numery obszarów, pozostałe etykiety numer swojego korzenia.
+	uint32_t region_amount = 0;
+	for (uint32_t label = 0; label < next_label; label++) {
+		parent[label] = parent[label] == label ? region_amount++ : parent[parent[label]];
+	}
+
+	//! Drugi przebieg: ostateczne numery obszarów i nowe kolory pikseli.
+	for (uint32_t y = 0; y < image->height; y++) {
+		for (uint32_t x = 0; x < image->width; x++) {
+			uint64_t index = (uint64_t)y * image->width + x;
+			uint32_t region = parent[labels[index]];
+			labels[index] = region;
+
+			Color_t color;
+			if (palette != NULL && palette_size > 0) {
+				color = palette[region % palette_size];
+			}
+			else {
+				uint32_t hash = (region + 1) * 2654435761u;
+				color.r = hash >> 24;
+				color.g = hash >> 16;
+				color.b = hash >> 8;
+			}
+			set_pixel_color(image, x, y, color);
+		}
+	}
+
+	free(parent);
+	if (own_labels) free(labels);
+	return region_amount;
 }
\ No newline at end of file
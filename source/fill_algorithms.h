@@ -3,12 +3,24 @@
 #include <stdint.h>
 
 void flood_fill(algorithm_t, uint32_t, uint32_t, Image*, Color_t);
+void finish_region_stats(const Image*);
 void stack_based_recursive_four_way(uint32_t, uint32_t, Image*, Color_t);
 void stack_based_recursive_eight_way(uint32_t, uint32_t, Image*, Color_t);
 void queue_based_four_way(uint32_t, uint32_t, Image*, Color_t);
 void scanline_recursive(uint32_t, uint32_t, uint32_t, Image*, Color_t);
+void painter_four_way(uint32_t, uint32_t, Image*, Color_t);
+void parallel_bfs_four_way(uint32_t, uint32_t, Image*, Color_t);
+void raster_sweep_four_way(uint32_t, uint32_t, Image*, Color_t);
+void scanline_recursive_eight_way(uint32_t, uint32_t, Image*, Color_t);
 
 void stack_based_recursive_four_way_visualize(uint32_t, uint32_t, Image*, Color_t);
 void stack_based_recursive_eight_way_visualize(uint32_t, uint32_t, Image*, Color_t);
 void queue_based_four_way_visualize(uint32_t, uint32_t, Image*, Color_t);
-void scanline_recursive_visualize(uint32_t, uint32_t, uint32_t, Image*, Color_t);
\ No newline at end of file
+void scanline_recursive_visualize(uint32_t, uint32_t, uint32_t, Image*, Color_t);
+uint32_t flood_fill_batch(Seed_t*, uint32_t, Image*, SeedStats*);
+uint32_t fill_all_regions(Image*, Color_t*, uint32_t, uint32_t*);
+void set_fill_step_callback(fill_step_t);
+uint64_t filled_pixel_amount();
+const uint64_t* bfs_frontier_histogram(uint64_t*);
+void set_distance_map_enabled(bool);
+const distance_t* last_distance_map(uint32_t*, uint32_t*);
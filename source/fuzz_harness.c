@@ -0,0 +1,452 @@
+//! \file fuzz_harness.c Różnicowe testowanie algorytmów wypełniania: każdy algorytm musi dać dokładnie ten sam obraz co algorytm wzorcowy.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "fuzz_harness.h"
+#include "fill_algorithms.h"
+#include "image_management.h"
+#include "image_generator.h"
+#include "image_index.h"
+#include "values.h"
+#include "stb_image.h"
+
+//! Czy zapisano już obraz z pierwszą niezgodnością.
+static bool failure_saved = false;
+
+/*!
+* Sprawdza, czy algorytm wypełnia obszar połączony także po przekątnych.
+* \param algorithm_t algorithm Sprawdzany algorytm.
+*/
+static bool is_eight_way(algorithm_t algorithm) {
+	return algorithm == STACK_BASED_RECURSIVE_EIGHT_WAY || algorithm == SCANLINE_RECURSIVE_EIGHT_WAY;
+}
+
+/*!
+* Wzorcowe wypełnianie ośmiokierunkowe: najprostsze przeszukiwanie wszerz z tablicą jako kolejką.
+* Piksel jest zamalowywany przy dodaniu do kolejki, więc każdy trafia do niej co najwyżej raz.
+* \param Image* image Modyfikowany obraz.
+* \param uint32_t x Pozycja X punktu startowego.
+* \param uint32_t y Pozycja Y punktu startowego.
+* \param Color_t current_color Kolor obszaru przed wypełnieniem.
+*/
+static void reference_eight_way_fill(Image* image, uint32_t x, uint32_t y, Color_t current_color) {
+	if (current_color.r == replacement_color.r && current_color.g == replacement_color.g && current_color.b == replacement_color.b) return;
+
+	uint64_t* queue = malloc(sizeof(uint64_t) * image->width * image->height);
+	if (queue == NULL) return;
+
+	uint64_t head = 0;
+	uint64_t tail = 0;
+	set_pixel_color(image, x, y, replacement_color);
+	queue[tail++] = (uint64_t)y * image->width + x;
+
+	while (head < tail) {
+		uint32_t pixel_x = (uint32_t)(queue[head] % image->width);
+		uint32_t pixel_y = (uint32_t)(queue[head] / image->width);
+		head++;
+
+		for (int dy = -1; dy <= 1; dy++) {
+			for (int dx = -1; dx <= 1; dx++) {
+				int64_t neighbour_x = (int64_t)pixel_x + dx;
+				int64_t neighbour_y = (int64_t)pixel_y + dy;
+				if (neighbour_x < 0 || neighbour_y < 0 || neighbour_x >= image->width || neighbour_y >= image->height) continue;
+
+				uint8_t* pixel = image->as_array + ((uint64_t)neighbour_y * image->width + neighbour_x) * 3;
+				if (pixel[0] != current_color.r || pixel[1] != current_color.g || pixel[2] != current_color.b) continue;
+
+				set_pixel_color(image, (uint32_t)neighbour_x, (uint32_t)neighbour_y, replacement_color);
+				queue[tail++] = (uint64_t)neighbour_y * image->width + neighbour_x;
+			}
+		}
+	}
+	free(queue);
+}
+
+/*!
+* Porównuje wynik algorytmu z wynikiem wzorcowym i wypisuje pierwszą różnicę.
+* \param const Image* pristine Obraz przed wypełnieniem.
+* \param const Image* expected Wynik algorytmu wzorcowego.
+* \param const Image* actual Wynik sprawdzanego algorytmu.
+* \param algorithm_t algorithm Sprawdzany algorytm.
+* \param const char* label Opis przypadku do komunikatu.
+* \returns true, jeśli obrazy są identyczne.
+*/
+static bool compare_fill_results(const Image* pristine, const Image* expected, const Image* actual, algorithm_t algorithm, const char* label) {
+	uint64_t size = (uint64_t)pristine->width * pristine->height * 3;
+	if (!memcmp(expected->as_array, actual->as_array, size)) return true;
+
+	uint64_t expected_pixels = 0;
+	uint64_t actual_pixels = 0;
+	uint64_t first_difference = UINT64_MAX;
+	for (uint64_t i = 0; i < size; i += 3) {
+		if (memcmp(expected->as_array + i, pristine->as_array + i, 3)) expected_pixels++;
+		if (memcmp(actual->as_array + i, pristine->as_array + i, 3)) actual_pixels++;
+		if (first_difference == UINT64_MAX && memcmp(expected->as_array + i, actual->as_array + i, 3)) first_difference = i / 3;
+	}
+
+	printf(
+		"MISMATCH %s: %s filled %llu pixels, reference %llu, first difference at %llu %llu\n",
+		label,
+		algorithm_names[algorithm],
+		(unsigned long long)actual_pixels,
+		(unsigned long long)expected_pixels,
+		(unsigned long long)(first_difference % pristine->width),
+		(unsigned long long)(first_difference / pristine->width)
+	);
+	return false;
+}
+
+/*!
+* Wypełnia kopię obrazu każdym algorytmem, w układzie wierszy i w kafelkach, i porównuje wynik, bajt po bajcie, z algorytmem wzorcowym:
+* queue_based_four_way dla algorytmów czterokierunkowych i reference_eight_way_fill dla ośmiokierunkowych.
+* Identyczny obraz oznacza też identyczną ilość wypełnionych pikseli. Zawsze używa szybkiej wersji algorytmów.
+* Pierwszy obraz z niezgodnością jest zapisywany do FUZZ_FAILURE_PATH.
+* \param const Image* pristine Obraz przed wypełnieniem, nie jest zmieniany.
+* \param uint32_t x Pozycja X punktu startowego.
+* \param uint32_t y Pozycja Y punktu startowego.
+* \param Color_t fill_color Kolor wypełnienia, na czas sprawdzania zastępuje replacement_color.
+* \param const char* label Opis przypadku do komunikatów.
+* \returns Ilość algorytmów niezgodnych z wzorcem.
+*/
+uint32_t check_fill_engines(const Image* pristine, uint32_t x, uint32_t y, Color_t fill_color, const char* label) {
+	if (x >= pristine->width || y >= pristine->height) return 0;
+
+	uint64_t size = (uint64_t)pristine->width * pristine->height * 3;
+	Image four_way = *pristine;
+	Image eight_way = *pristine;
+	Image actual = *pristine;
+	four_way.as_array = malloc(size);
+	eight_way.as_array = malloc(size);
+	actual.as_array = malloc(size);
+	if (four_way.as_array == NULL || eight_way.as_array == NULL || actual.as_array == NULL) {
+		free(four_way.as_array);
+		free(eight_way.as_array);
+		free(actual.as_array);
+		return 0;
+	}
+
+	Color_t previous_replacement_color = replacement_color;
+	bool previous_visualisation_mode = visualisation_mode;
+	replacement_color = fill_color;
+	visualisation_mode = false;
+
+	Color_t current_color = { 0 };
+	get_pixel_color(&current_color, x, y, (Image*)pristine);
+
+	memcpy(four_way.as_array, pristine->as_array, size);
+	memset(&measure_values, 0, sizeof(measure_values));
+	flood_fill(QUEUE_BASED_FOUR_WAY, x, y, &four_way, current_color);
+
+	memcpy(eight_way.as_array, pristine->as_array, size);
+	reference_eight_way_fill(&eight_way, x, y, current_color);
+
+	char tiled_label[256];
+	snprintf(tiled_label, sizeof(tiled_label), "%s, tiled", label);
+
+	uint32_t mismatches = 0;
+	bool converted = true;
+	for (uint32_t algorithm = 0; algorithm < ALGORITHM_AMOUNT && converted; algorithm++) {
+		//! Każdy algorytm wypełnia obraz w wierszach i w kafelkach, wynik z kafelków wraca do wierszy przed porównaniem.
+		for (uint32_t layout = IMAGE_LAYOUT_ROW_MAJOR; layout <= IMAGE_LAYOUT_TILED && converted; layout++) {
+			memcpy(actual.as_array, pristine->as_array, size);
+			converted = convert_image_layout(&actual, layout);
+			if (!converted) break;
+			memset(&measure_values, 0, sizeof(measure_values));
+			flood_fill(algorithm, x, y, &actual, current_color);
+			converted = convert_image_layout(&actual, IMAGE_LAYOUT_ROW_MAJOR);
+			if (!converted) break;
+
+			const Image* expected = is_eight_way(algorithm) ? &eight_way : &four_way;
+			if (!compare_fill_results(pristine, expected, &actual, algorithm, layout == IMAGE_LAYOUT_TILED ? tiled_label : label)) {
+				mismatches++;
+				if (!failure_saved) {
+					failure_saved = encode_bmp(FUZZ_FAILURE_PATH, pristine->as_array, pristine->width, pristine->height);
+					printf("image saved to %s, start %u %u\n", FUZZ_FAILURE_PATH, x, y);
+				}
+			}
+		}
+	}
+
+	replacement_color = previous_replacement_color;
+	visualisation_mode = previous_visualisation_mode;
+	free(four_way.as_array);
+	free(eight_way.as_array);
+	free(actual.as_array);
+	return mismatches;
+}
+
+/*!
+* Zapisuje obraz w formacie QOI do FUZZ_ROUND_TRIP_PATH, wczytuje go z powrotem i porównuje piksele z oryginałem.
+* \param const Image* image Sprawdzany obraz w układzie wierszy.
+* \param const char* label Opis przypadku do komunikatu o niezgodności.
+* \returns 1, jeśli obraz po zapisie i odczycie się różni albo nie udało się go zapisać lub wczytać, inaczej 0.
+*/
+uint32_t check_qoi_round_trip(const Image* image, const char* label) {
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint8_t* decoded = encode_qoi(FUZZ_ROUND_TRIP_PATH, image->as_array, image->width, image->height)
+		? decode_qoi(FUZZ_ROUND_TRIP_PATH, &width, &height)
+		: NULL;
+	remove(FUZZ_ROUND_TRIP_PATH);
+
+	bool same = decoded && width == image->width && height == image->height
+		&& !memcmp(decoded, image->as_array, (size_t)width * height * 3);
+	if (!same) {
+		uint64_t difference = 0;
+		if (decoded && width == image->width && height == image->height) {
+			while (!memcmp(decoded + difference * 3, image->as_array + difference * 3, 3)) difference++;
+		}
+		printf("QOI MISMATCH %s: %s, first difference at pixel %llu\n", label, decoded ? "decoded image differs" : "write or read failed", difference);
+	}
+	free(decoded);
+	return same ? 0 : 1;
+}
+
+/*!
+* Losuje kolor, w jednej czwartej przypadków równy domyślnemu kolorowi wypełnienia.
+* \param uint64_t* random_state Stan generatora liczb losowych.
+*/
+static Color_t random_color(uint64_t* random_state) {
+	uint64_t random = next_random(random_state);
+	if (random % 4 == 0) return replacement_color;
+	Color_t color = { (uint8_t)(random >> 8), (uint8_t)(random >> 16), (uint8_t)(random >> 24) };
+	return color;
+}
+
+/*!
+* Sprawdza algorytmy na każdym obrazie z folderu, w kolejności nazw: od rogów, środka i FUZZ_POINTS_PER_IMAGE losowych punktów.
+* Każdy obraz jest też zapisywany w QOI i wczytywany z powrotem, patrz check_qoi_round_trip.
+* Dla tego samego ziarna przypadki są zawsze takie same.
+* \param const char* directory Folder z obrazami, zwykle Images.
+* \param uint64_t seed Ziarno losowania punktów i kolorów wypełnienia.
+* \returns Ilość niezgodności.
+*/
+uint32_t fuzz_directory(const char* directory, uint64_t seed) {
+	uint64_t random_state = seed;
+	uint32_t mismatches = 0;
+	uint32_t cases = 0;
+
+	init_image_index(directory);
+	for (uint32_t i = 0; i < IMAGE_AMOUNT; i++) {
+		const char* path = al_cstr(image_names[i]);
+		Image image = { 0 };
+		image.as_array = read_image_pixels(path, &image.width, &image.height);
+		if (image.as_array == NULL) {
+			printf("error when loading %s\n", path);
+			continue;
+		}
+		image.stb_x = image.width;
+		image.stb_y = image.height;
+		image.stb_comp = 3;
+		mismatches += check_qoi_round_trip(&image, path);
+
+		uint32_t points[4 + FUZZ_POINTS_PER_IMAGE][2] = {
+			{ 0, 0 },
+			{ image.width - 1, image.height - 1 },
+			{ image.width / 2, image.height / 2 },
+			{ image.width - 1, 0 }
+		};
+		for (uint32_t point = 4; point < 4 + FUZZ_POINTS_PER_IMAGE; point++) {
+			points[point][0] = (uint32_t)(next_random(&random_state) % image.width);
+			points[point][1] = (uint32_t)(next_random(&random_state) % image.height);
+		}
+
+		for (uint32_t point = 0; point < 4 + FUZZ_POINTS_PER_IMAGE; point++) {
+			char label[300];
+			snprintf(label, sizeof(label), "%s at %u %u", path, points[point][0], points[point][1]);
+			mismatches += check_fill_engines(&image, points[point][0], points[point][1], random_color(&random_state), label);
+			cases++;
+		}
+		stbi_image_free(image.as_array);
+	}
+	destroy_image_index();
+
+	printf("%s: %u cases, %u mismatches\n", directory, cases, mismatches);
+	return mismatches;
+}
+
+/*!
+* Sprawdza algorytmy na losowych obrazach do FUZZ_MAX_SIDE pikseli boku: na przemian szum z palety do FUZZ_MAX_COLORS kolorów
+* o losowej gęstości i wzory z image_generator.h z losowym parametrem, od losowego punktu i z losowym kolorem wypełnienia.
+* \param uint32_t iterations Ilość losowanych przypadków.
+* \param uint64_t seed Ziarno, ten sam daje te same przypadki.
+* \returns Ilość niezgodności.
+*/
+uint32_t fuzz_random_images(uint32_t iterations, uint64_t seed) {
+	uint64_t random_state = seed;
+	uint32_t mismatches = 0;
+
+	for (uint32_t iteration = 0; iteration < iterations; iteration++) {
+		uint32_t width = 1 + (uint32_t)(next_random(&random_state) % FUZZ_MAX_SIDE);
+		uint32_t height = 1 + (uint32_t)(next_random(&random_state) % FUZZ_MAX_SIDE);
+		Image image = { 0 };
+		uint32_t x = 0;
+		uint32_t y = 0;
+
+		if (iteration % 2) {
+			//! Wzór z generatora, z parametrem od 1 do 8 albo, dla szumu, gęstością od 0 do 99 procent.
+			pattern_t pattern = (pattern_t)(next_random(&random_state) % PATTERN_AMOUNT);
+			uint32_t parameter = pattern == PATTERN_NOISE ? (uint32_t)(next_random(&random_state) % 100) : 1 + (uint32_t)(next_random(&random_state) % 8);
+			if (!generate_image(pattern, width, height, next_random(&random_state), parameter, &image, &x, &y)) continue;
+		}
+		else {
+			image.width = width;
+			image.height = height;
+			image.stb_x = width;
+			image.stb_y = height;
+			image.stb_comp = 3;
+			image.as_array = malloc((uint64_t)width * height * 3);
+			if (image.as_array == NULL) continue;
+
+			Color_t palette[FUZZ_MAX_COLORS];
+			uint32_t color_amount = 1 + (uint32_t)(next_random(&random_state) % FUZZ_MAX_COLORS);
+			for (uint32_t color = 0; color < color_amount; color++) palette[color] = random_color(&random_state);
+
+			//! Kolor 0 dominuje z losowym prawdopodobieństwem, żeby zdarzały się zarówno drobne, jak i rozległe obszary.
+			uint32_t density = (uint32_t)(next_random(&random_state) % 100);
+			for (uint64_t pixel = 0; pixel < (uint64_t)width * height; pixel++) {
+				uint64_t random = next_random(&random_state);
+				Color_t color = random % 100 < density ? palette[0] : palette[(random >> 32) % color_amount];
+				memcpy(image.as_array + pixel * 3, &color, 3);
+			}
+		}
+
+		if (next_random(&random_state) % 2) {
+			x = (uint32_t)(next_random(&random_state) % width);
+			y = (uint32_t)(next_random(&random_state) % height);
+		}
+
+		char label[96];
+		snprintf(label, sizeof(label), "random image %u (%ux%u) at %u %u", iteration, width, height, x, y);
+		mismatches += check_fill_engines(&image, x, y, random_color(&random_state), label);
+		mismatches += check_qoi_round_trip(&image, label);
+		free(image.as_array);
+	}
+
+	printf("random images: %u cases, %u mismatches\n", iterations, mismatches);
+	return mismatches;
+}
+
+/*!
+* Koduje fragment obrazu jako wejście LLVMFuzzerTestOneInput.
+* Format: szerokość - 1, wysokość - 1, x, y, ilość kolorów k, paleta k * 3 bajty, indeks koloru dla każdego piksela.
+* Kolory spoza pierwszych FUZZ_MAX_COLORS różnych są zastępowane ostatnim z palety.
+* \param const Image* image Obraz źródłowy.
+* \param uint32_t left Lewa krawędź fragmentu.
+* \param uint32_t top Górna krawędź fragmentu.
+* \param uint32_t width Szerokość fragmentu.
+* \param uint32_t height Wysokość fragmentu.
+* \param uint8_t* input Bufor na co najmniej 5 + FUZZ_MAX_COLORS * 3 + width * height bajtów.
+* \returns Ilość zapisanych bajtów.
+*/
+static size_t encode_fuzz_input(const Image* image, uint32_t left, uint32_t top, uint32_t width, uint32_t height, uint8_t* input) {
+	uint8_t* palette = input + 5;
+	uint8_t* indices = input + 5 + FUZZ_MAX_COLORS * 3;
+	uint32_t color_amount = 0;
+
+	for (uint32_t y = 0; y < height; y++) {
+		for (uint32_t x = 0; x < width; x++) {
+			const uint8_t* pixel = image->as_array + ((uint64_t)(top + y) * image->width + left + x) * 3;
+			uint32_t color = 0;
+			while (color < color_amount && memcmp(palette + color * 3, pixel, 3)) color++;
+			if (color == color_amount) {
+				if (color_amount < FUZZ_MAX_COLORS) memcpy(palette + color_amount++ * 3, pixel, 3);
+				else color = FUZZ_MAX_COLORS - 1;
+			}
+			indices[y * width + x] = (uint8_t)color;
+		}
+	}
+
+	input[0] = (uint8_t)(width - 1);
+	input[1] = (uint8_t)(height - 1);
+	input[2] = (uint8_t)(width / 2);
+	input[3] = (uint8_t)(height / 2);
+	input[4] = (uint8_t)color_amount;
+	//! Paleta ma zawsze FUZZ_MAX_COLORS miejsc, nieużywane zostają wyzerowane.
+	memset(palette + color_amount * 3, 0, (FUZZ_MAX_COLORS - color_amount) * 3);
+	return 5 + FUZZ_MAX_COLORS * 3 + (size_t)width * height;
+}
+
+/*!
+* Zapisuje deterministyczny korpus dla libFuzzera: każdy obraz z folderu podzielony na fragmenty o boku do FUZZ_MAX_SIDE pikseli.
+* \param const char* directory Folder z obrazami, zwykle Images.
+* \param const char* corpus_directory Istniejący folder na pliki korpusu.
+* \returns Ilość zapisanych plików.
+*/
+uint32_t write_fuzz_corpus(const char* directory, const char* corpus_directory) {
+	uint8_t* input = malloc(5 + FUZZ_MAX_COLORS * 3 + FUZZ_MAX_SIDE * FUZZ_MAX_SIDE);
+	if (input == NULL) return 0;
+	uint32_t written = 0;
+
+	init_image_index(directory);
+	for (uint32_t i = 0; i < IMAGE_AMOUNT; i++) {
+		const char* path = al_cstr(image_names[i]);
+		Image image = { 0 };
+		image.as_array = read_image_pixels(path, &image.width, &image.height);
+		if (image.as_array == NULL) continue;
+
+		for (uint32_t top = 0; top < image.height; top += FUZZ_MAX_SIDE) {
+			for (uint32_t left = 0; left < image.width; left += FUZZ_MAX_SIDE) {
+				uint32_t width = image.width - left < FUZZ_MAX_SIDE ? image.width - left : FUZZ_MAX_SIDE;
+				uint32_t height = image.height - top < FUZZ_MAX_SIDE ? image.height - top : FUZZ_MAX_SIDE;
+				size_t size = encode_fuzz_input(&image, left, top, width, height, input);
+
+				char corpus_path[512];
+				snprintf(corpus_path, sizeof(corpus_path), "%s/%03u_%u_%u", corpus_directory, i, left, top);
+				FILE* file = fopen(corpus_path, "wb");
+				if (file == NULL) continue;
+				if (fwrite(input, 1, size, file) == size) written++;
+				fclose(file);
+			}
+		}
+		stbi_image_free(image.as_array);
+	}
+	destroy_image_index();
+
+	free(input);
+	printf("%u corpus files written to %s\n", written, corpus_directory);
+	return written;
+}
+
+#if FUZZ_LIBFUZZER
+/*!
+* Wejście libFuzzera, dekoduje obraz w formacie z encode_fuzz_input i sprawdza na nim wszystkie algorytmy.
+* Brakujące bajty indeksów są traktowane jako kolor 0, indeksy są brane modulo ilość kolorów, kolorem wypełnienia jest domyślny replacement_color.
+* Przy niezgodności przerywa program, żeby libFuzzer zapisał przypadek.
+* \param const uint8_t* data Dane od libFuzzera.
+* \param size_t size Ilość danych.
+* \returns 0, wymagane przez libFuzzera.
+*/
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+	if (size < 5 + FUZZ_MAX_COLORS * 3) return 0;
+
+	uint32_t width = 1 + data[0] % FUZZ_MAX_SIDE;
+	uint32_t height = 1 + data[1] % FUZZ_MAX_SIDE;
+	uint32_t color_amount = 1 + (data[4] ? data[4] - 1 : 0) % FUZZ_MAX_COLORS;
+	const uint8_t* palette = data + 5;
+	const uint8_t* indices = data + 5 + FUZZ_MAX_COLORS * 3;
+	size_t index_amount = size - 5 - FUZZ_MAX_COLORS * 3;
+
+	Image image = { 0 };
+	image.width = width;
+	image.height = height;
+	image.stb_x = width;
+	image.stb_y = height;
+	image.stb_comp = 3;
+	image.as_array = malloc((size_t)width * height * 3);
+	if (image.as_array == NULL) return 0;
+
+	for (size_t pixel = 0; pixel < (size_t)width * height; pixel++) {
+		uint32_t color = pixel < index_amount ? indices[pixel] % color_amount : 0;
+		memcpy(image.as_array + pixel * 3, palette + color * 3, 3);
+	}
+
+	uint32_t mismatches = check_fill_engines(&image, data[2] % width, data[3] % height, replacement_color, "libFuzzer input");
+	free(image.as_array);
+	if (mismatches) abort();
+	return 0;
+}
+#endif
@@ -0,0 +1,27 @@
+//! \file fuzz_harness.h Różnicowe sprawdzanie algorytmów wypełniania względem algorytmu wzorcowego.
+
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "values.h"
+
+//! Największy bok losowego obrazu w trybie --fuzz i obrazu dekodowanego z wejścia libFuzzera.
+#define FUZZ_MAX_SIDE 96
+//! Ilość kolorów w palecie losowego obrazu, mała, żeby powstawały duże obszary.
+#define FUZZ_MAX_COLORS 4
+//! Ilość losowych punktów startowych dla każdego obrazu z folderu.
+#define FUZZ_POINTS_PER_IMAGE 8
+//! Plik, do którego zapisywany jest pierwszy obraz, na którym algorytmy się nie zgadzają.
+#define FUZZ_FAILURE_PATH "fuzz_failure.bmp"
+//! Plik tymczasowy do sprawdzania, czy obraz zapisany w QOI wczytuje się bez zmian.
+#define FUZZ_ROUND_TRIP_PATH "fuzz_round_trip.qoi"
+
+uint32_t check_fill_engines(const Image*, uint32_t, uint32_t, Color_t, const char*);
+uint32_t check_qoi_round_trip(const Image*, const char*);
+uint32_t fuzz_directory(const char*, uint64_t);
+uint32_t fuzz_random_images(uint32_t, uint64_t);
+uint32_t write_fuzz_corpus(const char*, const char*);
+#if FUZZ_LIBFUZZER
+int LLVMFuzzerTestOneInput(const uint8_t*, size_t);
+#endif
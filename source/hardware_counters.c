@@ -0,0 +1,150 @@
+//! \file hardware_counters.c Liczniki sprzętowe procesora (instrukcje, cykle, chybienia pamięci podręcznej, skoków i TLB) przez perf_event_open.
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "hardware_counters.h"
+#include "values.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+//! Konfiguracja licznika chybień odczytu z danej pamięci podręcznej dla PERF_TYPE_HW_CACHE.
+#define CACHE_READ_MISS(cache) ((cache) | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16))
+#endif
+
+//! Nazwy liczników, używane jako nagłówki kolumn CSV.
+const char* hardware_counter_names[HARDWARE_COUNTER_AMOUNT] = {
+	"instructions",
+	"cycles",
+	"l1d_misses",
+	"llc_misses",
+	"branch_misses",
+	"dtlb_misses"
+};
+
+//! Deskryptory otwartych liczników, -1 oznacza licznik niedostępny.
+static int counter_fds[HARDWARE_COUNTER_AMOUNT];
+static bool counters_opened = false;
+//! Wartość, czas włączenia i czas liczenia każdego licznika odczytane przy starcie pomiaru.
+static uint64_t counter_start[HARDWARE_COUNTER_AMOUNT][3];
+
+#ifdef __linux__
+/*!
+* Otwiera wyłączony licznik dla obecnego wątku, liczący tylko w trybie użytkownika.
+* Licznik jest dziedziczony przez wątki utworzone później, np. wątki parallel_bfs_four_way, a ich wartości
+* dodają się do licznika po zakończeniu wątku. Wątki są kończone przed stop_hardware_counters, więc odczyt obejmuje całe wypełnianie.
+* PERF_EVENT_IOC_RESET nie zeruje wartości zakończonych wątków, dlatego pomiar to różnica odczytów z początku i końca.
+* \param uint32_t type Rodzaj licznika perf_event.
+* \param uint64_t config Konfiguracja licznika.
+* \returns Deskryptor licznika albo -1, jeśli jądro lub procesor go nie udostępnia.
+*/
+static int open_counter(uint32_t type, uint64_t config) {
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.size = sizeof(attr);
+	attr.type = type;
+	attr.config = config;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	attr.inherit = 1;
+	attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+	return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+/*!
+* Otwiera wszystkie liczniki przy pierwszym użyciu. Każdy licznik otwierany jest osobno,
+* więc brak jednego (np. dTLB na maszynie wirtualnej) nie wyłącza pozostałych. Poza Linuksem wszystkie są niedostępne.
+*/
+static void open_hardware_counters() {
+	counters_opened = true;
+	for (uint32_t i = 0; i < HARDWARE_COUNTER_AMOUNT; i++) counter_fds[i] = -1;
+
+#ifdef __linux__
+	counter_fds[COUNTER_INSTRUCTIONS] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+	counter_fds[COUNTER_CYCLES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+	counter_fds[COUNTER_L1D_MISSES] = open_counter(PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_L1D));
+	counter_fds[COUNTER_LLC_MISSES] = open_counter(PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_LL));
+	counter_fds[COUNTER_BRANCH_MISSES] = open_counter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+	counter_fds[COUNTER_DTLB_MISSES] = open_counter(PERF_TYPE_HW_CACHE, CACHE_READ_MISS(PERF_COUNT_HW_CACHE_DTLB));
+#endif
+}
+
+//! Zapamiętuje początkowe wartości i włącza dostępne liczniki. Przy pierwszym wywołaniu je otwiera.
+void start_hardware_counters() {
+	if (!counters_opened) open_hardware_counters();
+
+#ifdef __linux__
+	for (uint32_t i = 0; i < HARDWARE_COUNTER_AMOUNT; i++) {
+		if (counter_fds[i] < 0) continue;
+		if (read(counter_fds[i], counter_start[i], sizeof(counter_start[i])) != sizeof(counter_start[i])) {
+			memset(counter_start[i], 0, sizeof(counter_start[i]));
+		}
+		ioctl(counter_fds[i], PERF_EVENT_IOC_ENABLE, 0);
+	}
+#endif
+}
+
+/*!
+* Wyłącza liczniki i odczytuje ich wartości. Gdy jądro dzieliło licznik z innymi programami, wartość jest skalowana do całego czasu pomiaru.
+* \param HardwareCounters* counters Odczytane wartości, bity available mówią, które liczniki są ważne.
+*/
+void stop_hardware_counters(HardwareCounters* counters) {
+	memset(counters, 0, sizeof(HardwareCounters));
+	if (!counters_opened) return;
+
+#ifdef __linux__
+	for (uint32_t i = 0; i < HARDWARE_COUNTER_AMOUNT; i++) {
+		if (counter_fds[i] >= 0) ioctl(counter_fds[i], PERF_EVENT_IOC_DISABLE, 0);
+	}
+
+	for (uint32_t i = 0; i < HARDWARE_COUNTER_AMOUNT; i++) {
+		//! wartość, czas włączenia, czas faktycznego liczenia
+		uint64_t data[3];
+		if (counter_fds[i] < 0 || read(counter_fds[i], data, sizeof(data)) != sizeof(data)) continue;
+		for (uint32_t j = 0; j < 3; j++) data[j] -= counter_start[i][j];
+		if (data[2] == 0) continue;
+		counters->values[i] = data[2] < data[1] ? (uint64_t)((double)data[0] * data[1] / data[2]) : data[0];
+		counters->available |= 1u << i;
+	}
+#endif
+}
+
+//! Zamyka otwarte liczniki.
+void close_hardware_counters() {
+	if (!counters_opened) return;
+#ifdef __linux__
+	for (uint32_t i = 0; i < HARDWARE_COUNTER_AMOUNT; i++) {
+		if (counter_fds[i] >= 0) close(counter_fds[i]);
+	}
+#endif
+	counters_opened = false;
+}
+
+/*!
+* Dopisuje do wiersza CSV nazwy kolumn liczników, każdą poprzedzoną przecinkiem.
+* \param FILE* file Plik CSV.
+*/
+void write_hardware_counters_csv_header(FILE* file) {
+	for (uint32_t i = 0; i < HARDWARE_COUNTER_AMOUNT; i++) {
+		fprintf(file, ",%s", hardware_counter_names[i]);
+	}
+}
+
+/*!
+* Dopisuje do wiersza CSV wartości liczników, każdą poprzedzoną przecinkiem. Niedostępne liczniki zostawiają pustą kolumnę.
+* \param FILE* file Plik CSV.
+* \param const HardwareCounters* counters Zapisywane wartości.
+*/
+void write_hardware_counters_csv(FILE* file, const HardwareCounters* counters) {
+	for (uint32_t i = 0; i < HARDWARE_COUNTER_AMOUNT; i++) {
+		if (counters->available & (1u << i)) fprintf(file, ",%llu", (unsigned long long)counters->values[i]);
+		else fputc(',', file);
+	}
+}
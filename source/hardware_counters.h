@@ -0,0 +1,13 @@
+//! \file hardware_counters.h Liczniki sprzętowe procesora odczytywane wokół wypełniania.
+
+#pragma once
+#include <stdio.h>
+#include "values.h"
+
+extern const char* hardware_counter_names[HARDWARE_COUNTER_AMOUNT];
+
+void start_hardware_counters();
+void stop_hardware_counters(HardwareCounters*);
+void close_hardware_counters();
+void write_hardware_counters_csv_header(FILE*);
+void write_hardware_counters_csv(FILE*, const HardwareCounters*);
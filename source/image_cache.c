@@ -0,0 +1,292 @@
+//! \file image_cache.c Pamięć podręczna zdekodowanych obrazów z wczytywaniem w tle.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <allegro5/allegro.h>
+#include "image_cache.h"
+#include "values.h"
+#include "image_management.h"
+#include "stb_image.h"
+
+//! Maksymalna ilość oczekujących próśb o wczytanie w tle, nowsze prośby wypierają najstarsze.
+#define PREFETCH_QUEUE_SIZE 4
+
+//! Zdekodowany obraz przechowywany w pamięci podręcznej.
+typedef struct CachedImage {
+	char* path;
+	uint8_t* as_array;
+	uint32_t width;
+	uint32_t height;
+	uint64_t last_used; //! wartość licznika użyć przy ostatnim odczycie, najmniejsza oznacza najdawniej używany obraz
+	uint64_t generation; //! numer nadany przy dodaniu wpisu, odróżnia go od nowszego wpisu tego samego pliku
+	bool loading; //! obraz jest właśnie dekodowany, as_array jest jeszcze puste
+} CachedImage;
+
+//! Stan pamięci podręcznej, chroniony przez mutex.
+typedef struct ImageCache {
+	CachedImage* entries;
+	uint32_t entry_amount;
+	uint32_t entry_capacity;
+	uint64_t used_memory;
+	uint64_t memory_budget;
+	uint64_t use_counter;
+	uint64_t generation_counter;
+
+	char* prefetch_queue[PREFETCH_QUEUE_SIZE];
+	uint32_t prefetch_amount;
+
+	ALLEGRO_MUTEX* mutex;
+	ALLEGRO_COND* changed;
+	ALLEGRO_THREAD* thread;
+	bool stop;
+} ImageCache;
+
+static ImageCache cache = { 0 };
+
+/*!
+* Zwraca indeks obrazu o podanej ścieżce albo -1, jeśli go nie ma. Wywoływana przy zablokowanym mutexie.
+* \param const char* path Ścieżka do obrazu.
+*/
+static int64_t find_entry(const char* path) {
+	for (uint32_t i = 0; i < cache.entry_amount; i++) {
+		if (!strcmp(cache.entries[i].path, path)) return i;
+	}
+	return -1;
+}
+
+/*!
+* Zwraca indeks wpisu o podanym numerze albo -1, jeśli został usunięty. Wywoływana przy zablokowanym mutexie.
+* \param uint64_t generation Numer wpisu nadany przez add_loading_entry.
+*/
+static int64_t find_generation(uint64_t generation) {
+	for (uint32_t i = 0; i < cache.entry_amount; i++) {
+		if (cache.entries[i].generation == generation) return i;
+	}
+	return -1;
+}
+
+/*!
+* Usuwa obraz z pamięci podręcznej, na jego miejsce przenosi ostatni element. Wywoływana przy zablokowanym mutexie.
+* \param uint32_t index Indeks usuwanego obrazu.
+*/
+static void remove_entry(uint32_t index) {
+	CachedImage* entry = &cache.entries[index];
+	cache.used_memory -= (uint64_t)entry->width * entry->height * 3;
+	free(entry->path);
+	stbi_image_free(entry->as_array);
+	cache.entries[index] = cache.entries[--cache.entry_amount];
+}
+
+/*!
+* Dodaje pusty wpis oznaczony jako wczytywany. Wywoływana przy zablokowanym mutexie.
+* \param const char* path Ścieżka do obrazu.
+* \returns Indeks nowego wpisu albo -1 w przypadku braku pamięci.
+*/
+static int64_t add_loading_entry(const char* path) {
+	if (cache.entry_amount == cache.entry_capacity) {
+		uint32_t new_capacity = cache.entry_capacity ? cache.entry_capacity * 2 : 16;
+		CachedImage* new_entries = realloc(cache.entries, sizeof(CachedImage) * new_capacity);
+		if (new_entries == NULL) return -1;
+		cache.entries = new_entries;
+		cache.entry_capacity = new_capacity;
+	}
+
+	CachedImage* entry = &cache.entries[cache.entry_amount];
+	entry->path = malloc(strlen(path) + 1);
+	if (entry->path == NULL) return -1;
+	strcpy(entry->path, path);
+	entry->as_array = NULL;
+	entry->width = 0;
+	entry->height = 0;
+	entry->last_used = ++cache.use_counter;
+	entry->generation = ++cache.generation_counter;
+	entry->loading = true;
+	return cache.entry_amount++;
+}
+
+/*!
+* Dekoduje obraz poza mutexem i umieszcza go we wcześniej dodanym wpisie.
+* Jeśli w tym czasie forget_cached_image usunęło wpis, zdekodowany obraz może być nieaktualny i jest odrzucany,
+* także gdy pod tą samą ścieżką jest już nowszy wpis.
+* Usuwa najdawniej używane obrazy, dopóki nie zmieści się w limicie pamięci. Obecny obraz zostaje zawsze, nawet gdy sam przekracza limit.
+* Wywoływana przy zablokowanym mutexie, na czas dekodowania go zwalnia.
+* \param const char* path Ścieżka do obrazu, kopia należąca do wywołującego, bo wpis może zostać usunięty razem ze swoją.
+* \param int64_t index Indeks wpisu dodanego przez add_loading_entry.
+* \returns Indeks wpisu z obrazem albo -1, jeśli nie udało się go wczytać.
+*/
+static int64_t decode_into_entry(const char* path, int64_t index) {
+	uint64_t generation = cache.entries[index].generation;
+	al_unlock_mutex(cache.mutex);
+	uint32_t x = 0;
+	uint32_t y = 0;
+	uint8_t* as_array = read_image_pixels(path, &x, &y);
+	al_lock_mutex(cache.mutex);
+
+	index = find_generation(generation);
+	if (index < 0 || as_array == NULL) {
+		if (index >= 0) remove_entry(index);
+		stbi_image_free(as_array);
+		al_broadcast_cond(cache.changed);
+		return -1;
+	}
+
+	uint64_t size = (uint64_t)x * y * 3;
+	CachedImage* entry = &cache.entries[index];
+	entry->as_array = as_array;
+	entry->width = x;
+	entry->height = y;
+	entry->loading = false;
+	cache.used_memory += size;
+
+	//! Usuwamy najdawniej używane obrazy, pomijając obecny i te, które są jeszcze wczytywane.
+	while (cache.used_memory > cache.memory_budget) {
+		int64_t oldest = -1;
+		for (uint32_t i = 0; i < cache.entry_amount; i++) {
+			if (cache.entries[i].loading || i == index) continue;
+			if (oldest < 0 || cache.entries[i].last_used < cache.entries[oldest].last_used) oldest = i;
+		}
+		if (oldest < 0) break;
+		//! remove_entry przenosi ostatni element na miejsce usuwanego, więc indeks obecnego obrazu może się zmienić
+		if (index == cache.entry_amount - 1) index = oldest;
+		remove_entry(oldest);
+	}
+
+	al_broadcast_cond(cache.changed);
+	return index;
+}
+
+/*!
+* Wątek wczytujący w tle obrazy zgłoszone przez prefetch_image.
+* \param ALLEGRO_THREAD* thread Wątek Allegro.
+* \param void* arg Nieużywany.
+*/
+static void* prefetch_thread(ALLEGRO_THREAD* thread, void* arg) {
+	al_lock_mutex(cache.mutex);
+	while (true) {
+		while (cache.prefetch_amount == 0 && !cache.stop) {
+			al_wait_cond(cache.changed, cache.mutex);
+		}
+		if (cache.stop) break;
+
+		char* path = cache.prefetch_queue[--cache.prefetch_amount];
+		if (find_entry(path) < 0) {
+			int64_t index = add_loading_entry(path);
+			if (index >= 0) decode_into_entry(path, index);
+		}
+		free(path);
+	}
+	al_unlock_mutex(cache.mutex);
+	return NULL;
+}
+
+/*!
+* Tworzy pamięć podręczną obrazów i uruchamia wątek wczytujący w tle.
+* \param uint64_t memory_budget Maksymalna ilość bajtów zajmowana przez zdekodowane obrazy.
+*/
+void init_image_cache(uint64_t memory_budget) {
+	cache.memory_budget = memory_budget;
+	cache.mutex = al_create_mutex();
+	cache.changed = al_create_cond();
+	cache.thread = al_create_thread(prefetch_thread, NULL);
+	if (cache.thread) al_start_thread(cache.thread);
+}
+
+//! Zatrzymuje wątek wczytujący w tle i zwalnia wszystkie zapamiętane obrazy.
+void destroy_image_cache() {
+	if (cache.mutex == NULL) return;
+
+	al_lock_mutex(cache.mutex);
+	cache.stop = true;
+	al_broadcast_cond(cache.changed);
+	al_unlock_mutex(cache.mutex);
+	if (cache.thread) al_destroy_thread(cache.thread);
+
+	while (cache.entry_amount > 0) remove_entry(0);
+	while (cache.prefetch_amount > 0) free(cache.prefetch_queue[--cache.prefetch_amount]);
+	free(cache.entries);
+	al_destroy_cond(cache.changed);
+	al_destroy_mutex(cache.mutex);
+	memset(&cache, 0, sizeof(cache));
+}
+
+/*!
+* Zwraca kopię zdekodowanego obrazu, którą można dowolnie modyfikować i zwolnić przez stbi_image_free.
+* Jeśli obraz jest właśnie wczytywany w tle, czeka na jego zakończenie, a jeśli go nie ma, dekoduje go i zapamiętuje.
+* Bez zainicjowanej pamięci podręcznej po prostu dekoduje plik.
+* \param const char* path Ścieżka do obrazu.
+* \param uint32_t* width Szerokość obrazu.
+* \param uint32_t* height Wysokość obrazu.
+* \returns Tablica składowych kolorów (3 na piksel) albo NULL w przypadku błędu.
+*/
+uint8_t* get_cached_image(const char* path, uint32_t* width, uint32_t* height) {
+	if (cache.mutex == NULL) return read_image_pixels(path, width, height);
+
+	al_lock_mutex(cache.mutex);
+	int64_t index = find_entry(path);
+	while (index >= 0 && cache.entries[index].loading) {
+		al_wait_cond(cache.changed, cache.mutex);
+		index = find_entry(path);
+	}
+	if (index < 0) {
+		index = add_loading_entry(path);
+		if (index >= 0) index = decode_into_entry(path, index);
+	}
+
+	uint8_t* copy = NULL;
+	if (index >= 0) {
+		CachedImage* entry = &cache.entries[index];
+		uint64_t size = (uint64_t)entry->width * entry->height * 3;
+		copy = malloc(size);
+		if (copy) {
+			memcpy(copy, entry->as_array, size);
+			*width = entry->width;
+			*height = entry->height;
+		}
+		entry->last_used = ++cache.use_counter;
+	}
+	al_unlock_mutex(cache.mutex);
+	return copy;
+}
+
+/*!
+* Zgłasza obraz do wczytania w tle. Obrazy już zapamiętane są pomijane przez wątek.
+* \param const char* path Ścieżka do obrazu.
+*/
+void prefetch_image(const char* path) {
+	if (cache.thread == NULL) return;
+
+	char* path_copy = malloc(strlen(path) + 1);
+	if (path_copy == NULL) return;
+	strcpy(path_copy, path);
+
+	al_lock_mutex(cache.mutex);
+	//! Przy pełnej kolejce usuwamy najstarszą prośbę, wątek obsługuje najpierw najnowsze.
+	if (cache.prefetch_amount == PREFETCH_QUEUE_SIZE) {
+		free(cache.prefetch_queue[0]);
+		memmove(cache.prefetch_queue, cache.prefetch_queue + 1, sizeof(char*) * (PREFETCH_QUEUE_SIZE - 1));
+		cache.prefetch_amount--;
+	}
+	cache.prefetch_queue[cache.prefetch_amount++] = path_copy;
+	al_broadcast_cond(cache.changed);
+	al_unlock_mutex(cache.mutex);
+}
+
+/*!
+* Usuwa obraz z pamięci podręcznej, np. po zmianie pliku na dysku.
+* Obraz wczytywany właśnie w tle też jest usuwany: mógł zostać odczytany przed zmianą, więc decode_into_entry go odrzuci,
+* a czekający na niego get_cached_image zdekoduje plik od nowa.
+* \param const char* path Ścieżka do obrazu.
+*/
+void forget_cached_image(const char* path) {
+	if (cache.mutex == NULL) return;
+
+	al_lock_mutex(cache.mutex);
+	int64_t index = find_entry(path);
+	if (index >= 0) {
+		remove_entry(index);
+		al_broadcast_cond(cache.changed);
+	}
+	al_unlock_mutex(cache.mutex);
+}
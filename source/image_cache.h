@@ -0,0 +1,14 @@
+//! \file image_cache.h Pamięć podręczna zdekodowanych obrazów.
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Domyślny limit pamięci na zdekodowane obrazy w bajtach.
+#define IMAGE_CACHE_MEMORY_BUDGET (512ull * 1024 * 1024)
+
+void init_image_cache(uint64_t);
+void destroy_image_cache();
+uint8_t* get_cached_image(const char*, uint32_t*, uint32_t*);
+void prefetch_image(const char*);
+void forget_cached_image(const char*);
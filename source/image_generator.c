@@ -0,0 +1,301 @@
+//! \file image_generator.c Generator deterministycznych obrazów testowych: płaski obszar, szachownica, szum, pierścienie, spirala, wąż i labirynt.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "image_generator.h"
+#include "values.h"
+
+//! Nazwy wzorów, w kolejności z pattern_t. Używane w linii poleceń i nazwach obrazów w wynikach pomiarów.
+const char* pattern_names[PATTERN_AMOUNT] = {
+	"flat",
+	"checkerboard",
+	"noise",
+	"rings",
+	"spiral",
+	"serpentine",
+	"maze"
+};
+
+/*!
+* Parametr używany, gdy podano 0: rozmiar pola szachownicy, procent czarnych pikseli szumu (białe są wyraźnie powyżej progu perkolacji, więc środek zwykle trafia w największy obszar),
+* szerokość pierścienia, pasa spirali, korytarza węża i labiryntu.
+*/
+static const uint32_t default_parameters[PATTERN_AMOUNT] = { 0, 1, 35, 4, 4, 1, 1 };
+
+/*!
+* Generator liczb losowych splitmix64, dający takie same wyniki na każdej platformie.
+* \param uint64_t* state Stan generatora.
+*/
+uint64_t next_random(uint64_t* state) {
+	uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+/*!
+* Zamienia nazwę wzoru na pattern_t.
+* \param const char* name Nazwa wzoru z pattern_names.
+* \param pattern_t* pattern Znaleziony wzór.
+* \returns true, jeśli wzór istnieje.
+*/
+bool parse_pattern(const char* name, pattern_t* pattern) {
+	for (uint32_t i = 0; i < PATTERN_AMOUNT; i++) {
+		if (!strcmp(name, pattern_names[i])) {
+			*pattern = (pattern_t)i;
+			return true;
+		}
+	}
+	return false;
+}
+
+/*!
+* Ustawia kolor piksela na biały albo czarny.
+* \param Image* image Generowany obraz.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+* \param bool wall true dla ściany (czarny), false dla obszaru (biały).
+*/
+static void set_generated_pixel(Image* image, uint32_t x, uint32_t y, bool wall) {
+	memset(image->as_array + ((uint64_t)y * image->width + x) * 3, wall ? 0 : 255, 3);
+}
+
+/*!
+* Maluje na biało kwadrat siatki labiryntu o boku cell_size.
+* \param Image* image Generowany obraz.
+* \param uint32_t lattice_x Pozycja X kwadratu w siatce.
+* \param uint32_t lattice_y Pozycja Y kwadratu w siatce.
+* \param uint32_t cell_size Bok kwadratu w pikselach.
+*/
+static void carve_lattice_square(Image* image, uint32_t lattice_x, uint32_t lattice_y, uint32_t cell_size) {
+	for (uint32_t row = lattice_y * cell_size; row < (lattice_y + 1) * cell_size; row++) {
+		memset(image->as_array + ((uint64_t)row * image->width + (uint64_t)lattice_x * cell_size) * 3, 255, (uint64_t)cell_size * 3);
+	}
+}
+
+/*!
+* Generuje labirynt doskonały (dokładnie jedna droga między dwoma komórkami) metodą przeszukiwania w głąb z nawracaniem.
+* Komórki i korytarze mają szerokość corridor pikseli, ściany również. Stos komórek jest na stercie.
+* \param Image* image Generowany obraz, na początku cały czarny.
+* \param uint32_t corridor Szerokość korytarza.
+* \param uint64_t* random_state Stan generatora liczb losowych.
+* \returns false w przypadku braku pamięci lub zbyt małego obrazu.
+*/
+static bool generate_maze(Image* image, uint32_t corridor, uint64_t* random_state) {
+	uint32_t cells_x = (image->width / corridor - 1) / 2;
+	uint32_t cells_y = (image->height / corridor - 1) / 2;
+	if (image->width / corridor < 3 || image->height / corridor < 3) return false;
+
+	uint64_t cell_amount = (uint64_t)cells_x * cells_y;
+	uint8_t* visited = calloc((cell_amount + 7) / 8, 1);
+	uint32_t* stack = malloc(sizeof(uint32_t) * cell_amount);
+	if (visited == NULL || stack == NULL) {
+		free(visited);
+		free(stack);
+		return false;
+	}
+
+	uint64_t stack_size = 0;
+	stack[stack_size++] = 0;
+	visited[0] = 1;
+	carve_lattice_square(image, 1, 1, corridor);
+
+	while (stack_size > 0) {
+		uint32_t cell = stack[stack_size - 1];
+		uint32_t cell_x = cell % cells_x;
+		uint32_t cell_y = cell / cells_x;
+
+		//! Nieodwiedzeni sąsiedzi: lewo, prawo, góra, dół.
+		uint32_t neighbours[4];
+		uint32_t neighbour_amount = 0;
+		if (cell_x > 0 && !(visited[(cell - 1) >> 3] & (1 << ((cell - 1) & 7)))) neighbours[neighbour_amount++] = cell - 1;
+		if (cell_x + 1 < cells_x && !(visited[(cell + 1) >> 3] & (1 << ((cell + 1) & 7)))) neighbours[neighbour_amount++] = cell + 1;
+		if (cell_y > 0 && !(visited[(cell - cells_x) >> 3] & (1 << ((cell - cells_x) & 7)))) neighbours[neighbour_amount++] = cell - cells_x;
+		if (cell_y + 1 < cells_y && !(visited[(cell + cells_x) >> 3] & (1 << ((cell + cells_x) & 7)))) neighbours[neighbour_amount++] = cell + cells_x;
+
+		if (neighbour_amount == 0) {
+			stack_size--;
+			continue;
+		}
+
+		uint32_t next = neighbours[next_random(random_state) % neighbour_amount];
+		uint32_t next_x = next % cells_x;
+		uint32_t next_y = next / cells_x;
+
+		//! Komórka (i, j) leży w siatce na (2i + 1, 2j + 1), korytarz między komórkami w połowie drogi.
+		carve_lattice_square(image, cell_x + next_x + 1, cell_y + next_y + 1, corridor);
+		carve_lattice_square(image, 2 * next_x + 1, 2 * next_y + 1, corridor);
+		visited[next >> 3] |= 1 << (next & 7);
+		stack[stack_size++] = next;
+	}
+
+	free(visited);
+	free(stack);
+	return true;
+}
+
+/*!
+* Sprawdza, czy piksel jest biały.
+* \param Image* image Obraz.
+* \param uint32_t x Pozycja X piksela.
+* \param uint32_t y Pozycja Y piksela.
+*/
+static bool is_white(Image* image, uint32_t x, uint32_t y) {
+	return image->as_array[((uint64_t)y * image->width + x) * 3] == 255;
+}
+
+/*!
+* Generuje obraz testowy o podanym wzorze. Ten sam wzór, rozmiar, ziarno i parametr dają zawsze identyczny obraz.
+* Białe piksele tworzą obszar do wypełnienia, czarne są ścianami:
+* flat - jeden płaski obszar, najlepszy przypadek;
+* checkerboard - szachownica z polami o boku parametru, dla 1 obszary czterokierunkowe mają po pikselu, a ośmiokierunkowy obejmuje połowę obrazu;
+* noise - szum z parametrem procent czarnych pikseli, obszar o postrzępionej, fraktalnej granicy;
+* rings - pierścienie o szerokości parametru połączone przerwami na zmianę po prawej i lewej stronie;
+* spiral - spirala Archimedesa, pas biały i czarny o szerokości parametru;
+* serpentine - wąż, poziome korytarze o szerokości parametru połączone na zmianę na końcach, najgłębsza rekurencja;
+* maze - labirynt doskonały z korytarzami o szerokości parametru.
+* \param pattern_t pattern Wzór obrazu.
+* \param uint32_t width Szerokość obrazu.
+* \param uint32_t height Wysokość obrazu.
+* \param uint64_t seed Ziarno generatora liczb losowych (szum i labirynt).
+* \param uint32_t parameter Parametr wzoru, 0 oznacza wartość domyślną.
+* \param Image* image Wygenerowany obraz, piksele należy zwolnić przez free.
+* \param uint32_t* seed_x Pozycja X białego piksela, od którego warto zaczynać wypełnianie.
+* \param uint32_t* seed_y Pozycja Y tego piksela.
+* \returns true, jeśli obraz został wygenerowany.
+*/
+bool generate_image(pattern_t pattern, uint32_t width, uint32_t height, uint64_t seed, uint32_t parameter, Image* image, uint32_t* seed_x, uint32_t* seed_y) {
+	if (pattern >= PATTERN_AMOUNT || width == 0 || height == 0) return false;
+	if (parameter == 0) parameter = default_parameters[pattern] ? default_parameters[pattern] : 1;
+
+	memset(image, 0, sizeof(Image));
+	image->width = width;
+	image->height = height;
+	image->stb_x = width;
+	image->stb_y = height;
+	image->stb_comp = 3;
+	image->as_array = malloc((uint64_t)width * height * 3);
+	if (image->as_array == NULL) return false;
+
+	uint64_t random_state = seed;
+	uint32_t center_x = width / 2;
+	uint32_t center_y = height / 2;
+	*seed_x = center_x;
+	*seed_y = center_y;
+
+	switch (pattern) {
+	case PATTERN_FLAT:
+		memset(image->as_array, 255, (uint64_t)width * height * 3);
+		break;
+
+	case PATTERN_CHECKERBOARD:
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				set_generated_pixel(image, x, y, (x / parameter + y / parameter) & 1);
+			}
+		}
+		*seed_x = 0;
+		*seed_y = 0;
+		break;
+
+	case PATTERN_NOISE:
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				set_generated_pixel(image, x, y, next_random(&random_state) % 100 < parameter);
+			}
+		}
+		set_generated_pixel(image, center_x, center_y, false);
+		break;
+
+	case PATTERN_RINGS:
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				double dx = (double)x - center_x;
+				double dy = (double)y - center_y;
+				uint32_t ring = (uint32_t)(sqrt(dx * dx + dy * dy) / parameter);
+				//! Nieparzyste pierścienie są ścianami, co drugą przecina przerwa po prawej, pozostałe po lewej stronie.
+				bool gap = fabs(dy) < parameter && ((ring % 4 == 1 && dx > 0) || (ring % 4 == 3 && dx < 0));
+				set_generated_pixel(image, x, y, (ring & 1) && !gap);
+			}
+		}
+		break;
+
+	case PATTERN_SPIRAL:
+		for (uint32_t y = 0; y < height; y++) {
+			for (uint32_t x = 0; x < width; x++) {
+				double dx = (double)x - center_x;
+				double dy = (double)y - center_y;
+				double turn = sqrt(dx * dx + dy * dy) / (2.0 * parameter) - atan2(dy, dx) / (2.0 * 3.14159265358979323846);
+				set_generated_pixel(image, x, y, turn - floor(turn) < 0.5);
+			}
+		}
+		break;
+
+	case PATTERN_SERPENTINE:
+		for (uint32_t y = 0; y < height; y++) {
+			uint32_t band = y / parameter;
+			for (uint32_t x = 0; x < width; x++) {
+				//! Nieparzyste pasy są ścianami z przejściem na przemian przy prawej i lewej krawędzi.
+				bool gap = (band / 2) % 2 == 0 ? x + parameter >= width : x < parameter;
+				set_generated_pixel(image, x, y, (band & 1) && !gap);
+			}
+		}
+		*seed_x = 0;
+		*seed_y = 0;
+		break;
+
+	case PATTERN_MAZE:
+		memset(image->as_array, 0, (uint64_t)width * height * 3);
+		if (!generate_maze(image, parameter, &random_state)) {
+			free(image->as_array);
+			image->as_array = NULL;
+			return false;
+		}
+		*seed_x = parameter;
+		*seed_y = parameter;
+		break;
+
+	default:
+		break;
+	}
+
+	//! Jeśli zaproponowany punkt wypadł na ścianie, szukamy pierwszego białego piksela od niego.
+	if (!is_white(image, *seed_x, *seed_y)) {
+		uint64_t pixel_amount = (uint64_t)width * height;
+		uint64_t start = (uint64_t)*seed_y * width + *seed_x;
+		for (uint64_t i = 1; i < pixel_amount; i++) {
+			uint64_t index = (start + i) % pixel_amount;
+			if (image->as_array[index * 3] == 255) {
+				*seed_x = (uint32_t)(index % width);
+				*seed_y = (uint32_t)(index / width);
+				break;
+			}
+		}
+	}
+	return true;
+}
+
+/*!
+* Generuje obraz opisany tekstem w postaci wzór:szerokośćxwysokość[:ziarno[:parametr]], np. maze:1024x1024:7:2.
+* Pozwala podawać wygenerowane obrazy wszędzie tam, gdzie tryb bez okna przyjmuje ścieżkę do pliku.
+* \param const char* spec Opis obrazu.
+* \param Image* image Wygenerowany obraz, piksele należy zwolnić przez free.
+* \param uint32_t* seed_x Pozycja X proponowanego punktu startowego.
+* \param uint32_t* seed_y Pozycja Y proponowanego punktu startowego.
+* \returns true, jeśli opis jest poprawny i obraz został wygenerowany.
+*/
+bool generate_image_from_spec(const char* spec, Image* image, uint32_t* seed_x, uint32_t* seed_y) {
+	char name[32];
+	unsigned long width = 0;
+	unsigned long height = 0;
+	unsigned long long seed = GENERATOR_DEFAULT_SEED;
+	unsigned long parameter = 0;
+	pattern_t pattern;
+
+	if (sscanf(spec, "%31[a-z]:%lux%lu:%llu:%lu", name, &width, &height, &seed, &parameter) < 3) return false;
+	if (!parse_pattern(name, &pattern) || width > UINT32_MAX || height > UINT32_MAX || parameter > UINT32_MAX) return false;
+	return generate_image(pattern, (uint32_t)width, (uint32_t)height, seed, (uint32_t)parameter, image, seed_x, seed_y);
+}
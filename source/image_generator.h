@@ -0,0 +1,32 @@
+//! \file image_generator.h Deterministyczne obrazy testowe do pomiarów skalowania.
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "values.h"
+
+//! Wzory generowanych obrazów. Białe piksele tworzą wypełniane obszary, czarne są ścianami.
+typedef enum pattern_t
+{
+	PATTERN_FLAT,
+	PATTERN_CHECKERBOARD,
+	PATTERN_NOISE,
+	PATTERN_RINGS,
+	PATTERN_SPIRAL,
+	PATTERN_SERPENTINE,
+	PATTERN_MAZE,
+	PATTERN_AMOUNT
+} pattern_t;
+
+//! Domyślne ziarno generatora liczb losowych.
+#define GENERATOR_DEFAULT_SEED 1
+//! Boki kwadratowych obrazów mierzonych przez --benchmark-suite, od 1 KP do 1 GP, co rząd wielkości.
+#define GENERATOR_SIZE_AMOUNT 7
+#define GENERATOR_SIZES { 32, 100, 316, 1000, 3162, 10000, 31623 }
+
+extern const char* pattern_names[PATTERN_AMOUNT];
+
+uint64_t next_random(uint64_t*);
+bool parse_pattern(const char*, pattern_t*);
+bool generate_image(pattern_t, uint32_t, uint32_t, uint64_t, uint32_t, Image*, uint32_t*, uint32_t*);
+bool generate_image_from_spec(const char*, Image*, uint32_t*, uint32_t*);
@@ -0,0 +1,355 @@
+//! \file image_index.c Indeks obrazów w folderze Images, odświeżany po zmianach w folderze.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <allegro5/allegro.h>
+#include "values.h"
+#include "image_index.h"
+#include "image_cache.h"
+#include "image_management.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+//! Stan indeksu obrazów. Wpisy są posortowane po nazwie, image_names wskazuje na ich nazwy.
+typedef struct ImageIndex {
+	char directory[256];
+	ImageIndexEntry* entries;
+	uint32_t entry_amount;
+#ifdef _WIN32
+	HANDLE change_handle;
+#elif defined(__linux__)
+	int inotify_fd;
+	//! Nazwy plików zgłoszone przez inotify od ostatniego odświeżenia, bez powtórzeń.
+	char (*pending_names)[NAME_MAX + 1];
+	uint32_t pending_amount;
+	uint32_t pending_capacity;
+	//! Ustawiane przy przepełnieniu kolejki zdarzeń albo braku pamięci, wtedy folder jest czytany w całości.
+	bool rescan_needed;
+#endif
+} ImageIndex;
+
+static ImageIndex image_index = { 0 };
+
+/*!
+* Porównuje dwa wpisy po nazwie, używana przez qsort i bsearch.
+* \param const void* first Pierwszy wpis.
+* \param const void* second Drugi wpis.
+*/
+static int compare_entries(const void* first, const void* second) {
+	return strcmp(al_cstr(((const ImageIndexEntry*)first)->name), al_cstr(((const ImageIndexEntry*)second)->name));
+}
+
+/*!
+* Sprawdza, czy plik ma rozszerzenie .bmp lub .qoi (bez względu na wielkość liter).
+* Pomijane są pliki wynikowe Result.* i pliki tymczasowe *.tmp, które zapisuje result_writer.
+* \param const char* file_name Nazwa pliku bez ścieżki.
+*/
+static bool is_indexed_image(const char* file_name) {
+	if (!strncmp(file_name, "Result.", 7) || has_file_extension(file_name, ".tmp")) return false;
+	return has_file_extension(file_name, ".bmp") || has_file_extension(file_name, ".qoi");
+}
+
+/*!
+* Czyta zawartość folderu jeden raz i tworzy z niej nową, posortowaną tablicę wpisów.
+* Pliki zmienione od poprzedniego odczytu usuwa z pamięci podręcznej obrazów.
+* \param uint32_t* entry_amount Ilość wpisów w nowej tablicy.
+* \param bool* changed Ustawiane na true, jeśli doszedł nowy plik albo zmienił się rozmiar lub czas modyfikacji pliku.
+* \returns Nowa tablica wpisów.
+*/
+static ImageIndexEntry* scan_directory(uint32_t* entry_amount, bool* changed) {
+	ImageIndexEntry* entries = NULL;
+	uint32_t capacity = 0;
+	*entry_amount = 0;
+
+	ALLEGRO_FS_ENTRY* directory = al_create_fs_entry(image_index.directory);
+	if (directory == NULL || !al_open_directory(directory)) {
+		if (directory) al_destroy_fs_entry(directory);
+		return NULL;
+	}
+
+	ALLEGRO_FS_ENTRY* file = NULL;
+	while ((file = al_read_directory(directory)) != NULL) {
+		//! Nazwę pliku wycinamy ze ścieżki bez tworzenia ALLEGRO_PATH dla każdego pliku.
+		const char* file_path = al_get_fs_entry_name(file);
+		const char* file_name = file_path;
+		for (const char* c = file_path; *c; c++) {
+			if (*c == '/' || *c == '\\') file_name = c + 1;
+		}
+
+		if (!(al_get_fs_entry_mode(file) & ALLEGRO_FILEMODE_ISFILE) || !is_indexed_image(file_name)) {
+			al_destroy_fs_entry(file);
+			continue;
+		}
+
+		if (*entry_amount == capacity) {
+			capacity = capacity ? capacity * 2 : 64;
+			ImageIndexEntry* new_entries = realloc(entries, sizeof(ImageIndexEntry) * capacity);
+			if (new_entries == NULL) {
+				al_destroy_fs_entry(file);
+				break;
+			}
+			entries = new_entries;
+		}
+
+		ImageIndexEntry* entry = &entries[(*entry_amount)++];
+		entry->name = al_ustr_newf("%s/%s", image_index.directory, file_name);
+		entry->size = al_get_fs_entry_size(file);
+		entry->mtime = al_get_fs_entry_mtime(file);
+		al_destroy_fs_entry(file);
+	}
+
+	al_close_directory(directory);
+	al_destroy_fs_entry(directory);
+
+	if (*entry_amount > 1) qsort(entries, *entry_amount, sizeof(ImageIndexEntry), compare_entries);
+
+	//! Porównujemy z poprzednim stanem indeksu, wyszukując binarnie w posortowanej tablicy.
+	for (uint32_t i = 0; i < *entry_amount; i++) {
+		ImageIndexEntry* old_entry = image_index.entry_amount
+			? bsearch(&entries[i], image_index.entries, image_index.entry_amount, sizeof(ImageIndexEntry), compare_entries)
+			: NULL;
+		if (old_entry == NULL) {
+			*changed = true;
+			continue;
+		}
+		if (old_entry->size != entries[i].size || old_entry->mtime != entries[i].mtime) {
+			*changed = true;
+			forget_cached_image(al_cstr(entries[i].name));
+		}
+	}
+
+	return entries;
+}
+
+//! Ustawia image_names i IMAGE_AMOUNT na podstawie wpisów indeksu.
+static void update_image_names() {
+	free(image_names);
+	image_names = malloc(sizeof(ALLEGRO_USTR*) * (image_index.entry_amount ? image_index.entry_amount : 1));
+	for (uint32_t i = 0; i < image_index.entry_amount; i++) {
+		image_names[i] = image_index.entries[i].name;
+	}
+	IMAGE_AMOUNT = image_index.entry_amount;
+}
+
+#ifdef __linux__
+/*!
+* Uaktualnia jeden wpis indeksu na podstawie obecnego stanu pliku: dodaje go, zmienia jego rozmiar i czas modyfikacji albo go usuwa.
+* Rodzaj zdarzenia nie ma znaczenia, bo plik mógł się zmienić jeszcze raz, zanim zdarzenie zostało odczytane.
+* \param const char* file_name Nazwa pliku bez ścieżki.
+* \returns true, jeśli indeks się zmienił.
+*/
+static bool apply_file_change(const char* file_name) {
+	ImageIndexEntry wanted = { .name = al_ustr_newf("%s/%s", image_index.directory, file_name) };
+
+	//! Miejsce wpisu w posortowanej tablicy, także dla pliku, którego jeszcze w niej nie ma.
+	uint32_t low = 0;
+	uint32_t high = image_index.entry_amount;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		if (compare_entries(&image_index.entries[middle], &wanted) < 0) low = middle + 1;
+		else high = middle;
+	}
+	bool indexed = low < image_index.entry_amount && !compare_entries(&image_index.entries[low], &wanted);
+
+	ALLEGRO_FS_ENTRY* file = al_create_fs_entry(al_cstr(wanted.name));
+	bool exists = file && al_fs_entry_exists(file) && (al_get_fs_entry_mode(file) & ALLEGRO_FILEMODE_ISFILE);
+	if (exists) {
+		wanted.size = al_get_fs_entry_size(file);
+		wanted.mtime = al_get_fs_entry_mtime(file);
+	}
+	if (file) al_destroy_fs_entry(file);
+
+	bool changed = false;
+	if (exists && indexed) {
+		ImageIndexEntry* entry = &image_index.entries[low];
+		if (entry->size != wanted.size || entry->mtime != wanted.mtime) {
+			forget_cached_image(al_cstr(entry->name));
+			entry->size = wanted.size;
+			entry->mtime = wanted.mtime;
+			changed = true;
+		}
+	}
+	else if (exists) {
+		ImageIndexEntry* entries = realloc(image_index.entries, sizeof(ImageIndexEntry) * (image_index.entry_amount + 1));
+		if (entries == NULL) {
+			image_index.rescan_needed = true;
+			al_ustr_free(wanted.name);
+			return false;
+		}
+		image_index.entries = entries;
+		memmove(&entries[low + 1], &entries[low], sizeof(ImageIndexEntry) * (image_index.entry_amount - low));
+		entries[low] = wanted;
+		image_index.entry_amount++;
+		return true;
+	}
+	else if (indexed) {
+		forget_cached_image(al_cstr(image_index.entries[low].name));
+		al_ustr_free(image_index.entries[low].name);
+		memmove(&image_index.entries[low], &image_index.entries[low + 1], sizeof(ImageIndexEntry) * (image_index.entry_amount - low - 1));
+		image_index.entry_amount--;
+		changed = true;
+	}
+
+	al_ustr_free(wanted.name);
+	return changed;
+}
+
+/*!
+* Zapamiętuje nazwę pliku ze zdarzenia inotify do uwzględnienia przy następnym odświeżeniu indeksu.
+* \param const char* file_name Nazwa pliku bez ścieżki.
+*/
+static void queue_file_change(const char* file_name) {
+	for (uint32_t i = 0; i < image_index.pending_amount; i++) {
+		if (!strcmp(image_index.pending_names[i], file_name)) return;
+	}
+	if (image_index.pending_amount == image_index.pending_capacity) {
+		uint32_t capacity = image_index.pending_capacity ? image_index.pending_capacity * 2 : 16;
+		char (*names)[NAME_MAX + 1] = realloc(image_index.pending_names, sizeof(*names) * capacity);
+		if (names == NULL) {
+			image_index.rescan_needed = true;
+			return;
+		}
+		image_index.pending_names = names;
+		image_index.pending_capacity = capacity;
+	}
+	snprintf(image_index.pending_names[image_index.pending_amount++], NAME_MAX + 1, "%s", file_name);
+}
+#endif
+
+/*!
+* Tworzy indeks obrazów .bmp i .qoi z podanego folderu, czytając go tylko raz. Pliki Result.* i *.tmp są pomijane.
+* Zaczyna obserwować folder, żeby image_index_changed mogła zgłaszać nowe, usunięte i zmienione pliki.
+* \param const char* directory Folder z obrazami, względem folderu roboczego.
+*/
+void init_image_index(const char* directory) {
+	snprintf(image_index.directory, sizeof(image_index.directory), "%s", directory);
+
+#ifdef _WIN32
+	image_index.change_handle = FindFirstChangeNotificationA(
+		directory,
+		FALSE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE
+	);
+#elif defined(__linux__)
+	image_index.inotify_fd = inotify_init1(IN_NONBLOCK);
+	if (image_index.inotify_fd >= 0) {
+		inotify_add_watch(image_index.inotify_fd, directory, IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE);
+	}
+	image_index.rescan_needed = true;
+#endif
+
+	refresh_image_index();
+	printf("Images: %u\n", IMAGE_AMOUNT);
+}
+
+/*!
+* Odświeża indeks. Na Linuksie uwzględnia tylko pliki ze zdarzeń zebranych przez image_index_changed,
+* a cały folder czyta przy pierwszym wywołaniu i po przepełnieniu kolejki zdarzeń. Windows nie podaje nazw zmienionych plików,
+* więc tam folder jest zawsze czytany w całości. Nazwy obrazów, które zostały w folderze, pozostają tymi samymi obiektami ALLEGRO_USTR.
+* \returns true, jeśli zawartość folderu się zmieniła.
+*/
+bool refresh_image_index() {
+	bool changed = false;
+#ifdef __linux__
+	if (!image_index.rescan_needed) {
+		for (uint32_t i = 0; i < image_index.pending_amount; i++) {
+			if (apply_file_change(image_index.pending_names[i])) changed = true;
+		}
+		image_index.pending_amount = 0;
+		if (!image_index.rescan_needed) {
+			if (changed) update_image_names();
+			return changed;
+		}
+	}
+	image_index.rescan_needed = false;
+	image_index.pending_amount = 0;
+#endif
+
+	uint32_t entry_amount = 0;
+	ImageIndexEntry* entries = scan_directory(&entry_amount, &changed);
+
+	//! Przenosimy nazwy istniejących obrazów, pozostałe stare nazwy zwalniamy.
+	for (uint32_t i = 0; i < image_index.entry_amount; i++) {
+		ImageIndexEntry* new_entry = entry_amount
+			? bsearch(&image_index.entries[i], entries, entry_amount, sizeof(ImageIndexEntry), compare_entries)
+			: NULL;
+		if (new_entry) {
+			al_ustr_free(new_entry->name);
+			new_entry->name = image_index.entries[i].name;
+		}
+		else {
+			changed = true;
+			forget_cached_image(al_cstr(image_index.entries[i].name));
+			al_ustr_free(image_index.entries[i].name);
+		}
+	}
+
+	free(image_index.entries);
+	image_index.entries = entries;
+	image_index.entry_amount = entry_amount;
+	update_image_names();
+	return changed;
+}
+
+/*!
+* Sprawdza bez blokowania, czy od ostatniego wywołania system zgłosił zmiany w folderze z obrazami.
+* Na Linuksie zapamiętuje nazwy zmienionych obrazów dla refresh_image_index. Na systemach bez obsługi powiadomień zawsze zwraca false.
+*/
+bool image_index_changed() {
+	bool changed = false;
+#ifdef _WIN32
+	if (image_index.change_handle != INVALID_HANDLE_VALUE && image_index.change_handle != NULL
+		&& WaitForSingleObject(image_index.change_handle, 0) == WAIT_OBJECT_0) {
+		changed = true;
+		FindNextChangeNotification(image_index.change_handle);
+	}
+#elif defined(__linux__)
+	_Alignas(struct inotify_event) char events[4096];
+	ssize_t length;
+	while (image_index.inotify_fd >= 0 && (length = read(image_index.inotify_fd, events, sizeof(events))) > 0) {
+		const struct inotify_event* event;
+		for (const char* position = events; position < events + length; position += sizeof(struct inotify_event) + event->len) {
+			event = (const struct inotify_event*)position;
+			if (event->mask & IN_Q_OVERFLOW) {
+				image_index.rescan_needed = true;
+				changed = true;
+			}
+			//! Zapisy Result.* i *.tmp przez result_writer nie wymagają odświeżania indeksu.
+			else if (event->len > 0 && is_indexed_image(event->name)) {
+				queue_file_change(event->name);
+				changed = true;
+			}
+		}
+	}
+#endif
+	return changed;
+}
+
+//! Kończy obserwowanie folderu i zwalnia indeks razem z nazwami obrazów.
+void destroy_image_index() {
+#ifdef _WIN32
+	if (image_index.change_handle != INVALID_HANDLE_VALUE && image_index.change_handle != NULL) {
+		FindCloseChangeNotification(image_index.change_handle);
+	}
+#elif defined(__linux__)
+	if (image_index.inotify_fd >= 0) close(image_index.inotify_fd);
+	free(image_index.pending_names);
+#endif
+
+	for (uint32_t i = 0; i < image_index.entry_amount; i++) {
+		al_ustr_free(image_index.entries[i].name);
+	}
+	free(image_index.entries);
+	free(image_names);
+	image_names = NULL;
+	IMAGE_AMOUNT = 0;
+	memset(&image_index, 0, sizeof(image_index));
+}
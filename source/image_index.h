@@ -0,0 +1,19 @@
+//! \file image_index.h Indeks obrazów w folderze Images.
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <allegro5/allegro.h>
+
+//! Obraz znaleziony w folderze, zapamiętany razem z rozmiarem i czasem modyfikacji pliku.
+typedef struct ImageIndexEntry {
+	ALLEGRO_USTR* name;
+	int64_t size;
+	time_t mtime;
+} ImageIndexEntry;
+
+void init_image_index(const char*);
+bool refresh_image_index();
+bool image_index_changed();
+void destroy_image_index();
@@ -2,7 +2,15 @@
 
 #include<allegro5/allegro.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
 #include "values.h"
+#include "image_management.h"
+#include "image_cache.h"
+#include "trace.h"
+#include "visit_heatmap.h"
 
 #define STBI_ONLY_BMP
 #define STB_IMAGE_IMPLEMENTATION
@@ -10,36 +18,724 @@
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb_image_write.h"
 
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+//! Zamiana kolejności składowych wierszy przez instrukcję PSHUFB (SSSE3), wybierana po sprawdzeniu procesora.
+#define BMP_CODEC_SSSE3 1
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+#ifdef __GNUC__
+#define SSSE3_FUNCTION __attribute__((target("ssse3")))
+#else
+#define SSSE3_FUNCTION
+#endif
+
+//! Zwiększa licznik dostępów do pikseli w strukturze MeasureValues, bez MEASURE_PIXEL_ACCESSES nie generuje żadnego kodu.
+#if MEASURE_PIXEL_ACCESSES
+#define COUNT_PIXEL_ACCESS(counter) (measure_values.counter++)
+#else
+#define COUNT_PIXEL_ACCESS(counter)
+#endif
+
+//! Wymiary i układ pikseli odczytane z nagłówków pliku BMP.
+typedef struct BmpHeader {
+	uint32_t pixel_offset;
+	uint32_t dib_size;
+	int32_t width;
+	int32_t height;
+	uint16_t bits_per_pixel;
+	uint32_t compression;
+	uint32_t palette_size;
+	uint32_t masks[3]; //! maski składowych R, G, B dla 32-bitowych plików BI_BITFIELDS
+} BmpHeader;
+
+//! Odczyt liczby little-endian z bufora.
+static uint16_t read_u16(const uint8_t* data) {
+	return data[0] | data[1] << 8;
+}
+
+//! Odczyt liczby little-endian z bufora.
+static uint32_t read_u32(const uint8_t* data) {
+	return data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+}
+
+//! Zapis liczby little-endian do bufora.
+static void write_u32(uint8_t* data, uint32_t value) {
+	data[0] = value;
+	data[1] = value >> 8;
+	data[2] = value >> 16;
+	data[3] = value >> 24;
+}
+
+#ifdef BMP_CODEC_SSSE3
+//! Sprawdza raz, czy procesor obsługuje SSSE3.
+static bool cpu_has_ssse3() {
+	static int has_ssse3 = -1;
+	if (has_ssse3 < 0) {
+#ifdef _MSC_VER
+		int registers[4];
+		__cpuid(registers, 1);
+		has_ssse3 = (registers[2] >> 9) & 1;
+#else
+		unsigned int eax, ebx, ecx, edx;
+		has_ssse3 = __get_cpuid(1, &eax, &ebx, &ecx, &edx) ? (ecx >> 9) & 1 : 0;
+#endif
+	}
+	return has_ssse3;
+}
+
+/*!
+* Zamienia składowe R i B w wierszu 24-bitowych pikseli, po 5 pikseli na jedną instrukcję PSHUFB.
+* Każdy zapis ma 16 bajtów, ostatni bajt jest nadpisywany przez kolejny zapis, dlatego pętla zostawia ostatnie piksele.
+* \returns Ilość przetworzonych pikseli, resztę trzeba przetworzyć bez SIMD.
+*/
+SSSE3_FUNCTION static uint32_t swap_red_blue_row_ssse3(uint8_t* destination, const uint8_t* source, uint32_t width) {
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+	uint32_t x = 0;
+	for (; x + 6 <= width; x += 5) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(source + x * 3));
+		_mm_storeu_si128((__m128i*)(destination + x * 3), _mm_shuffle_epi8(pixels, shuffle));
+	}
+	return x;
+}
+
+/*!
+* Zamienia wiersz 32-bitowych pikseli BGRA na 24-bitowe RGB, po 4 piksele na jedną instrukcję PSHUFB.
+* Każdy zapis ma 16 bajtów, z czego 12 to piksele, dlatego pętla zostawia ostatnie piksele.
+* \returns Ilość przetworzonych pikseli, resztę trzeba przetworzyć bez SIMD.
+*/
+SSSE3_FUNCTION static uint32_t bgra_to_rgb_row_ssse3(uint8_t* destination, const uint8_t* source, uint32_t width) {
+	const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+	uint32_t x = 0;
+	for (; x + 6 <= width; x += 4) {
+		__m128i pixels = _mm_loadu_si128((const __m128i*)(source + x * 4));
+		_mm_storeu_si128((__m128i*)(destination + x * 3), _mm_shuffle_epi8(pixels, shuffle));
+	}
+	return x;
+}
+#endif
+
+/*!
+* Zamienia składowe R i B w wierszu 24-bitowych pikseli (BGR na RGB i odwrotnie).
+* \param uint8_t* destination Wiersz wynikowy.
+* \param const uint8_t* source Wiersz źródłowy.
+* \param uint32_t width Ilość pikseli w wierszu.
+*/
+static void swap_red_blue_row(uint8_t* destination, const uint8_t* source, uint32_t width) {
+	uint32_t x = 0;
+#ifdef BMP_CODEC_SSSE3
+	if (cpu_has_ssse3()) x = swap_red_blue_row_ssse3(destination, source, width);
+#endif
+	for (; x < width; x++) {
+		destination[x * 3] = source[x * 3 + 2];
+		destination[x * 3 + 1] = source[x * 3 + 1];
+		destination[x * 3 + 2] = source[x * 3];
+	}
+}
+
+/*!
+* Zamienia wiersz 32-bitowych pikseli BGRA na 24-bitowe RGB, kanał alpha jest pomijany.
+* \param uint8_t* destination Wiersz wynikowy.
+* \param const uint8_t* source Wiersz źródłowy.
+* \param uint32_t width Ilość pikseli w wierszu.
+*/
+static void bgra_to_rgb_row(uint8_t* destination, const uint8_t* source, uint32_t width) {
+	uint32_t x = 0;
+#ifdef BMP_CODEC_SSSE3
+	if (cpu_has_ssse3()) x = bgra_to_rgb_row_ssse3(destination, source, width);
+#endif
+	for (; x < width; x++) {
+		destination[x * 3] = source[x * 4 + 2];
+		destination[x * 3 + 1] = source[x * 4 + 1];
+		destination[x * 3 + 2] = source[x * 4];
+	}
+}
+
+/*!
+* Odczytuje składową koloru z 32-bitowego piksela według maski BI_BITFIELDS i skaluje ją do 8 bitów.
+* \param uint32_t pixel Piksel.
+* \param uint32_t mask Maska składowej.
+*/
+static uint8_t read_masked_component(uint32_t pixel, uint32_t mask) {
+	if (mask == 0) return 0;
+	uint32_t shift = 0;
+	while (!((mask >> shift) & 1)) shift++;
+	uint32_t max_value = mask >> shift;
+	return (uint8_t)(((pixel & mask) >> shift) * 255 / max_value);
+}
+
+/*!
+* Odczytuje i sprawdza nagłówki pliku BMP. Obsługiwane są nagłówki BITMAPCOREHEADER i BITMAPINFOHEADER (oraz nowsze),
+* bez kompresji dla 1, 4, 8, 24 i 32 bitów na piksel oraz BI_BITFIELDS dla 32 bitów.
+* \param const uint8_t* file Zawartość pliku.
+* \param uint64_t file_size Rozmiar pliku.
+* \param BmpHeader* header Odczytany nagłówek.
+* \returns true, jeśli plik jest obsługiwany.
+*/
+static bool read_bmp_header(const uint8_t* file, uint64_t file_size, BmpHeader* header) {
+	if (file_size < 26 || file[0] != 'B' || file[1] != 'M') return false;
+
+	header->pixel_offset = read_u32(file + 10);
+	header->dib_size = read_u32(file + 14);
+	header->compression = 0;
+	header->palette_size = 0;
+
+	if (header->dib_size == 12) {
+		header->width = read_u16(file + 18);
+		header->height = (int16_t)read_u16(file + 20);
+		header->bits_per_pixel = read_u16(file + 24);
+	}
+	else if (header->dib_size >= 40 && file_size >= 54) {
+		header->width = (int32_t)read_u32(file + 18);
+		header->height = (int32_t)read_u32(file + 22);
+		header->bits_per_pixel = read_u16(file + 28);
+		header->compression = read_u32(file + 30);
+		header->palette_size = read_u32(file + 46);
+	}
+	else {
+		return false;
+	}
+
+	header->masks[0] = 0x00FF0000;
+	header->masks[1] = 0x0000FF00;
+	header->masks[2] = 0x000000FF;
+	if (header->compression == 3) {
+		//! Maski są w nagłówku od BITMAPV2INFOHEADER, a dla BITMAPINFOHEADER zaraz za nim.
+		if (header->bits_per_pixel != 32 || file_size < 14 + 40 + 12) return false;
+		for (uint32_t i = 0; i < 3; i++) header->masks[i] = read_u32(file + 54 + i * 4);
+	}
+	else if (header->compression != 0) {
+		return false;
+	}
+
+	if (header->bits_per_pixel <= 8) {
+		if (header->bits_per_pixel != 1 && header->bits_per_pixel != 4 && header->bits_per_pixel != 8) return false;
+		if (header->palette_size == 0 || header->palette_size > (1u << header->bits_per_pixel)) {
+			header->palette_size = 1u << header->bits_per_pixel;
+		}
+	}
+	else if (header->bits_per_pixel != 24 && header->bits_per_pixel != 32) {
+		return false;
+	}
+
+	if (header->width <= 0 || header->height == 0 || header->height == INT32_MIN) return false;
+	uint64_t stride = (((uint64_t)header->width * header->bits_per_pixel + 31) / 32) * 4;
+	uint64_t rows = header->height < 0 ? -(int64_t)header->height : header->height;
+	return header->pixel_offset + stride * rows <= file_size;
+}
+
+/*!
+* Dekoduje plik BMP bezpośrednio do tablicy składowych kolorów RGB (3 na piksel, wiersze od góry), używanej przez as_array.
+* Uwzględnia wiersze zapisane od dołu i od góry oraz wyrównanie wierszy do 4 bajtów.
+* Dla plików 24 i 32-bitowych zamiana kolejności składowych wykonywana jest instrukcjami SSSE3, jeśli procesor je obsługuje.
+* \param const char* path Ścieżka do pliku.
+* \param uint32_t* width Szerokość obrazu.
+* \param uint32_t* height Wysokość obrazu.
+* \returns Tablica pikseli do zwolnienia przez stbi_image_free albo NULL, jeśli pliku nie udało się odczytać lub format nie jest obsługiwany.
+*/
+uint8_t* decode_bmp(const char* path, uint32_t* width, uint32_t* height) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return NULL;
+
+	fseek(file, 0, SEEK_END);
+	long file_size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	uint8_t* data = file_size > 0 ? malloc(file_size) : NULL;
+	if (data == NULL || fread(data, 1, file_size, file) != (size_t)file_size) {
+		free(data);
+		fclose(file);
+		return NULL;
+	}
+	fclose(file);
+
+	BmpHeader header;
+	if (!read_bmp_header(data, file_size, &header)) {
+		free(data);
+		return NULL;
+	}
+
+	uint32_t image_width = header.width;
+	uint32_t image_height = header.height < 0 ? -header.height : header.height;
+	bool bottom_up = header.height > 0;
+	uint64_t stride = (((uint64_t)image_width * header.bits_per_pixel + 31) / 32) * 4;
+
+	uint8_t* as_array = malloc((uint64_t)image_width * image_height * 3);
+	if (as_array == NULL) {
+		free(data);
+		return NULL;
+	}
+
+	//! Paleta dla obrazów 1, 4 i 8-bitowych, wpisy mają 4 bajty (BGRx), a przy nagłówku BITMAPCOREHEADER 3 bajty.
+	uint8_t palette[256][3] = { 0 };
+	if (header.bits_per_pixel <= 8) {
+		uint32_t entry_size = header.dib_size == 12 ? 3 : 4;
+		const uint8_t* palette_data = data + 14 + header.dib_size;
+		for (uint32_t i = 0; i < header.palette_size && palette_data + i * entry_size + 3 <= data + header.pixel_offset; i++) {
+			palette[i][0] = palette_data[i * entry_size + 2];
+			palette[i][1] = palette_data[i * entry_size + 1];
+			palette[i][2] = palette_data[i * entry_size];
+		}
+	}
+
+	bool standard_masks = header.masks[0] == 0x00FF0000 && header.masks[1] == 0x0000FF00 && header.masks[2] == 0x000000FF;
+
+	for (uint32_t y = 0; y < image_height; y++) {
+		const uint8_t* source = data + header.pixel_offset + stride * (bottom_up ? image_height - 1 - y : y);
+		uint8_t* destination = as_array + (uint64_t)y * image_width * 3;
+
+		switch (header.bits_per_pixel) {
+		case 24:
+			swap_red_blue_row(destination, source, image_width);
+			break;
+		case 32:
+			if (standard_masks) {
+				bgra_to_rgb_row(destination, source, image_width);
+			}
+			else {
+				for (uint32_t x = 0; x < image_width; x++) {
+					uint32_t pixel = read_u32(source + x * 4);
+					destination[x * 3] = read_masked_component(pixel, header.masks[0]);
+					destination[x * 3 + 1] = read_masked_component(pixel, header.masks[1]);
+					destination[x * 3 + 2] = read_masked_component(pixel, header.masks[2]);
+				}
+			}
+			break;
+		default:
+			//! Piksele z palety: kolejne indeksy zapisane są od najstarszych bitów bajtu.
+			for (uint32_t x = 0; x < image_width; x++) {
+				uint32_t bit = x * header.bits_per_pixel;
+				uint32_t shift = 8 - header.bits_per_pixel - bit % 8;
+				uint8_t color_index = (source[bit / 8] >> shift) & ((1 << header.bits_per_pixel) - 1);
+				destination[x * 3] = palette[color_index][0];
+				destination[x * 3 + 1] = palette[color_index][1];
+				destination[x * 3 + 2] = palette[color_index][2];
+			}
+			break;
+		}
+	}
+
+	free(data);
+	*width = image_width;
+	*height = image_height;
+	return as_array;
+}
+
+/*!
+* Zapisuje tablicę składowych kolorów RGB jako 24-bitowy plik BMP z wierszami od dołu.
+* Każdy wiersz jest zamieniany na BGR (instrukcjami SSSE3, jeśli to możliwe) i uzupełniany do wielokrotności 4 bajtów.
+* \param const char* path Ścieżka do pliku.
+* \param const uint8_t* as_array Piksele obrazu, 3 składowe na piksel.
+* \param uint32_t width Szerokość obrazu.
+* \param uint32_t height Wysokość obrazu.
+* \returns true dla powodzenia operacji, false dla niepowodzenia.
+*/
+bool encode_bmp(const char* path, const uint8_t* as_array, uint32_t width, uint32_t height) {
+	//! Tak jak w decode_bmp, szerokość wiersza liczymy na 64 bitach, 32 bity przepełniają się już przy 179 mln pikseli szerokości.
+	uint64_t stride = (((uint64_t)width * 24 + 31) / 32) * 4;
+	uint64_t image_size = stride * height;
+	if (width > INT32_MAX || height > INT32_MAX || image_size + 54 > UINT32_MAX) return false;
+
+	uint8_t header[54] = { 'B', 'M' };
+	write_u32(header + 2, (uint32_t)(54 + image_size));
+	write_u32(header + 10, 54);
+	write_u32(header + 14, 40);
+	write_u32(header + 18, width);
+	write_u32(header + 22, height);
+	header[26] = 1;
+	header[28] = 24;
+	write_u32(header + 34, (uint32_t)image_size);
+
+	//! Bufor wiersza ma zapas na 16-bajtowe zapisy SIMD.
+	uint8_t* row = calloc(stride + 16, 1);
+	FILE* file = fopen(path, "wb");
+	if (row == NULL || file == NULL) {
+		free(row);
+		if (file) fclose(file);
+		return false;
+	}
+
+	bool success = fwrite(header, 1, sizeof(header), file) == sizeof(header);
+	for (uint32_t y = height; success && y > 0; y--) {
+		swap_red_blue_row(row, as_array + (uint64_t)(y - 1) * width * 3, width);
+		//! Bajty wyrównania mogły zostać nadpisane przez zapis SIMD.
+		memset(row + (uint64_t)width * 3, 0, stride - (uint64_t)width * 3);
+		success = fwrite(row, 1, stride, file) == stride;
+	}
+
+	free(row);
+	return fclose(file) == 0 && success;
+}
+
+//! Rozmiar bufora, przez który strumieniowo zapisywane i czytane są pliki QOI.
+#define QOI_STREAM_BUFFER_SIZE 65536
+
+//! Kody operacji formatu QOI.
+#define QOI_OP_INDEX 0x00
+#define QOI_OP_DIFF 0x40
+#define QOI_OP_LUMA 0x80
+#define QOI_OP_RUN 0xc0
+#define QOI_OP_RGB 0xfe
+#define QOI_MASK_2 0xc0
+
+//! Pozycja piksela w tablicy ostatnio widzianych kolorów QOI.
+#define QOI_COLOR_HASH(r, g, b, a) (((r) * 3 + (g) * 5 + (b) * 7 + (a) * 11) % 64)
+
+//! Zapis liczby big-endian do bufora.
+static void write_u32_big_endian(uint8_t* data, uint32_t value) {
+	data[0] = value >> 24;
+	data[1] = value >> 16;
+	data[2] = value >> 8;
+	data[3] = value;
+}
+
+//! Odczyt liczby big-endian z bufora.
+static uint32_t read_u32_big_endian(const uint8_t* data) {
+	return (uint32_t)data[0] << 24 | data[1] << 16 | data[2] << 8 | data[3];
+}
+
+/*!
+* Sprawdza, czy ścieżka kończy się podanym rozszerzeniem, bez względu na wielkość liter.
+* \param const char* path Ścieżka do pliku.
+* \param const char* extension Rozszerzenie z kropką, małymi literami.
+*/
+bool has_file_extension(const char* path, const char* extension) {
+	size_t path_length = strlen(path);
+	size_t extension_length = strlen(extension);
+	if (path_length < extension_length) return false;
+	for (size_t i = 0; i < extension_length; i++) {
+		if (tolower((unsigned char)path[path_length - extension_length + i]) != extension[i]) return false;
+	}
+	return true;
+}
+
+/*!
+* Zapisuje tablicę składowych kolorów RGB w bezstratnym formacie QOI, przeznaczonym na szybkie zapisy pośrednich wyników.
+* Piksele kodowane są strumieniowo przez bufor o stałym rozmiarze, bez tworzenia całego pliku w pamięci.
+* \param const char* path Ścieżka do pliku.
+* \param const uint8_t* as_array Piksele obrazu, 3 składowe na piksel.
+* \param uint32_t width Szerokość obrazu.
+* \param uint32_t height Wysokość obrazu.
+* \returns true dla powodzenia operacji, false dla niepowodzenia.
+*/
+bool encode_qoi(const char* path, const uint8_t* as_array, uint32_t width, uint32_t height) {
+	uint8_t* buffer = malloc(QOI_STREAM_BUFFER_SIZE);
+	FILE* file = fopen(path, "wb");
+	if (buffer == NULL || file == NULL) {
+		free(buffer);
+		if (file) fclose(file);
+		return false;
+	}
+
+	uint32_t used = 0;
+	bool success = true;
+	memcpy(buffer, "qoif", 4);
+	write_u32_big_endian(buffer + 4, width);
+	write_u32_big_endian(buffer + 8, height);
+	buffer[12] = 3;
+	buffer[13] = 0;
+	used = 14;
+
+	//! Tablica kolorów ma kanał alpha jak w dekoderze: pusta pozycja {0, 0, 0, 0} nie może pasować do czarnego piksela {0, 0, 0, 255}.
+	uint8_t seen_colors[64][4] = { 0 };
+	uint8_t previous[3] = { 0, 0, 0 };
+	uint32_t run = 0;
+	uint64_t pixel_amount = (uint64_t)width * height;
+
+	for (uint64_t i = 0; i < pixel_amount && success; i++) {
+		//! Największa operacja ma 4 bajty, a razem z zakończeniem serii 5.
+		if (used + 5 > QOI_STREAM_BUFFER_SIZE) {
+			success = fwrite(buffer, 1, used, file) == used;
+			used = 0;
+		}
+
+		const uint8_t* pixel = as_array + i * 3;
+		if (pixel[0] == previous[0] && pixel[1] == previous[1] && pixel[2] == previous[2]) {
+			run++;
+			if (run == 62 || i + 1 == pixel_amount) {
+				buffer[used++] = QOI_OP_RUN | (run - 1);
+				run = 0;
+			}
+			continue;
+		}
+
+		if (run > 0) {
+			buffer[used++] = QOI_OP_RUN | (run - 1);
+			run = 0;
+		}
+
+		uint8_t color[4] = { pixel[0], pixel[1], pixel[2], 255 };
+		uint32_t hash = QOI_COLOR_HASH(color[0], color[1], color[2], color[3]);
+		if (!memcmp(seen_colors[hash], color, 4)) {
+			buffer[used++] = QOI_OP_INDEX | hash;
+		}
+		else {
+			memcpy(seen_colors[hash], color, 4);
+
+			int8_t red_difference = (int8_t)(pixel[0] - previous[0]);
+			int8_t green_difference = (int8_t)(pixel[1] - previous[1]);
+			int8_t blue_difference = (int8_t)(pixel[2] - previous[2]);
+			int8_t red_green = red_difference - green_difference;
+			int8_t blue_green = blue_difference - green_difference;
+
+			if (red_difference >= -2 && red_difference <= 1
+				&& green_difference >= -2 && green_difference <= 1
+				&& blue_difference >= -2 && blue_difference <= 1) {
+				buffer[used++] = QOI_OP_DIFF | (red_difference + 2) << 4 | (green_difference + 2) << 2 | (blue_difference + 2);
+			}
+			else if (green_difference >= -32 && green_difference <= 31
+				&& red_green >= -8 && red_green <= 7
+				&& blue_green >= -8 && blue_green <= 7) {
+				buffer[used++] = QOI_OP_LUMA | (green_difference + 32);
+				buffer[used++] = (red_green + 8) << 4 | (blue_green + 8);
+			}
+			else {
+				buffer[used++] = QOI_OP_RGB;
+				buffer[used++] = pixel[0];
+				buffer[used++] = pixel[1];
+				buffer[used++] = pixel[2];
+			}
+		}
+		memcpy(previous, pixel, 3);
+	}
+
+	static const uint8_t end_marker[8] = { 0, 0, 0, 0, 0, 0, 0, 1 };
+	if (success) success = fwrite(buffer, 1, used, file) == used;
+	if (success) success = fwrite(end_marker, 1, sizeof(end_marker), file) == sizeof(end_marker);
+
+	free(buffer);
+	return fclose(file) == 0 && success;
+}
+
+/*!
+* Dekoduje plik QOI bezpośrednio do tablicy składowych kolorów RGB. Plik czytany jest strumieniowo przez bufor o stałym rozmiarze.
+* Kanał alpha plików 4-kanałowych jest pomijany.
+* \param const char* path Ścieżka do pliku.
+* \param uint32_t* width Szerokość obrazu.
+* \param uint32_t* height Wysokość obrazu.
+* \returns Tablica pikseli do zwolnienia przez stbi_image_free albo NULL w przypadku błędu.
+*/
+uint8_t* decode_qoi(const char* path, uint32_t* width, uint32_t* height) {
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return NULL;
+
+	uint8_t* buffer = malloc(QOI_STREAM_BUFFER_SIZE);
+	uint32_t available = buffer ? (uint32_t)fread(buffer, 1, QOI_STREAM_BUFFER_SIZE, file) : 0;
+	if (available < 14 || memcmp(buffer, "qoif", 4)) {
+		free(buffer);
+		fclose(file);
+		return NULL;
+	}
+
+	uint32_t image_width = read_u32_big_endian(buffer + 4);
+	uint32_t image_height = read_u32_big_endian(buffer + 8);
+	uint32_t channels = buffer[12];
+	uint64_t pixel_amount = (uint64_t)image_width * image_height;
+
+	uint8_t* as_array = pixel_amount && (channels == 3 || channels == 4) ? malloc(pixel_amount * 3) : NULL;
+	if (as_array == NULL) {
+		free(buffer);
+		fclose(file);
+		return NULL;
+	}
+
+	//! Dekoder śledzi też kanał alpha, bo wchodzi on do pozycji koloru w tablicy ostatnio widzianych kolorów.
+	uint8_t seen_colors[64][4] = { 0 };
+	uint8_t pixel[4] = { 0, 0, 0, 255 };
+	uint32_t run = 0;
+	uint32_t position = 14;
+	bool success = true;
+
+	for (uint64_t i = 0; i < pixel_amount; i++) {
+		if (run > 0) {
+			run--;
+		}
+		else {
+			//! Dosuwamy nieprzeczytaną resztę na początek bufora, żeby operacja (do 5 bajtów) nie przekraczała jego końca.
+			if (available - position < 5) {
+				uint32_t remaining = available - position;
+				memmove(buffer, buffer + position, remaining);
+				available = remaining + (uint32_t)fread(buffer + remaining, 1, QOI_STREAM_BUFFER_SIZE - remaining, file);
+				position = 0;
+				if (available == 0) {
+					success = false;
+					break;
+				}
+			}
+
+			uint8_t operation = buffer[position++];
+			if (operation == QOI_OP_RGB) {
+				pixel[0] = buffer[position++];
+				pixel[1] = buffer[position++];
+				pixel[2] = buffer[position++];
+			}
+			else if (operation == 0xff) {
+				pixel[0] = buffer[position++];
+				pixel[1] = buffer[position++];
+				pixel[2] = buffer[position++];
+				pixel[3] = buffer[position++];
+			}
+			else if ((operation & QOI_MASK_2) == QOI_OP_INDEX) {
+				memcpy(pixel, seen_colors[operation], 4);
+			}
+			else if ((operation & QOI_MASK_2) == QOI_OP_DIFF) {
+				pixel[0] += ((operation >> 4) & 0x03) - 2;
+				pixel[1] += ((operation >> 2) & 0x03) - 2;
+				pixel[2] += (operation & 0x03) - 2;
+			}
+			else if ((operation & QOI_MASK_2) == QOI_OP_LUMA) {
+				uint8_t second = buffer[position++];
+				int green_difference = (operation & 0x3f) - 32;
+				pixel[0] += green_difference - 8 + ((second >> 4) & 0x0f);
+				pixel[1] += green_difference;
+				pixel[2] += green_difference - 8 + (second & 0x0f);
+			}
+			else {
+				run = operation & 0x3f;
+			}
+			memcpy(seen_colors[QOI_COLOR_HASH(pixel[0], pixel[1], pixel[2], pixel[3])], pixel, 4);
+		}
+		memcpy(as_array + i * 3, pixel, 3);
+	}
+
+	free(buffer);
+	fclose(file);
+	if (!success) {
+		free(as_array);
+		return NULL;
+	}
+	*width = image_width;
+	*height = image_height;
+	return as_array;
+}
+
+/*!
+* Zapisuje tablicę składowych kolorów RGB w formacie wybranym na podstawie rozszerzenia: .qoi w formacie QOI, pozostałe jako BMP.
+* \param const char* path Ścieżka do pliku.
+* \param const uint8_t* as_array Piksele obrazu, 3 składowe na piksel.
+* \param uint32_t width Szerokość obrazu.
+* \param uint32_t height Wysokość obrazu.
+* \returns true dla powodzenia operacji, false dla niepowodzenia.
+*/
+bool write_image_pixels(const char* path, const uint8_t* as_array, uint32_t width, uint32_t height) {
+	if (has_file_extension(path, ".qoi")) return encode_qoi(path, as_array, width, height);
+	return encode_bmp(path, as_array, width, height);
+}
+
+/*!
+* Wczytuje piksele obrazu jako RGB (3 składowe na piksel). Pliki .qoi dekoduje decode_qoi, pliki BMP decode_bmp,
+* a formaty przez nią nieobsługiwane (np. z kompresją RLE) biblioteka stb.
+* \param const char* path Ścieżka do pliku.
+* \param uint32_t* width Szerokość obrazu.
+* \param uint32_t* height Wysokość obrazu.
+* \returns Tablica pikseli do zwolnienia przez stbi_image_free albo NULL w przypadku błędu.
+*/
+uint8_t* read_image_pixels(const char* path, uint32_t* width, uint32_t* height) {
+	if (has_file_extension(path, ".qoi")) return decode_qoi(path, width, height);
+
+	uint8_t* as_array = decode_bmp(path, width, height);
+	if (as_array) return as_array;
+
+	int comp = 0;
+	return stbi_load(path, (int*)width, (int*)height, &comp, 3);
+}
+
+
+/*!
+* Funkcja tworząca ALLEGRO_BITMAP do wyświetlenia bezpośrednio z tablicy pikseli as_array, bez ponownego odczytu pliku z dysku.
+* Jeśli obraz ma już bitmapę o takich samych wymiarach, jest ona wykorzystywana ponownie.
+* Bitmapa jest blokowana w formacie ABGR_8888_LE (w pamięci kolejno R, G, B, A), więc kopiowanie wiersza to tylko dopisanie kanału alpha.
+* \param Image* image Obraz, którego bitmapa jest odświeżana.
+*/
+void update_image_bitmap(Image* image) {
+	if (image->image
+		&& (al_get_bitmap_width(image->image) != image->width || al_get_bitmap_height(image->image) != image->height)) {
+		al_destroy_bitmap(image->image);
+		image->image = NULL;
+	}
+	if (image->image == NULL) {
+		image->image = al_create_bitmap(image->width, image->height);
+		if (image->image == NULL) {
+			puts("error when create bitmap\n");
+			return;
+		}
+	}
+
+	ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(image->image, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	if (region == NULL) {
+		puts("error when lock bitmap\n");
+		return;
+	}
+
+	//! W obu układach pikseli odcinek wiersza o długości boku kafelka, zaczynający się na granicy kafelka, leży w pamięci w jednym kawałku.
+	const uint32_t segment = 1u << IMAGE_TILE_SHIFT;
+	for (uint32_t y = 0; y < image->height; y++) {
+		//! pitch może być ujemny, dlatego przesunięcie wiersza liczymy ze znakiem
+		uint8_t* row = (uint8_t*)region->data + (int64_t)y * region->pitch;
+		for (uint32_t segment_x = 0; segment_x < image->width; segment_x += segment) {
+			const uint8_t* source = image->as_array + pixel_offset(image, segment_x, y);
+			uint8_t* destination = row + segment_x * 4;
+			uint32_t length = image->width - segment_x < segment ? image->width - segment_x : segment;
+			for (uint32_t x = 0; x < length; x++) {
+				destination[x * 4] = source[x * 3];
+				destination[x * 4 + 1] = source[x * 3 + 1];
+				destination[x * 4 + 2] = source[x * 3 + 2];
+				destination[x * 4 + 3] = 255;
+			}
+		}
+	}
+
+	al_unlock_bitmap(image->image);
+}
 
 /*!
 * Funkcja wczytująca plik .bmp do struktury Image, przekazywanej jako wskaźnik.
 * W przypadku, gdy wcześniej był już wczytywany plik, usuwa go z pamięci.
-* Tworzy ALLEGRO_BITMAP oraz wczytuje obraz do tablicy pikseli (dokładniej do tablicy składowych kolorów).
+* Dekoduje plik raz, do tablicy pikseli (dokładniej do tablicy składowych kolorów, zawsze 3 na piksel),
+* a ALLEGRO_BITMAP tworzy z tej tablicy przez update_image_bitmap. Przy IMAGE_LOAD_TILED zamienia tablicę na kafelki.
+* Zdekodowane obrazy pobiera z pamięci podręcznej, więc obraz wczytany wcześniej w tle jest tylko kopiowany.
 * Ustawia zmienne odpowiedzialne za wysokość, szerokość zdjęcia oraz współczynnik skalowania przy wyświetlaniu.
 * Wczytuje zmienne potrzebne do biblioteki stb(stb_x, stb_y, stb_comp) w celu zapisywania zdjęcia.
 * Określa, czy zdjęcie jest na tyle małe, żeby można było wykorzystać go w trybie wizualizacji.
+* Gdy pliku nie da się wczytać, obraz zostaje bez zmian.
 * \param Image* image Wczytywany obraz.
 * \param ALLEGRO_USTR* image_name Struktura Allegro5 pozwalająca na przekazanie nazwy obrazu ze znakami UTF-8.
 */
 void load_image(Image* image, ALLEGRO_USTR* image_name) {
-	if (image->image) al_destroy_bitmap(image->image);
-	if (image->as_array) stbi_image_free(image->as_array);
-
-	image->path = al_cstr(image_name);
-	printf("Image: %s\n", image->path);
+	TRACE_BEGIN(load_span);
 
 	uint32_t x;
 	uint32_t y;
-	uint32_t comp;
-
-	image->as_array = stbi_load(image->path, &x, &y, &comp, 0);
-	image->image = al_load_bitmap(image->path);
-	if (image->image == NULL) puts("error when load bitmap\n");
-	image->width = al_get_bitmap_width(image->image);
-	image->height = al_get_bitmap_height(image->image);
-	image->stb_comp = comp;
+
+	//! Pamięć podręczna zawsze zwraca 3 składowe na piksel, z takiego układu korzystają wszystkie funkcje operujące na as_array.
+	//! Poprzedni obraz zwalniamy dopiero po udanym wczytaniu, więc po błędzie zostaje on na ekranie razem ze swoimi wymiarami.
+	uint8_t* as_array = get_cached_image(al_cstr(image_name), &x, &y);
+	if (as_array == NULL) {
+		puts("error when load image\n");
+		TRACE_END(load_span, "load_image");
+		return;
+	}
+	if (image->as_array) stbi_image_free(image->as_array);
+	image->path = al_cstr(image_name);
+	image->as_array = as_array;
+	image->width = x;
+	image->height = y;
+	image->stb_comp = 3;
 	image->stb_x = x;
 	image->stb_y = y;
+	image->layout = IMAGE_LAYOUT_ROW_MAJOR;
+	image->tile_columns = 0;
+#if IMAGE_LOAD_TILED
+	//! Bez pamięci na kopię obraz zostaje w wierszach, wszystkie funkcje obsługują oba układy.
+	if (!convert_image_layout(image, IMAGE_LAYOUT_TILED)) puts("error when convert image layout\n");
+#endif
+
+	update_image_bitmap(image);
+	printf("Image: %s\n", image->path);
 
 	if (image->width > image->height)
 	{
@@ -61,19 +757,32 @@ void load_image(Image* image, ALLEGRO_USTR* image_name) {
 		visualization_mode_available = false;
 		visualisation_mode = false;
 	}
+	TRACE_END(load_span, "load_image");
 }
 
 /*!
-* Funkcja zapisująca obraz do pliku .bmp. Jako argumenty przyjmuje nazwę pliku, tablicę składowych kolorów pikseli
-* oraz zmienne związane z biblioteką STB
-* \param uint8_t* name Nazwa obrazu.
-* \param uint8_t* as_array Obraz reprezentowany jako tablica uint8_t w pamięci.
-* \param uint32_t x Długość obrazu.
-* \param uint32_t y Szerokość obrazu.
-* \param uint32_t comp Ilość kanałów w obrazie.
+* Funkcja zapisująca obraz do pliku .bmp. Jako argumenty przyjmuje nazwę pliku i zapisywany obraz.
+* Obrazy RGB zapisuje write_image_pixels (dla rozszerzenia .qoi w formacie QOI), pozostałe biblioteka stb.
+* Obraz w kafelkach jest przed zapisem kopiowany do tymczasowej tablicy w układzie wierszy.
+* \param const char* name Nazwa obrazu.
+* \param const Image* image Zapisywany obraz.
 */
-void save_image_to_bmp(uint8_t* name, uint8_t* as_array, uint32_t x, uint32_t y, uint32_t comp) {
-	stbi_write_bmp(name, x, y, comp, as_array);
+void save_image_to_bmp(const char* name, const Image* image) {
+	TRACE_BEGIN(save_span);
+	if (image->layout == IMAGE_LAYOUT_ROW_MAJOR) {
+		if (image->stb_comp != 3 || !write_image_pixels(name, image->as_array, image->width, image->height)) {
+			stbi_write_bmp(name, image->stb_x, image->stb_y, image->stb_comp, image->as_array);
+		}
+	}
+	else {
+		uint8_t* as_array = malloc((uint64_t)image->width * image->height * 3);
+		if (as_array) copy_row_major_pixels(as_array, image);
+		if (as_array == NULL || !write_image_pixels(name, as_array, image->width, image->height)) {
+			puts("error when save image\n");
+		}
+		free(as_array);
+	}
+	TRACE_END(save_span, "save_image_to_bmp");
 }
 
 
@@ -87,6 +796,86 @@ void clean_up_image(Image* image) {
 	if (image->as_array) stbi_image_free(image->as_array);
 }
 
+/*!
+* Wyznacza położenie pierwszej składowej piksela w tablicy as_array, w układzie pikseli obrazu. Współrzędne nie są sprawdzane.
+* W układzie IMAGE_LAYOUT_TILED sąsiedzi w pionie leżą zwykle w tym samym kafelku, kilka linii pamięci podręcznej dalej,
+* zamiast całego wiersza obrazu dalej.
+* \param const Image* image Obraz.
+* \param uint32_t x Koordynat X piksela.
+* \param uint32_t y Koordynat Y piksela.
+* \returns Indeks składowej R piksela.
+*/
+uint64_t pixel_offset(const Image* image, uint32_t x, uint32_t y) {
+	if (image->layout == IMAGE_LAYOUT_ROW_MAJOR) return ((uint64_t)y * image->width + x) * 3;
+
+	const uint32_t mask = (1u << IMAGE_TILE_SHIFT) - 1;
+	uint64_t tile = (uint64_t)(y >> IMAGE_TILE_SHIFT) * image->tile_columns + (x >> IMAGE_TILE_SHIFT);
+	return ((tile << (2 * IMAGE_TILE_SHIFT)) + ((uint64_t)(y & mask) << IMAGE_TILE_SHIFT) + (x & mask)) * 3;
+}
+
+/*!
+* Zwraca rozmiar tablicy as_array w bajtach. W układzie IMAGE_LAYOUT_TILED obejmuje dopełnienie kafelków na prawej i dolnej krawędzi.
+* \param const Image* image Obraz.
+*/
+uint64_t image_buffer_size(const Image* image) {
+	if (image->layout == IMAGE_LAYOUT_ROW_MAJOR) return (uint64_t)image->width * image->height * 3;
+
+	uint64_t tile_rows = ((uint64_t)image->height + (1u << IMAGE_TILE_SHIFT) - 1) >> IMAGE_TILE_SHIFT;
+	return (tile_rows * image->tile_columns << (2 * IMAGE_TILE_SHIFT)) * 3;
+}
+
+/*!
+* Zamienia układ pikseli obrazu, np. na kafelki po wczytaniu i z powrotem na wiersze przed zapisem lub wyświetleniem.
+* Tworzy nową tablicę as_array i zwalnia poprzednią. Dopełnienie kafelków ma kolor czarny i nie należy do obrazu.
+* \param Image* image Zmieniany obraz.
+* \param image_layout_t layout Nowy układ pikseli.
+* \returns true, jeśli obraz ma teraz podany układ, false, gdy zabrakło pamięci i obraz się nie zmienił.
+*/
+bool convert_image_layout(Image* image, image_layout_t layout) {
+	if (image->layout == layout) return true;
+
+	Image converted = *image;
+	converted.layout = layout;
+	converted.tile_columns = layout == IMAGE_LAYOUT_TILED ? (image->width + (1u << IMAGE_TILE_SHIFT) - 1) >> IMAGE_TILE_SHIFT : 0;
+	converted.as_array = calloc(image_buffer_size(&converted), 1);
+	if (converted.as_array == NULL) return false;
+
+	//! Odcinki wiersza o długości boku kafelka są w obu układach ciągłe, więc kopiujemy je w całości.
+	const uint32_t segment = 1u << IMAGE_TILE_SHIFT;
+	for (uint32_t y = 0; y < image->height; y++) {
+		for (uint32_t x = 0; x < image->width; x += segment) {
+			uint32_t length = image->width - x < segment ? image->width - x : segment;
+			memcpy(converted.as_array + pixel_offset(&converted, x, y), image->as_array + pixel_offset(image, x, y), (size_t)length * 3);
+		}
+	}
+
+	stbi_image_free(image->as_array);
+	image->as_array = converted.as_array;
+	image->layout = converted.layout;
+	image->tile_columns = converted.tile_columns;
+	return true;
+}
+
+/*!
+* Kopiuje piksele obrazu do tablicy w układzie wiersz po wierszu, takim jak w plikach obrazów. Obrazu nie zmienia.
+* \param uint8_t* destination Tablica na width * height * 3 składowych.
+* \param const Image* image Kopiowany obraz w dowolnym układzie.
+*/
+void copy_row_major_pixels(uint8_t* destination, const Image* image) {
+	if (image->layout == IMAGE_LAYOUT_ROW_MAJOR) {
+		memcpy(destination, image->as_array, (uint64_t)image->width * image->height * 3);
+		return;
+	}
+
+	const uint32_t segment = 1u << IMAGE_TILE_SHIFT;
+	for (uint32_t y = 0; y < image->height; y++) {
+		for (uint32_t x = 0; x < image->width; x += segment) {
+			uint32_t length = image->width - x < segment ? image->width - x : segment;
+			memcpy(destination + ((uint64_t)y * image->width + x) * 3, image->as_array + pixel_offset(image, x, y), (size_t)length * 3);
+		}
+	}
+}
+
 /*!
 * Funkcja umieszczająca kolor badanego piksela w strukturze Color_t, która jest modyfikowana w tej funkcji, 
 * dlatego musi byæ przekazana jako wskaźnik. Do odczytania koloru potrzebuje współrzędnych piksela oraz struktury Image.
@@ -97,14 +886,18 @@ void clean_up_image(Image* image) {
 */
 void get_pixel_color(Color_t* current_color, uint32_t mouse_x, uint32_t mouse_y, Image* image) {
 
-	if (mouse_x < 0 || mouse_x > image->width || mouse_y < 0 || mouse_y > image->height)
+	if (mouse_x >= image->width || mouse_y >= image->height)
 	{
+		COUNT_PIXEL_ACCESS(rejected_pixel_accesses);
 		return;
 	}
+	COUNT_PIXEL_ACCESS(pixel_reads);
+	COUNT_PIXEL_VISIT(mouse_x, mouse_y, image);
 
-	current_color->r = image->as_array[mouse_x * 3 + mouse_y * image->width * 3];
-	current_color->g = image->as_array[mouse_x * 3 + mouse_y * image->width * 3 + 1];
-	current_color->b = image->as_array[mouse_x * 3 + mouse_y * image->width * 3 + 2];
+	const uint8_t* pixel = image->as_array + pixel_offset(image, mouse_x, mouse_y);
+	current_color->r = pixel[0];
+	current_color->g = pixel[1];
+	current_color->b = pixel[2];
 }
 
 /*!
@@ -117,12 +910,38 @@ void get_pixel_color(Color_t* current_color, uint32_t mouse_x, uint32_t mouse_y,
 */
 void swap_color(Image* image, uint32_t mouse_x, uint32_t mouse_y) {
 
-	if (mouse_x < 0 || mouse_x > image->width || mouse_y < 0 || mouse_y > image->height)
+	if (mouse_x >= image->width || mouse_y >= image->height)
+	{
+		COUNT_PIXEL_ACCESS(rejected_pixel_accesses);
+		return;
+	}
+	COUNT_PIXEL_ACCESS(pixel_writes);
+
+	uint8_t* pixel = image->as_array + pixel_offset(image, mouse_x, mouse_y);
+	pixel[0] = replacement_color.r;
+	pixel[1] = replacement_color.g;
+	pixel[2] = replacement_color.b;
+}
+
+/*!
+* Funkcja ustawiająca dowolny kolor określonego piksela, w odróżnieniu od swap_color nie korzysta z replacement_color.
+* W przypadku wyjścia poza obszar zdjęcia funkcja przerywa swoje działanie, nie robiąc nic.
+* \param Image* image Obraz w którym zmieniamy kolor piksela.
+* \param uint32_t mouse_x Koordynat X zamienianego piksela.
+* \param uint32_t mouse_y Koordynat Y zamienianego piksela.
+* \param Color_t color Nowy kolor piksela.
+*/
+void set_pixel_color(Image* image, uint32_t mouse_x, uint32_t mouse_y, Color_t color) {
+
+	if (mouse_x >= image->width || mouse_y >= image->height)
 	{
+		COUNT_PIXEL_ACCESS(rejected_pixel_accesses);
 		return;
 	}
+	COUNT_PIXEL_ACCESS(pixel_writes);
 
-	image->as_array[mouse_x * 3 + mouse_y * image->width * 3] = replacement_color.r;
-	image->as_array[mouse_x * 3 + 1 + mouse_y * image->width * 3] = replacement_color.g;
-	image->as_array[mouse_x * 3 + 2 + mouse_y * image->width * 3] = replacement_color.b;
+	uint8_t* pixel = image->as_array + pixel_offset(image, mouse_x, mouse_y);
+	pixel[0] = color.r;
+	pixel[1] = color.g;
+	pixel[2] = color.b;
 }
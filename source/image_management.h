@@ -3,7 +3,20 @@
 #include "values.h"
 
 void load_image(Image*, ALLEGRO_USTR*);
-void save_image_to_bmp(uint8_t*, uint8_t*, uint32_t, uint32_t, uint32_t);
+void update_image_bitmap(Image*);
+void save_image_to_bmp(const char*, const Image*);
+uint8_t* decode_bmp(const char*, uint32_t*, uint32_t*);
+bool encode_bmp(const char*, const uint8_t*, uint32_t, uint32_t);
+uint8_t* read_image_pixels(const char*, uint32_t*, uint32_t*);
+bool encode_qoi(const char*, const uint8_t*, uint32_t, uint32_t);
+uint8_t* decode_qoi(const char*, uint32_t*, uint32_t*);
+bool write_image_pixels(const char*, const uint8_t*, uint32_t, uint32_t);
+bool has_file_extension(const char*, const char*);
 void clean_up_image(Image*);
 void get_pixel_color(Color_t*, uint32_t, uint32_t, Image*);
 void swap_color(Image*, uint32_t, uint32_t);
+void set_pixel_color(Image*, uint32_t, uint32_t, Color_t);
+uint64_t pixel_offset(const Image*, uint32_t, uint32_t);
+uint64_t image_buffer_size(const Image*);
+bool convert_image_layout(Image*, image_layout_t);
+void copy_row_major_pixels(uint8_t*, const Image*);
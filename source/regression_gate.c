@@ -0,0 +1,277 @@
+//! \file regression_gate.c Zapis wyników pomiarów jako punktu odniesienia w pliku JSON i wykrywanie regresji względem niego, z raportem w formacie Markdown.
+
+#define _CRT_SECURE_NO_WARNINGS
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "regression_gate.h"
+#include "values.h"
+
+/*!
+* Dodaje wynik pomiaru do BenchmarkEntries, używana jako benchmark_callback_t przez run_benchmark_suite.
+* Gdy zabraknie pamięci, wynik nie jest dodawany i ustawiane jest BenchmarkEntries::failed.
+* \param const char* image_name Nazwa obrazu.
+* \param const BenchmarkResult* result Wyniki pomiaru.
+* \param void* context Uzupełniane BenchmarkEntries.
+*/
+void collect_benchmark_entry(const char* image_name, const BenchmarkResult* result, void* context) {
+	BenchmarkEntries* entries = context;
+	if (entries->amount == entries->capacity) {
+		uint32_t capacity = entries->capacity ? entries->capacity * 2 : 64;
+		BenchmarkEntry* resized = realloc(entries->entries, sizeof(BenchmarkEntry) * capacity);
+		if (resized == NULL) {
+			entries->failed = true;
+			return;
+		}
+		entries->entries = resized;
+		entries->capacity = capacity;
+	}
+
+	BenchmarkEntry* entry = &entries->entries[entries->amount++];
+	snprintf(entry->image, sizeof(entry->image), "%s", image_name);
+	entry->result = *result;
+}
+
+/*!
+* Zwalnia pamięć wyników pomiarów.
+* \param BenchmarkEntries* entries Wyniki pomiarów.
+*/
+void free_benchmark_entries(BenchmarkEntries* entries) {
+	free(entries->entries);
+	memset(entries, 0, sizeof(BenchmarkEntries));
+}
+
+/*!
+* Zapisuje wyniki pomiarów jako punkt odniesienia, jeden obiekt JSON na wiersz, żeby zmiany były czytelne w historii repozytorium.
+* \param const char* path Ścieżka do pliku JSON.
+* \param const BenchmarkEntries* entries Wyniki pomiarów.
+* \returns true, jeśli plik został zapisany.
+*/
+bool write_baseline(const char* path, const BenchmarkEntries* entries) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) return false;
+
+	fprintf(file, "{\n\t\"version\": 1,\n\t\"results\": [\n");
+	for (uint32_t i = 0; i < entries->amount; i++) {
+		const BenchmarkResult* result = &entries->entries[i].result;
+		fprintf(
+			file,
+			"\t\t{\"image\": \"%s\", \"algorithm\": \"%s\", \"cache\": \"%s\", \"runs\": %u, \"min_ms\": %.6f, \"median_ms\": %.6f, \"p95_ms\": %.6f, \"mad_ms\": %.6f, \"filled_pixels\": %llu}%s\n",
+			entries->entries[i].image,
+			algorithm_names[result->algorithm],
+			result->cold_cache ? "cold" : "warm",
+			result->runs,
+			result->min,
+			result->median,
+			result->p95,
+			result->mad,
+			(unsigned long long)result->filled_pixels,
+			i + 1 < entries->amount ? "," : ""
+		);
+	}
+	fprintf(file, "\t]\n}\n");
+	return fclose(file) == 0;
+}
+
+/*!
+* Znajduje wartość klucza w obiekcie JSON bez zagnieżdżeń.
+* \param const char* object Początek obiektu.
+* \param const char* end Koniec obiektu.
+* \param const char* key Szukany klucz.
+* \returns Wskaźnik na pierwszy znak wartości albo NULL.
+*/
+static const char* find_json_value(const char* object, const char* end, const char* key) {
+	size_t key_length = strlen(key);
+	for (const char* position = object; position + key_length + 2 < end; position++) {
+		if (*position == '"' && !strncmp(position + 1, key, key_length) && position[key_length + 1] == '"') {
+			position += key_length + 2;
+			while (position < end && (*position == ' ' || *position == '\t' || *position == ':')) position++;
+			return position < end ? position : NULL;
+		}
+	}
+	return NULL;
+}
+
+/*!
+* Odczytuje wartość tekstową klucza z obiektu JSON.
+* \param const char* object Początek obiektu.
+* \param const char* end Koniec obiektu.
+* \param const char* key Szukany klucz.
+* \param char* text Bufor na wartość.
+* \param size_t size Rozmiar bufora.
+* \returns true, jeśli klucz istnieje i jego wartość zmieściła się w buforze.
+*/
+static bool read_json_string(const char* object, const char* end, const char* key, char* text, size_t size) {
+	const char* value = find_json_value(object, end, key);
+	if (value == NULL || *value != '"') return false;
+	const char* closing = memchr(value + 1, '"', end - value - 1);
+	if (closing == NULL || (size_t)(closing - value - 1) >= size) return false;
+	memcpy(text, value + 1, closing - value - 1);
+	text[closing - value - 1] = '\0';
+	return true;
+}
+
+/*!
+* Odczytuje wartość liczbową klucza z obiektu JSON.
+* \param const char* object Początek obiektu.
+* \param const char* end Koniec obiektu.
+* \param const char* key Szukany klucz.
+* \returns Wartość albo 0, jeśli klucza nie ma.
+*/
+static double read_json_number(const char* object, const char* end, const char* key) {
+	const char* value = find_json_value(object, end, key);
+	return value ? strtod(value, NULL) : 0;
+}
+
+/*!
+* Wczytuje punkt odniesienia zapisany przez write_baseline. Wyniki algorytmów, których nazw już nie ma, są pomijane.
+* \param const char* path Ścieżka do pliku JSON.
+* \param BenchmarkEntries* entries Wczytane wyniki, należy je zwolnić przez free_benchmark_entries także przy błędzie.
+* \returns true, jeśli plik został wczytany i zawiera co najmniej jeden wynik; brak tablicy "results", brak wyników albo brak pamięci są błędem.
+*/
+bool read_baseline(const char* path, BenchmarkEntries* entries) {
+	memset(entries, 0, sizeof(BenchmarkEntries));
+	FILE* file = fopen(path, "rb");
+	if (file == NULL) return false;
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+	char* text = size > 0 ? malloc(size + 1) : NULL;
+	if (text == NULL || fread(text, 1, size, file) != (size_t)size) {
+		free(text);
+		fclose(file);
+		return false;
+	}
+	fclose(file);
+	text[size] = '\0';
+
+	const char* position = strstr(text, "\"results\"");
+	while (position && (position = strchr(position, '{')) != NULL) {
+		const char* end = strchr(position, '}');
+		if (end == NULL) break;
+
+		char image[64];
+		char algorithm[64];
+		char cache[8];
+		if (read_json_string(position, end, "image", image, sizeof(image))
+			&& read_json_string(position, end, "algorithm", algorithm, sizeof(algorithm))
+			&& read_json_string(position, end, "cache", cache, sizeof(cache))) {
+			for (uint32_t i = 0; i < ALGORITHM_AMOUNT; i++) {
+				if (strcmp(algorithm_names[i], algorithm)) continue;
+
+				BenchmarkResult result = { 0 };
+				result.algorithm = (algorithm_t)i;
+				result.cold_cache = !strcmp(cache, "cold");
+				result.runs = (uint32_t)read_json_number(position, end, "runs");
+				result.min = read_json_number(position, end, "min_ms");
+				result.median = read_json_number(position, end, "median_ms");
+				result.p95 = read_json_number(position, end, "p95_ms");
+				result.mad = read_json_number(position, end, "mad_ms");
+				result.filled_pixels = (uint64_t)read_json_number(position, end, "filled_pixels");
+				collect_benchmark_entry(image, &result, entries);
+				break;
+			}
+		}
+		position = end + 1;
+	}
+
+	free(text);
+	return !entries->failed && entries->amount > 0;
+}
+
+/*!
+* Szuka wyniku dla tej samej pary obrazu (z ziarnem) i algorytmu, przy tym samym rodzaju pamięci podręcznej.
+* \param const BenchmarkEntries* entries Przeszukiwane wyniki.
+* \param const BenchmarkEntry* wanted Szukany wynik.
+* \returns Znaleziony wynik albo NULL.
+*/
+static const BenchmarkEntry* find_matching_entry(const BenchmarkEntries* entries, const BenchmarkEntry* wanted) {
+	for (uint32_t i = 0; i < entries->amount; i++) {
+		const BenchmarkEntry* entry = &entries->entries[i];
+		if (entry->result.algorithm == wanted->result.algorithm
+			&& entry->result.cold_cache == wanted->result.cold_cache
+			&& !strcmp(entry->image, wanted->image)) return entry;
+	}
+	return NULL;
+}
+
+/*!
+* Porównuje obecne wyniki z punktem odniesienia i zapisuje tabelę różnic w formacie Markdown.
+* Mediany porównywane są z progiem szumu: REGRESSION_MAD_FACTOR odchyleń standardowych szacowanych jako 1.4826 * MAD z obu pomiarów,
+* nie mniej niż REGRESSION_MIN_RELATIVE mediany i REGRESSION_MIN_MILLISECONDS. Zmiana ilości wypełnionych pikseli też jest błędem,
+* bo obrazy są generowane deterministycznie.
+* \param const BenchmarkEntries* baseline Punkt odniesienia.
+* \param const BenchmarkEntries* current Obecne wyniki.
+* \param FILE* report Plik na raport.
+* \returns Ilość regresji.
+*/
+uint32_t compare_with_baseline(const BenchmarkEntries* baseline, const BenchmarkEntries* current, FILE* report) {
+	uint32_t regressions = 0;
+	uint32_t improvements = 0;
+
+	fprintf(report, "| Image | Algorithm | Cache | Baseline median (ms) | Current median (ms) | Change | Threshold (ms) | Status |\n");
+	fprintf(report, "|---|---|---|---:|---:|---:|---:|---|\n");
+
+	for (uint32_t i = 0; i < current->amount; i++) {
+		const BenchmarkEntry* entry = &current->entries[i];
+		const BenchmarkEntry* reference = find_matching_entry(baseline, entry);
+		fprintf(
+			report,
+			"| %s | %s | %s | ",
+			entry->image,
+			algorithm_names[entry->result.algorithm],
+			entry->result.cold_cache ? "cold" : "warm"
+		);
+
+		if (reference == NULL) {
+			fprintf(report, "- | %.4f | - | - | new |\n", entry->result.median);
+			continue;
+		}
+
+		double difference = entry->result.median - reference->result.median;
+		double sigma = 1.4826 * sqrt(entry->result.mad * entry->result.mad + reference->result.mad * reference->result.mad);
+		double threshold = fmax(REGRESSION_MAD_FACTOR * sigma, fmax(REGRESSION_MIN_RELATIVE * reference->result.median, REGRESSION_MIN_MILLISECONDS));
+
+		const char* status = "ok";
+		if (entry->result.filled_pixels != reference->result.filled_pixels) {
+			status = "**filled pixels changed**";
+			regressions++;
+		}
+		else if (difference > threshold) {
+			status = "**regression**";
+			regressions++;
+		}
+		else if (-difference > threshold) {
+			status = "faster";
+			improvements++;
+		}
+
+		fprintf(
+			report,
+			"%.4f | %.4f | %+.1f%% | %.4f | %s |\n",
+			reference->result.median,
+			entry->result.median,
+			reference->result.median > 0 ? difference / reference->result.median * 100 : 0.0,
+			threshold,
+			status
+		);
+	}
+
+	for (uint32_t i = 0; i < baseline->amount; i++) {
+		const BenchmarkEntry* entry = &baseline->entries[i];
+		if (find_matching_entry(current, entry)) continue;
+		fprintf(
+			report,
+			"| %s | %s | %s | %.4f | - | - | - | not measured |\n",
+			entry->image,
+			algorithm_names[entry->result.algorithm],
+			entry->result.cold_cache ? "cold" : "warm",
+			entry->result.median
+		);
+	}
+
+	fprintf(report, "\n%u regressions, %u improvements in %u results.\n", regressions, improvements, current->amount);
+	return regressions;
+}
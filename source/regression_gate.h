@@ -0,0 +1,36 @@
+//! \file regression_gate.h Porównanie wyników pomiarów z zapisanym punktem odniesienia.
+
+#pragma once
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "values.h"
+#include "benchmark.h"
+
+//! Spowolnienie jest regresją, gdy przekracza tyle odchyleń standardowych szacowanych z MAD obu pomiarów...
+#define REGRESSION_MAD_FACTOR 3.0
+//! ...i jednocześnie tę część mediany z punktu odniesienia...
+#define REGRESSION_MIN_RELATIVE 0.05
+//! ...i tę ilość milisekund, bo najmniejsze obrazy wypełniają się w mikrosekundach.
+#define REGRESSION_MIN_MILLISECONDS 0.01
+
+//! Wynik pomiaru jednego algorytmu na jednym obrazie.
+typedef struct BenchmarkEntry {
+	char image[64];
+	BenchmarkResult result;
+} BenchmarkEntry;
+
+//! Wyniki pomiarów, powiększane w miarę dodawania.
+typedef struct BenchmarkEntries {
+	BenchmarkEntry* entries;
+	uint32_t amount;
+	uint32_t capacity;
+	//! Ustawiane, gdy zabrakło pamięci na wynik; zebrane wyniki są wtedy niepełne.
+	bool failed;
+} BenchmarkEntries;
+
+void collect_benchmark_entry(const char*, const BenchmarkResult*, void*);
+void free_benchmark_entries(BenchmarkEntries*);
+bool write_baseline(const char*, const BenchmarkEntries*);
+bool read_baseline(const char*, BenchmarkEntries*);
+uint32_t compare_with_baseline(const BenchmarkEntries*, const BenchmarkEntries*, FILE*);
@@ -0,0 +1,189 @@
+//! \file result_writer.c Zapisywanie wyników wypełniania w osobnym wątku, z dwoma buforami na kopie obrazu.
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <allegro5/allegro.h>
+#include "values.h"
+#include "image_management.h"
+#include "result_writer.h"
+#include "trace.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+/*!
+* Stan wątku zapisującego, chroniony przez mutex.
+* Wątek zapisuje bufor writing_slot, a nowe kopie obrazu trafiają zawsze do drugiego bufora.
+* Kolejna kopia zgłoszona przed rozpoczęciem zapisu poprzedniej nadpisuje ją, jeśli ma ten sam plik docelowy, więc zapisywany
+* jest tylko najnowszy stan pliku. Kopia do innego pliku czeka, aż wątek zabierze oczekującą, żeby żaden plik nie przepadł.
+*/
+typedef struct ResultWriter {
+	uint8_t* buffers[2];
+	uint64_t capacities[2];
+	uint32_t writing_slot;
+	char pending_path[256];
+	uint32_t pending_width;
+	uint32_t pending_height;
+	bool has_pending;
+	bool writing;
+	bool stop;
+	uint64_t coalesced_writes; //! ilość kopii nadpisanych przed zapisem przez nowszą kopię tego samego pliku
+
+	ALLEGRO_MUTEX* mutex;
+	ALLEGRO_COND* changed;
+	ALLEGRO_THREAD* thread;
+} ResultWriter;
+
+static ResultWriter writer = { 0 };
+
+/*!
+* Zapisuje obraz do pliku tymczasowego, a następnie zamienia go z docelowym plikiem,
+* dzięki czemu plik docelowy nigdy nie jest zapisany tylko częściowo.
+* \param const char* path Ścieżka do pliku docelowego.
+* \param const uint8_t* as_array Piksele obrazu, 3 składowe na piksel.
+* \param uint32_t width Szerokość obrazu.
+* \param uint32_t height Wysokość obrazu.
+*/
+static void write_atomically(const char* path, const uint8_t* as_array, uint32_t width, uint32_t height) {
+	char temporary_path[272];
+	snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+	TRACE_BEGIN(write_span);
+
+	//! Format wybieramy na podstawie pliku docelowego, plik tymczasowy ma rozszerzenie .tmp.
+	bool written = has_file_extension(path, ".qoi")
+		? encode_qoi(temporary_path, as_array, width, height)
+		: encode_bmp(temporary_path, as_array, width, height);
+	if (!written) {
+		printf("error when write %s\n", temporary_path);
+		remove(temporary_path);
+		return;
+	}
+#ifdef _WIN32
+	if (!MoveFileExA(temporary_path, path, MOVEFILE_REPLACE_EXISTING)) {
+#else
+	if (rename(temporary_path, path) != 0) {
+#endif
+		printf("error when rename %s\n", temporary_path);
+		remove(temporary_path);
+	}
+	TRACE_END(write_span, "write_result");
+}
+
+/*!
+* Wątek zapisujący zgłoszone kopie obrazu. Przed zakończeniem zapisuje ostatnią oczekującą kopię.
+* \param ALLEGRO_THREAD* thread Wątek Allegro.
+* \param void* arg Nieużywany.
+*/
+static void* result_writer_thread(ALLEGRO_THREAD* thread, void* arg) {
+	al_lock_mutex(writer.mutex);
+	while (true) {
+		while (!writer.has_pending && !writer.stop) {
+			al_wait_cond(writer.changed, writer.mutex);
+		}
+		if (!writer.has_pending) break;
+
+		//! Zabieramy bufor z oczekującą kopią, kolejne kopie trafią do drugiego bufora.
+		writer.writing_slot = 1 - writer.writing_slot;
+		writer.has_pending = false;
+		writer.writing = true;
+		al_broadcast_cond(writer.changed);
+		char path[256];
+		strcpy(path, writer.pending_path);
+		uint32_t width = writer.pending_width;
+		uint32_t height = writer.pending_height;
+		uint8_t* as_array = writer.buffers[writer.writing_slot];
+		al_unlock_mutex(writer.mutex);
+
+		write_atomically(path, as_array, width, height);
+
+		al_lock_mutex(writer.mutex);
+		writer.writing = false;
+		al_broadcast_cond(writer.changed);
+	}
+	al_unlock_mutex(writer.mutex);
+	return NULL;
+}
+
+//! Uruchamia wątek zapisujący wyniki.
+void init_result_writer() {
+	writer.mutex = al_create_mutex();
+	writer.changed = al_create_cond();
+	writer.thread = al_create_thread(result_writer_thread, NULL);
+	if (writer.thread) al_start_thread(writer.thread);
+}
+
+//! Zapisuje oczekującą kopię, zatrzymuje wątek zapisujący i zwalnia bufory.
+void destroy_result_writer() {
+	if (writer.mutex == NULL) return;
+
+	al_lock_mutex(writer.mutex);
+	writer.stop = true;
+	al_broadcast_cond(writer.changed);
+	al_unlock_mutex(writer.mutex);
+	if (writer.thread) al_destroy_thread(writer.thread);
+
+	if (writer.coalesced_writes) printf("Result writes coalesced: %llu\n", writer.coalesced_writes);
+	free(writer.buffers[0]);
+	free(writer.buffers[1]);
+	al_destroy_cond(writer.changed);
+	al_destroy_mutex(writer.mutex);
+	memset(&writer, 0, sizeof(writer));
+}
+
+/*!
+* Zgłasza obraz do zapisania w tle. Kopiuje piksele do wolnego bufora w układzie wierszy, więc obraz można od razu dalej modyfikować.
+* Bez działającego wątku zapisuje obraz od razu. Jeśli czeka kopia innego pliku, funkcja czeka, aż wątek ją zabierze.
+* \param const char* path Ścieżka do pliku .bmp.
+* \param const Image* image Zapisywany obraz.
+*/
+void queue_result_write(const char* path, const Image* image) {
+	if (writer.thread == NULL) {
+		save_image_to_bmp(path, image);
+		return;
+	}
+
+	uint32_t width = image->width;
+	uint32_t height = image->height;
+	uint64_t size = (uint64_t)width * height * 3;
+	al_lock_mutex(writer.mutex);
+	//! Łączymy tylko zapisy do tego samego pliku, oczekującą kopię innego pliku wątek musi najpierw zabrać.
+	while (writer.has_pending && strcmp(writer.pending_path, path) != 0) {
+		al_wait_cond(writer.changed, writer.mutex);
+	}
+	uint32_t slot = 1 - writer.writing_slot;
+	if (writer.capacities[slot] < size) {
+		uint8_t* buffer = realloc(writer.buffers[slot], size);
+		if (buffer == NULL) {
+			al_unlock_mutex(writer.mutex);
+			printf("error when allocating copy of %s, not written\n", path);
+			return;
+		}
+		writer.buffers[slot] = buffer;
+		writer.capacities[slot] = size;
+	}
+	if (writer.has_pending) writer.coalesced_writes++;
+
+	copy_row_major_pixels(writer.buffers[slot], image);
+	snprintf(writer.pending_path, sizeof(writer.pending_path), "%s", path);
+	writer.pending_width = width;
+	writer.pending_height = height;
+	writer.has_pending = true;
+	al_broadcast_cond(writer.changed);
+	al_unlock_mutex(writer.mutex);
+}
+
+//! Czeka, aż wszystkie zgłoszone obrazy zostaną zapisane.
+void flush_result_writer() {
+	if (writer.thread == NULL) return;
+
+	al_lock_mutex(writer.mutex);
+	while (writer.has_pending || writer.writing) {
+		al_wait_cond(writer.changed, writer.mutex);
+	}
+	al_unlock_mutex(writer.mutex);
+}
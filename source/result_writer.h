@@ -0,0 +1,11 @@
+//! \file result_writer.h Zapisywanie wyników wypełniania w tle.
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "values.h"
+
+void init_result_writer();
+void destroy_result_writer();
+void queue_result_write(const char*, const Image*);
+void flush_result_writer();
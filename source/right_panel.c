@@ -5,7 +5,38 @@
 #include <allegro5/allegro_ttf.h>
 #include <allegro5/allegro_primitives.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 #include "values.h"
+#include "fill_algorithms.h"
+
+//! Nazwy algorytmów, w kolejności z algorithm_t. Używane w panelu oraz w wynikach pomiarów.
+const char* algorithm_names[] = {
+	"STACK_BASED_RECURSIVE_FOUR_WAY",
+	"STACK_BASED_RECURSIVE_EIGHT_WAY",
+	"QUEUE_BASED_FOUR_WAY",
+	"RECURSIVE_SCANLINE",
+	"PAINTER_FOUR_WAY",
+	"PARALLEL_BFS_FOUR_WAY",
+	"RASTER_SWEEP_FOUR_WAY",
+	"RECURSIVE_SCANLINE_EIGHT_WAY"
+};
+
+#if MEASURE_HARDWARE_COUNTERS
+/*!
+* Zapisuje wartość licznika sprzętowego jako tekst albo "--", jeśli licznik jest niedostępny.
+* \param char* text Bufor na tekst, co najmniej 24 znaki.
+* \param hardware_counter_t counter Wypisywany licznik.
+*/
+static void format_hardware_counter(char* text, hardware_counter_t counter) {
+	if (measure_values.hardware_counters.available & (1u << counter)) {
+		snprintf(text, 24, "%llu", measure_values.hardware_counters.values[counter]);
+	}
+	else {
+		snprintf(text, 24, "--");
+	}
+}
+#endif
 
 /*!
 * Wyświetlanie prawego panelu z informacjami. 
@@ -18,14 +49,6 @@ void show_right_panel(algorithm_t algorithm, bool show_measure_result) {
 
 	ALLEGRO_USTR_INFO info;
 
-	//! Nazwy algorytmów
-	static uint8_t* algorithm_names[] = {
-		"STACK_BASED_RECURSIVE_FOUR_WAY",
-		"STACK_BASED_RECURSIVE_EIGHT_WAY",
-		"QUEUE_BASED_FOUR_WAY",
-		"RECURSIVE_SCANLINE"
-	};
-
 	al_draw_text(
 		hint_font,
 		al_map_rgb(150, 150, 150),
@@ -94,20 +117,25 @@ void show_right_panel(algorithm_t algorithm, bool show_measure_result) {
 		al_ref_cstr(&info, "ZMIENIAJ ALGORYTMY STRZAŁKAMI")
 	);
 
+	//! Odstęp między algorytmami na liście, ostatni zaczyna się najniżej na 0.6 wysokości okna.
+	//! Gdy algorytmów jest dużo, zmniejszamy odstęp i czcionkę.
+	double algorithm_spacing = ALGORITHM_AMOUNT > 4 ? 0.15 / (ALGORITHM_AMOUNT - 1) : 0.05;
+	ALLEGRO_FONT* algorithm_font = algorithm_spacing >= 0.03 ? main_font : hint_font;
+
 	al_draw_filled_rectangle( // Podœwietlenie obecnego algorytmu
 		window_width * 0.59,
-		window_height * 0.397 + window_height * (algorithm + 1) * 0.05,
+		window_height * 0.447 + window_height * algorithm * algorithm_spacing,
 		window_width * 0.9,
-		window_height * 0.4 + window_height * (algorithm + 1) * 0.05 + window_height / 30, // punkt pocz¹tkowy + wysokoœæ czcionki
+		window_height * 0.45 + window_height * algorithm * algorithm_spacing + window_height * (algorithm_spacing >= 0.03 ? 1.0 / 30 : algorithm_spacing), // punkt pocz¹tkowy + wysokoœæ czcionki
 		al_map_rgb(100, 100, 150)
 	);
 
 	for (uint32_t i = 0; i < ALGORITHM_AMOUNT; i++) { // Wyœwietlenie wszystkich algorytmów
 		al_draw_textf(
-			main_font,
+			algorithm_font,
 			al_map_rgb(200, 200, 200),
 			window_width * 0.6,
-			window_height * 0.4 + window_height * (i + 1) * 0.05,
+			window_height * 0.45 + window_height * i * algorithm_spacing,
 			0,
 			"%s",
 			algorithm_names[i]
@@ -164,9 +192,78 @@ void show_right_panel(algorithm_t algorithm, bool show_measure_result) {
 		);
 		al_ustr_free(function_call_amount);
 
+		//! Po wypełnieniu wszystkich obszarów zamiast wysokości stosu pokazujemy ilość obszarów i przepustowość
+		if (measure_values.region_count > 0) {
+			ALLEGRO_USTR* region_count = al_ustr_newf(
+				"ILOŚĆ OBSZARÓW: %llu (%.1f Mpx/s)",
+				measure_values.region_count,
+				measure_values.megapixels_per_second
+			);
+			al_draw_ustr(
+				main_font,
+				al_map_rgb(200, 200, 200),
+				window_width * 0.6,
+				window_height * 0.85,
+				0,
+				region_count
+			);
+			al_ustr_free(region_count);
+		}
+		//! Algorytm o stałej pamięci nie korzysta ze stosu, pokazujemy ile kroków zrobił po krawędzi obszaru
+		else if (algorithm == PAINTER_FOUR_WAY) {
+			ALLEGRO_USTR* boundary_steps = al_ustr_newf(
+				"KROKI PO KRAWĘDZI: %llu (%.2f/px)",
+				measure_values.boundary_steps,
+				(double)measure_values.boundary_steps / filled_pixel_amount()
+			);
+			al_draw_ustr(
+				main_font,
+				al_map_rgb(200, 200, 200),
+				window_width * 0.6,
+				window_height * 0.85,
+				0,
+				boundary_steps
+			);
+			al_ustr_free(boundary_steps);
+		}
+		//! Równoległy BFS nie korzysta ze stosu, pokazujemy ilość poziomów, czyli największą odległość od klikniętego piksela
+		else if (algorithm == PARALLEL_BFS_FOUR_WAY) {
+			ALLEGRO_USTR* bfs_levels = al_ustr_newf(
+				"POZIOMY BFS: %llu (%u WĄTKI)",
+				measure_values.bfs_levels,
+				measure_values.bfs_threads
+			);
+			al_draw_ustr(
+				main_font,
+				al_map_rgb(200, 200, 200),
+				window_width * 0.6,
+				window_height * 0.85,
+				0,
+				bfs_levels
+			);
+			al_ustr_free(bfs_levels);
+		}
+		//! Algorytm przejść rastra nie korzysta ze stosu, pokazujemy ile razy przeszedł obraz
+		else if (algorithm == RASTER_SWEEP_FOUR_WAY) {
+			ALLEGRO_USTR* sweep_count = al_ustr_newf("PRZEJŚCIA OBRAZU: %llu", measure_values.sweep_count);
+			al_draw_ustr(
+				main_font,
+				al_map_rgb(200, 200, 200),
+				window_width * 0.6,
+				window_height * 0.85,
+				0,
+				sweep_count
+			);
+			al_ustr_free(sweep_count);
+		}
 		//Pomijamy liczenie wysokosci stosu w algorytmie, który go nie wykorzystuje
-		if (algorithm != QUEUE_BASED_FOUR_WAY) {
-			ALLEGRO_USTR* max_stack_height = al_ustr_newf("MAKSYMALNA WYSOKOŚĆ STOSU: %llu", measure_values.max_stack_height);
+		else if (algorithm != QUEUE_BASED_FOUR_WAY) {
+			//! Zmierzone zużycie stosu pokazujemy w KB, a przejście na wersję iteracyjną zamiast niego
+			ALLEGRO_USTR* max_stack_height = measure_values.stack_fallback_count > 0
+				? al_ustr_newf("MAKSYMALNA WYSOKOŚĆ STOSU: %llu (KONIEC STOSU, DALEJ ITERACYJNIE)", measure_values.max_stack_height)
+				: measure_values.max_stack_bytes > 0
+					? al_ustr_newf("MAKSYMALNA WYSOKOŚĆ STOSU: %llu (%llu KB)", measure_values.max_stack_height, measure_values.max_stack_bytes / 1024)
+					: al_ustr_newf("MAKSYMALNA WYSOKOŚĆ STOSU: %llu", measure_values.max_stack_height);
 			al_draw_ustr(
 				main_font,
 				al_map_rgb(200, 200, 200),
@@ -190,5 +287,119 @@ void show_right_panel(algorithm_t algorithm, bool show_measure_result) {
 			}
 			al_ustr_free(current_stack_height);
 		}
+
+#if MEASURE_PIXEL_ACCESSES
+		//! Odczyty i zapisy na wypełniony piksel, nad statystykami obszaru
+		if (measure_values.region_count == 0 && measure_values.pixel_writes > 0) {
+			uint64_t filled_pixels = filled_pixel_amount();
+			ALLEGRO_USTR* pixel_accesses = al_ustr_newf(
+				"ODCZYTY: %llu (%.2f/px), ZAPISY: %llu (%.2f/px), POZA OBRAZEM: %llu",
+				measure_values.pixel_reads,
+				(double)measure_values.pixel_reads / filled_pixels,
+				measure_values.pixel_writes,
+				(double)measure_values.pixel_writes / filled_pixels,
+				measure_values.rejected_pixel_accesses
+			);
+			al_draw_ustr(
+				hint_font,
+				al_map_rgb(200, 200, 200),
+				window_width * 0.6,
+				window_height * 0.88,
+				0,
+				pixel_accesses
+			);
+			al_ustr_free(pixel_accesses);
+		}
+#endif
+
+#if MEASURE_REGION_STATS
+		//! Statystyki wypełnionego obszaru liczone są tylko w trybie pomiaru czasu
+		if (!visualisation_mode && measure_values.region_count == 0 && measure_values.area > 0) {
+			ALLEGRO_USTR* region_bounds = al_ustr_newf(
+				"POLE: %llu px, RAMKA: (%u, %u) - (%u, %u)",
+				measure_values.area,
+				measure_values.min_x,
+				measure_values.min_y,
+				measure_values.max_x,
+				measure_values.max_y
+			);
+			al_draw_ustr(
+				hint_font,
+				al_map_rgb(200, 200, 200),
+				window_width * 0.6,
+				window_height * 0.9,
+				0,
+				region_bounds
+			);
+			al_ustr_free(region_bounds);
+
+			ALLEGRO_USTR* region_shape = al_ustr_newf(
+				"ŚRODEK: (%.1f, %.1f), OBWÓD: %llu px",
+				(double)measure_values.sum_x / measure_values.area,
+				(double)measure_values.sum_y / measure_values.area,
+				measure_values.perimeter_pixels
+			);
+			al_draw_ustr(
+				hint_font,
+				al_map_rgb(200, 200, 200),
+				window_width * 0.6,
+				window_height * 0.93,
+				0,
+				region_shape
+			);
+			al_ustr_free(region_shape);
+		}
+#endif
+
+#if MEASURE_HARDWARE_COUNTERS
+		//! Liczniki sprzętowe w trybie wizualizacji obejmują rysowanie i opóźnienia, więc ich nie pokazujemy
+		if (!visualisation_mode) {
+			const HardwareCounters* counters = &measure_values.hardware_counters;
+			ALLEGRO_USTR* counters_text = NULL;
+			ALLEGRO_USTR* misses_text = NULL;
+
+			if (counters->available) {
+				char instructions[24], cycles[24], l1d_misses[24], llc_misses[24], branch_misses[24], dtlb_misses[24];
+				format_hardware_counter(instructions, COUNTER_INSTRUCTIONS);
+				format_hardware_counter(cycles, COUNTER_CYCLES);
+				format_hardware_counter(l1d_misses, COUNTER_L1D_MISSES);
+				format_hardware_counter(llc_misses, COUNTER_LLC_MISSES);
+				format_hardware_counter(branch_misses, COUNTER_BRANCH_MISSES);
+				format_hardware_counter(dtlb_misses, COUNTER_DTLB_MISSES);
+
+				uint32_t ipc_counters = (1u << COUNTER_INSTRUCTIONS) | (1u << COUNTER_CYCLES);
+				counters_text = (counters->available & ipc_counters) == ipc_counters && counters->values[COUNTER_CYCLES] > 0
+					? al_ustr_newf("INSTRUKCJE: %s, CYKLE: %s, IPC: %.2f", instructions, cycles,
+						(double)counters->values[COUNTER_INSTRUCTIONS] / counters->values[COUNTER_CYCLES])
+					: al_ustr_newf("INSTRUKCJE: %s, CYKLE: %s", instructions, cycles);
+				misses_text = al_ustr_newf("CHYBIENIA L1D: %s, LLC: %s, SKOKI: %s, DTLB: %s", l1d_misses, llc_misses, branch_misses, dtlb_misses);
+			}
+			else {
+				counters_text = al_ustr_new("LICZNIKI SPRZĘTOWE NIEDOSTĘPNE");
+			}
+
+			al_draw_ustr(
+				hint_font,
+				al_map_rgb(170, 170, 200),
+				window_width * 0.6,
+				window_height * 0.96,
+				0,
+				counters_text
+			);
+			al_ustr_free(counters_text);
+
+			if (misses_text) {
+				al_draw_ustr(
+					hint_font,
+					al_map_rgb(170, 170, 200),
+					window_width * 0.6,
+					window_height * 0.98,
+					0,
+					misses_text
+				);
+				al_ustr_free(misses_text);
+			}
+		}
+#endif
 	}
 }
\ No newline at end of file
@@ -0,0 +1,101 @@
+//! \file stack_guard.c Pomiar zużycia stosu przez próbkowanie wskaźnika stosu i wyznaczanie granicy stosu obecnego wątku.
+
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdbool.h>
+#include "stack_guard.h"
+#include "values.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#include <intrin.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sys/resource.h>
+#endif
+
+//! Przybliżony wskaźnik stosu w miejscu wywołania, stos rośnie w dół.
+#ifdef _MSC_VER
+#define STACK_POINTER() ((uintptr_t)_AddressOfReturnAddress())
+#else
+#define STACK_POINTER() ((uintptr_t)__builtin_frame_address(0))
+#endif
+
+//! Stan ochrony stosu dla obecnego wypełniania.
+typedef struct StackGuard {
+	uintptr_t base; //! wskaźnik stosu na początku wypełniania
+	uintptr_t limit; //! najniższy bezpieczny adres, poniżej niego algorytm przechodzi na wersję iteracyjną
+	uintptr_t lowest; //! najniższy zaobserwowany wskaźnik stosu
+
+	//! Granica stosu jest pamiętana, bo dla głównego wątku jej odczyt wymaga czytania /proc/self/maps.
+	uintptr_t cached_low;
+	uintptr_t cached_stack_pointer;
+} StackGuard;
+
+static StackGuard guard = { 0 };
+
+/*!
+* Wyznacza najniższy adres stosu obecnego wątku: GetCurrentThreadStackLimits w Windows, pthread_getattr_np w Linuksie,
+* a gdy to się nie uda, getrlimit z zapasem na część stosu zajętą powyżej obecnego wskaźnika.
+* \param uintptr_t stack_pointer Obecny wskaźnik stosu.
+*/
+static uintptr_t find_stack_low(uintptr_t stack_pointer) {
+#ifdef _WIN32
+	ULONG_PTR low = 0;
+	ULONG_PTR high = 0;
+	GetCurrentThreadStackLimits(&low, &high);
+	if (low != 0 && low < stack_pointer) return (uintptr_t)low;
+#elif defined(__linux__)
+	pthread_attr_t attributes;
+	if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+		void* address = NULL;
+		size_t size = 0;
+		int result = pthread_attr_getstack(&attributes, &address, &size);
+		pthread_attr_destroy(&attributes);
+		if (result == 0 && (uintptr_t)address < stack_pointer) return (uintptr_t)address;
+	}
+
+	struct rlimit limit;
+	if (getrlimit(RLIMIT_STACK, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur / 4 * 3 < stack_pointer) {
+		return stack_pointer - limit.rlim_cur / 4 * 3;
+	}
+#endif
+	return stack_pointer > STACK_GUARD_DEFAULT_SIZE ? stack_pointer - STACK_GUARD_DEFAULT_SIZE : 0;
+}
+
+/*!
+* Zapamiętuje obecny wskaźnik stosu jako początek wypełniania i wyznacza granicę, przed którą algorytm rekurencyjny musi się zatrzymać.
+* Zeruje max_stack_bytes i stack_fallback_count oraz ustawia stack_limit_bytes w strukturze MeasureValues.
+*/
+void start_stack_guard() {
+	uintptr_t stack_pointer = STACK_POINTER();
+
+	//! Ten sam wątek ma stos pomiędzy zapamiętaną granicą a wskaźnikiem z jej odczytu, inne wątki mają stosy rozłączne.
+	if (!(guard.cached_low < stack_pointer && stack_pointer <= guard.cached_stack_pointer)) {
+		guard.cached_low = find_stack_low(stack_pointer);
+		guard.cached_stack_pointer = stack_pointer;
+	}
+
+	guard.base = stack_pointer;
+	guard.lowest = stack_pointer;
+	guard.limit = guard.cached_low + STACK_GUARD_MARGIN < stack_pointer ? guard.cached_low + STACK_GUARD_MARGIN : stack_pointer;
+
+	measure_values.max_stack_bytes = 0;
+	measure_values.stack_limit_bytes = guard.base - guard.limit;
+	measure_values.stack_fallback_count = 0;
+}
+
+/*!
+* Próbkuje wskaźnik stosu, uaktualnia max_stack_bytes i sprawdza, czy wypełnianie zbliżyło się do końca stosu.
+* Wywoływana przez algorytmy rekurencyjne tylko wtedy, gdy wchodzą głębiej niż dotąd, więc nie spowalnia pozostałych wywołań.
+* \returns true, jeśli algorytm nie może bezpiecznie wejść głębiej.
+*/
+bool stack_guard_exceeded() {
+	uintptr_t stack_pointer = STACK_POINTER();
+	if (stack_pointer < guard.lowest) {
+		guard.lowest = stack_pointer;
+		measure_values.max_stack_bytes = guard.base - stack_pointer;
+	}
+	return stack_pointer < guard.limit;
+}
@@ -0,0 +1,13 @@
+//! \file stack_guard.h Pomiar zużycia stosu przez algorytmy rekurencyjne i ochrona przed jego przepełnieniem.
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+//! Ilość bajtów stosu zostawiana wolna dla wersji iteracyjnej i wywoływanych przez nią funkcji.
+#define STACK_GUARD_MARGIN (256 * 1024)
+//! Zakładany rozmiar stosu, gdy system nie podaje jego granicy.
+#define STACK_GUARD_DEFAULT_SIZE (1024 * 1024)
+
+void start_stack_guard();
+bool stack_guard_exceeded();
@@ -0,0 +1,139 @@
+//! \file trace.c Zapis odcinków czasu do buforów poszczególnych wątków i zrzut do pliku JSON w formacie Chrome trace (chrome://tracing, Perfetto).
+
+#define _CRT_SECURE_NO_WARNINGS
+#include "trace.h"
+
+#if TRACE_TIMELINE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <allegro5/allegro.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#define THREAD_LOCAL __declspec(thread)
+#define ATOMIC_FETCH_ADD(target, value) _InterlockedExchangeAdd((volatile long*)(target), (value))
+//! Przy /volatile:ms zapis do zmiennej volatile ma semantykę release, a odczyt acquire.
+#define ATOMIC_STORE_RELEASE(target, value) (*(target) = (value))
+#define ATOMIC_LOAD_ACQUIRE(target) (*(target))
+#else
+#define THREAD_LOCAL _Thread_local
+#define ATOMIC_FETCH_ADD(target, value) __atomic_fetch_add((target), (value), __ATOMIC_ACQ_REL)
+#define ATOMIC_STORE_RELEASE(target, value) __atomic_store_n((target), (value), __ATOMIC_RELEASE)
+#define ATOMIC_LOAD_ACQUIRE(target) __atomic_load_n((target), __ATOMIC_ACQUIRE)
+#endif
+
+//! Ilość odcinków, które mieści bufor jednego wątku. Kolejne są pomijane i liczone jako utracone.
+#define TRACE_BUFFER_EVENTS 65536
+//! Maksymalna ilość wątków zapisujących odcinki.
+#define TRACE_MAX_THREADS 64
+
+//! Zapisany odcinek czasu, czasy w sekundach z al_get_time.
+typedef struct TraceEvent {
+	const char* name;
+	double start;
+	double end;
+} TraceEvent;
+
+//! Bufor odcinków jednego wątku. Zapisuje do niego tylko jego wątek, więc dodawanie odcinka nie wymaga blokady.
+typedef struct TraceBuffer {
+	TraceEvent events[TRACE_BUFFER_EVENTS];
+	volatile long event_amount; //! publikowana po zapisaniu odcinka, write_trace czyta tylko odcinki poniżej tej wartości
+	uint32_t thread_id;
+	volatile long dropped_events;
+} TraceBuffer;
+
+static TraceBuffer* volatile trace_buffers[TRACE_MAX_THREADS];
+static volatile long trace_buffer_amount = 0;
+static THREAD_LOCAL TraceBuffer* thread_buffer = NULL;
+static THREAD_LOCAL bool thread_without_buffer = false;
+
+//! Zwraca obecny czas w sekundach, używany jako początek odcinka.
+double trace_now() {
+	return al_get_time();
+}
+
+/*!
+* Zwraca bufor obecnego wątku, przy pierwszym wywołaniu w wątku tworzy go i rejestruje.
+* \returns Bufor albo NULL, jeśli zabrakło miejsca na kolejny wątek lub pamięci.
+*/
+static TraceBuffer* get_thread_buffer() {
+	if (thread_buffer || thread_without_buffer) return thread_buffer;
+
+	long slot = ATOMIC_FETCH_ADD(&trace_buffer_amount, 1);
+	TraceBuffer* buffer = slot < TRACE_MAX_THREADS ? calloc(1, sizeof(TraceBuffer)) : NULL;
+	if (buffer == NULL) {
+		thread_without_buffer = true;
+		return NULL;
+	}
+	buffer->thread_id = (uint32_t)slot + 1;
+	ATOMIC_STORE_RELEASE(&trace_buffers[slot], buffer);
+	thread_buffer = buffer;
+	return buffer;
+}
+
+/*!
+* Zapisuje odcinek trwający od start do teraz w buforze obecnego wątku.
+* \param const char* name Nazwa odcinka, stały napis bez znaków wymagających cytowania w JSON.
+* \param double start Początek odcinka zwrócony przez trace_now.
+*/
+void record_trace_span(const char* name, double start) {
+	double end = trace_now();
+	TraceBuffer* buffer = get_thread_buffer();
+	if (buffer == NULL) return;
+
+	long event_amount = buffer->event_amount;
+	if (event_amount == TRACE_BUFFER_EVENTS) {
+		ATOMIC_STORE_RELEASE(&buffer->dropped_events, buffer->dropped_events + 1);
+		return;
+	}
+	buffer->events[event_amount].name = name;
+	buffer->events[event_amount].start = start;
+	buffer->events[event_amount].end = end;
+	ATOMIC_STORE_RELEASE(&buffer->event_amount, event_amount + 1);
+}
+
+/*!
+* Zapisuje odcinki ze wszystkich wątków do pliku JSON w formacie Chrome trace. Wątki mogą w tym czasie dalej zapisywać odcinki,
+* do pliku trafiają te opublikowane przed odczytem.
+* \param const char* path Ścieżka pliku wyjściowego.
+* \returns true, jeśli plik został zapisany.
+*/
+bool write_trace(const char* path) {
+	FILE* file = fopen(path, "w");
+	if (file == NULL) return false;
+
+	long buffer_amount = ATOMIC_LOAD_ACQUIRE(&trace_buffer_amount);
+	if (buffer_amount > TRACE_MAX_THREADS) buffer_amount = TRACE_MAX_THREADS;
+
+	uint64_t written_events = 0;
+	uint64_t dropped_events = 0;
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+	for (long i = 0; i < buffer_amount; i++) {
+		TraceBuffer* buffer = ATOMIC_LOAD_ACQUIRE(&trace_buffers[i]);
+		if (buffer == NULL) continue;
+
+		long event_amount = ATOMIC_LOAD_ACQUIRE(&buffer->event_amount);
+		for (long j = 0; j < event_amount; j++) {
+			TraceEvent* event = &buffer->events[j];
+			fprintf(
+				file,
+				"%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				written_events ? "," : "",
+				event->name,
+				buffer->thread_id,
+				event->start * 1e6,
+				(event->end - event->start) * 1e6
+			);
+			written_events++;
+		}
+		dropped_events += ATOMIC_LOAD_ACQUIRE(&buffer->dropped_events);
+	}
+	fputs("\n]}\n", file);
+
+	bool success = !ferror(file);
+	success = fclose(file) == 0 && success;
+	printf("Trace: %llu spans to %s, %llu dropped\n", (unsigned long long)written_events, path, (unsigned long long)dropped_events);
+	return success;
+}
+#endif
@@ -0,0 +1,19 @@
+//! \file trace.h Odcinki czasu zapisywane w formacie Chrome trace.
+
+#pragma once
+#include <stdbool.h>
+#include "values.h"
+
+#if TRACE_TIMELINE
+double trace_now();
+void record_trace_span(const char*, double);
+bool write_trace(const char*);
+
+//! Zaczyna odcinek czasu, span to nazwa zmiennej lokalnej przechowującej jego początek.
+#define TRACE_BEGIN(span) double span = trace_now()
+//! Kończy odcinek rozpoczęty przez TRACE_BEGIN i zapisuje go pod podaną nazwą, która musi być stałym napisem.
+#define TRACE_END(span, name) record_trace_span(name, span)
+#else
+#define TRACE_BEGIN(span)
+#define TRACE_END(span, name)
+#endif
@@ -12,6 +12,8 @@ uint32_t window_width;
 
 //! Nazwy obrazów.
 extern ALLEGRO_USTR** image_names;
+//! Ilość obrazów.
+extern uint32_t IMAGE_AMOUNT;
 //! Obecny obraz.
 extern uint32_t current_image;
 //! Wybrany algorytm.
@@ -33,12 +35,95 @@ typedef enum algorithm_t
 	STACK_BASED_RECURSIVE_FOUR_WAY,
 	STACK_BASED_RECURSIVE_EIGHT_WAY,
 	QUEUE_BASED_FOUR_WAY,
-	SCANLINE_RECURSIVE
+	SCANLINE_RECURSIVE,
+	PAINTER_FOUR_WAY,
+	PARALLEL_BFS_FOUR_WAY,
+	RASTER_SWEEP_FOUR_WAY,
+	SCANLINE_RECURSIVE_EIGHT_WAY
 } algorithm_t;
 
 //! Ilość algorytmów
 extern uint32_t ALGORITHM_AMOUNT;
+//! Nazwy algorytmów.
+extern const char* algorithm_names[];
+
+
+//! Zbieranie statystyk wypełnianego obszaru podczas wypełniania, dla 0 nie są one liczone wcale.
+//! Zaznaczanie pikseli w bitmapie i liczenie obwodu po wypełnianiu wlicza się do czasu flood_fill, dlatego domyślnie jest wyłączone,
+//! a włączają je konfiguracje Debug w projekcie.
+#ifndef MEASURE_REGION_STATS
+#define MEASURE_REGION_STATS 0
+#endif
+
+//! Odczyt liczników sprzętowych procesora wokół flood_fill, dla 0 nie są one otwierane wcale.
+#ifndef MEASURE_HARDWARE_COUNTERS
+#define MEASURE_HARDWARE_COUNTERS 1
+#endif
+
+//! Zapis odcinków czasu (wczytywanie, wypełnianie, zapis, rysowanie) do pliku trace.json w formacie Chrome trace, dla 0 nie generuje żadnego kodu.
+#ifndef TRACE_TIMELINE
+#define TRACE_TIMELINE 0
+#endif
+
+//! Liczenie odczytów i zapisów pikseli przez get_pixel_color, swap_color i set_pixel_color, dla 0 nie generuje żadnego kodu.
+//! Liczniki są zwiększane przy każdym dostępie do piksela, więc domyślnie są wyłączone; włączają je konfiguracje Debug w projekcie.
+#ifndef MEASURE_PIXEL_ACCESSES
+#define MEASURE_PIXEL_ACCESSES 0
+#endif
+
+//! Liczenie, ile razy ostatnie wypełnianie odczytało każdy piksel, do nakładki z mapą cieplną (klawisz H).
+//! Nawet z wyłączoną nakładką każdy odczyt sprawdza visit_counts, dlatego domyślnie 0; włączają je konfiguracje Debug w projekcie.
+#ifndef MEASURE_VISIT_HEATMAP
+#define MEASURE_VISIT_HEATMAP 0
+#endif
+
+//! Budowa dla libFuzzera: fuzz_harness.c udostępnia LLVMFuzzerTestOneInput, a Main.c nie definiuje main.
+#ifndef FUZZ_LIBFUZZER
+#define FUZZ_LIBFUZZER 0
+#endif
+
+//! Bok kafelka w układzie IMAGE_LAYOUT_TILED jako potęga dwójki: 3 - kafelki 8x8, 5 - kafelki 32x32.
+#ifndef IMAGE_TILE_SHIFT
+#define IMAGE_TILE_SHIFT 3
+#endif
+
+//! Gdy różne od 0, load_image zamienia wczytany obraz na układ IMAGE_LAYOUT_TILED, a zapis i wyświetlanie wracają do wierszy.
+#ifndef IMAGE_LOAD_TILED
+#define IMAGE_LOAD_TILED 0
+#endif
+
+//! Największa ilość wątków równoległego BFS, razem z wątkiem wywołującym wypełnianie.
+#ifndef PARALLEL_BFS_MAX_THREADS
+#define PARALLEL_BFS_MAX_THREADS 8
+#endif
 
+//! Poziomy BFS mniejsze niż tyle pikseli przetwarza sam wątek wywołujący, bo synchronizacja wątków kosztowałaby więcej niż praca.
+#ifndef PARALLEL_BFS_MIN_FRONTIER
+#define PARALLEL_BFS_MIN_FRONTIER 4096
+#endif
+
+//! Ilość bitów na piksel w mapie odległości od klikniętego piksela: 16 albo 32.
+#ifndef DISTANCE_MAP_BITS
+#define DISTANCE_MAP_BITS 32
+#endif
+
+//! Liczniki sprzętowe procesora odczytywane podczas wypełniania.
+typedef enum hardware_counter_t
+{
+	COUNTER_INSTRUCTIONS,
+	COUNTER_CYCLES,
+	COUNTER_L1D_MISSES,
+	COUNTER_LLC_MISSES,
+	COUNTER_BRANCH_MISSES,
+	COUNTER_DTLB_MISSES,
+	HARDWARE_COUNTER_AMOUNT
+} hardware_counter_t;
+
+//! Wartości liczników sprzętowych z jednego wypełniania.
+typedef struct HardwareCounters {
+	uint64_t values[HARDWARE_COUNTER_AMOUNT];
+	uint32_t available; //! maska bitowa, bit licznika jest ustawiony, jeśli udało się go odczytać
+} HardwareCounters;
 
 //! Wartosci mierzone podczas wykonywania algorytmow
 typedef struct MeasureValues {
@@ -47,6 +132,31 @@ typedef struct MeasureValues {
 	uint64_t duration;
 	uint64_t max_stack_height;
 	uint64_t current_stack_height;
+	uint64_t max_stack_bytes; //! największe zmierzone zużycie stosu przez algorytm rekurencyjny w bajtach
+	uint64_t stack_limit_bytes; //! ilość bajtów stosu, którą algorytm rekurencyjny mógł wykorzystać
+	uint64_t stack_fallback_count; //! ile razy algorytm rekurencyjny przeszedł na wersję iteracyjną, bo kończył mu się stos
+	uint64_t incomplete_fills; //! ile razy wypełnianie iteracyjne przerwano, bo zabrakło pamięci na stos roboczy, obszar jest wtedy wypełniony częściowo
+	uint64_t boundary_steps; //! kroki malarza po krawędzi obszaru w algorytmie o stałej pamięci, razem z obchodzeniem pętli
+	uint64_t bfs_levels; //! poziomy równoległego BFS, ostatni poziom to piksele najdalsze od klikniętego
+	uint64_t bfs_max_frontier; //! ilość pikseli na najliczniejszym poziomie równoległego BFS
+	uint32_t bfs_threads; //! ilość wątków równoległego BFS
+	uint64_t sweep_count; //! przejścia obrazu w dół i w górę w algorytmie przejść rastra
+	uint64_t region_count; //! ilość obszarów po wypełnieniu wszystkich obszarów obrazu, 0 dla zwykłego wypełniania
+	double megapixels_per_second;
+	//! Statystyki wypełnionego obszaru, liczone tylko gdy MEASURE_REGION_STATS jest różne od 0
+	uint64_t area;
+	uint32_t min_x;
+	uint32_t min_y;
+	uint32_t max_x;
+	uint32_t max_y;
+	uint64_t sum_x; //! suma współrzędnych X, środek obszaru to sum_x / area
+	uint64_t sum_y; //! suma współrzędnych Y, środek obszaru to sum_y / area
+	uint64_t perimeter_pixels;
+	//! Dostępy do pikseli podczas wypełniania, liczone tylko gdy MEASURE_PIXEL_ACCESSES jest różne od 0
+	uint64_t pixel_reads;
+	uint64_t pixel_writes;
+	uint64_t rejected_pixel_accesses; //! odczyty i zapisy poza obrazem, odrzucone przez sprawdzenie granic
+	HardwareCounters hardware_counters; //! liczniki ostatniego wypełniania, tylko gdy MEASURE_HARDWARE_COUNTERS jest różne od 0
 } MeasureValues;
 extern MeasureValues measure_values;
 
@@ -57,6 +167,37 @@ typedef struct Color_t {
 	uint8_t b;
 } Color_t;
 
+//! Punkt startowy wypełniania wsadowego wraz z kolorem, którym wypełniamy jego obszar.
+typedef struct Seed_t {
+	uint32_t x;
+	uint32_t y;
+	Color_t color;
+} Seed_t;
+
+//! Wartości mierzone dla pojedynczego punktu startowego podczas wypełniania wsadowego.
+typedef struct SeedStats {
+	uint64_t filled_pixels;
+	uint64_t clock_cycle_count;
+	bool already_filled; //! true, jeśli punkt trafił w obszar wypełniony przez wcześniejszy punkt
+	bool fell_back; //! true, jeśli wypełnianiu wsadowemu zabrakło pamięci i obszar, w całości lub części, został wypełniony osobno
+	bool incomplete; //! true, jeśli pamięci zabrakło także na osobne wypełnianie i obszar jest wypełniony tylko częściowo
+} SeedStats;
+
+//! Odległość piksela od klikniętego piksela w krokach do sąsiadów z góry, dołu i boków, zapisywana w mapie odległości.
+#if DISTANCE_MAP_BITS == 16
+typedef uint16_t distance_t;
+#else
+typedef uint32_t distance_t;
+#endif
+//! Odległość pikseli, do których wypełnianie nie dotarło. Większe odległości są zapisywane jako DISTANCE_UNREACHED - 1.
+#define DISTANCE_UNREACHED ((distance_t)-1)
+
+//! Układ pikseli w tablicy as_array.
+typedef enum image_layout_t {
+	IMAGE_LAYOUT_ROW_MAJOR, //! wiersz po wierszu, w takim układzie są piksele w plikach obrazów i w bitmapach Allegro
+	IMAGE_LAYOUT_TILED //! kwadratowe kafelki o boku 1 << IMAGE_TILE_SHIFT, kafelki i piksele w kafelku wiersz po wierszu
+} image_layout_t;
+
 /*!
 * Struktura przechowująca wszystkie informacje dotyczące badanego zdjęcia.
 * Zawiera ścieżkę do pliku, plik Bitmapy do wyświetlenia, tablicę char*(składowe kolorów pikseli),
@@ -73,7 +214,12 @@ typedef struct Image {
 	uint32_t stb_y;
 	uint32_t stb_comp;
 	double scale; //! mnożnik, który ustawia wielkość pojedynczego piksela, tak żeby obraz nie wychodził za ekran
+	image_layout_t layout; //! wyzerowana struktura ma układ wiersz po wierszu, zmienia go convert_image_layout
+	uint32_t tile_columns; //! ilość kafelków w wierszu kafelków dla IMAGE_LAYOUT_TILED
 } Image;
 
+//! Funkcja wywoływana przez szybkie algorytmy po każdym wypełnionym pikselu, np. do zapisu animacji.
+typedef void (*fill_step_t)(Image*);
+
 //! Kolor używany do wypełniania.
 extern Color_t replacement_color;
\ No newline at end of file
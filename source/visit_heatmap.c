@@ -0,0 +1,177 @@
+//! \file visit_heatmap.c Mapa cieplna pokazująca, ile razy ostatnie wypełnianie odczytało każdy piksel, rysowana jako półprzezroczysta nakładka na obraz.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <allegro5/allegro.h>
+#include "visit_heatmap.h"
+#include "values.h"
+
+uint32_t* visit_counts = NULL;
+const uint8_t* visit_pixels = NULL;
+
+//! Stan mapy cieplnej.
+typedef struct VisitHeatmap {
+	bool enabled;
+	uint64_t capacity; //! ilość liczników, na które jest zaalokowana pamięć
+	uint32_t width;
+	uint32_t height;
+	ALLEGRO_BITMAP* bitmap;
+	bool bitmap_valid; //! bitmapa pokazuje liczniki ostatniego wypełniania obrazu visit_pixels
+} VisitHeatmap;
+
+static VisitHeatmap heatmap = { 0 };
+
+/*!
+* Włącza albo wyłącza liczenie odczytów pikseli. Włączenie działa od następnego wypełniania, wyłączenie zwalnia liczniki.
+* \param bool enabled Czy liczyć odczyty i rysować nakładkę.
+*/
+void set_visit_heatmap_enabled(bool enabled) {
+	heatmap.enabled = enabled;
+	if (!enabled) {
+		free(visit_counts);
+		visit_counts = NULL;
+		visit_pixels = NULL;
+		heatmap.capacity = 0;
+		heatmap.bitmap_valid = false;
+	}
+}
+
+//! Zwraca, czy mapa cieplna jest włączona.
+bool visit_heatmap_enabled() {
+	return heatmap.enabled;
+}
+
+/*!
+* Zeruje liczniki przed wypełnianiem obrazu, wywoływana przez flood_fill. Gdy mapa jest wyłączona, nic nie robi.
+* \param const Image* image Wypełniany obraz, liczone są tylko odczyty jego tablicy pikseli.
+*/
+void start_visit_heatmap(const Image* image) {
+	heatmap.bitmap_valid = false;
+	if (!heatmap.enabled) return;
+
+	uint64_t pixel_amount = (uint64_t)image->width * image->height;
+	if (pixel_amount > heatmap.capacity) {
+		free(visit_counts);
+		visit_counts = malloc(sizeof(uint32_t) * pixel_amount);
+		heatmap.capacity = visit_counts ? pixel_amount : 0;
+	}
+	if (visit_counts == NULL) {
+		visit_pixels = NULL;
+		return;
+	}
+
+	memset(visit_counts, 0, sizeof(uint32_t) * pixel_amount);
+	visit_pixels = image->as_array;
+	heatmap.width = image->width;
+	heatmap.height = image->height;
+}
+
+//! Unieważnia nakładkę, np. gdy obraz został zmieniony bez flood_fill.
+void clear_visit_heatmap() {
+	visit_pixels = NULL;
+	heatmap.bitmap_valid = false;
+}
+
+/*!
+* Wyznacza kolor nakładki dla ilości odczytów: 0 - przezroczysty, 1 - niebieski, dalej przez błękitny, zielony i żółty
+* do czerwonego dla VISIT_HEATMAP_MAX_LEVEL i więcej. Składowe są przemnożone przez alpha, tak jak oczekuje domyślny blender Allegro.
+* \param uint32_t visits Ilość odczytów piksela.
+* \param uint8_t* pixel Piksel bitmapy w formacie ABGR_8888_LE.
+*/
+static void visit_color(uint32_t visits, uint8_t* pixel) {
+	if (visits == 0) {
+		memset(pixel, 0, 4);
+		return;
+	}
+
+	uint32_t level = visits < VISIT_HEATMAP_MAX_LEVEL ? visits : VISIT_HEATMAP_MAX_LEVEL;
+	double position = (double)(level - 1) / (VISIT_HEATMAP_MAX_LEVEL - 1) * 4;
+	uint32_t segment = position >= 4 ? 3 : (uint32_t)position;
+	double t = position - segment;
+
+	//! Odcinki skali: niebieski -> błękitny -> zielony -> żółty -> czerwony.
+	static const double stops[5][3] = { { 0, 0, 1 }, { 0, 1, 1 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 } };
+	for (uint32_t i = 0; i < 3; i++) {
+		double component = stops[segment][i] + (stops[segment + 1][i] - stops[segment][i]) * t;
+		pixel[i] = (uint8_t)(component * VISIT_HEATMAP_ALPHA + 0.5);
+	}
+	pixel[3] = VISIT_HEATMAP_ALPHA;
+}
+
+/*!
+* Tworzy bitmapę nakładki z liczników ostatniego wypełniania, jeśli dotyczyło ono tego obrazu.
+* \param const Image* image Wyświetlany obraz.
+*/
+void update_visit_heatmap_bitmap(const Image* image) {
+	if (!heatmap.enabled || visit_counts == NULL || visit_pixels != image->as_array
+		|| heatmap.width != image->width || heatmap.height != image->height) return;
+
+	if (heatmap.bitmap
+		&& (al_get_bitmap_width(heatmap.bitmap) != image->width || al_get_bitmap_height(heatmap.bitmap) != image->height)) {
+		al_destroy_bitmap(heatmap.bitmap);
+		heatmap.bitmap = NULL;
+	}
+	if (heatmap.bitmap == NULL) {
+		heatmap.bitmap = al_create_bitmap(image->width, image->height);
+		if (heatmap.bitmap == NULL) return;
+	}
+
+	ALLEGRO_LOCKED_REGION* region = al_lock_bitmap(heatmap.bitmap, ALLEGRO_PIXEL_FORMAT_ABGR_8888_LE, ALLEGRO_LOCK_WRITEONLY);
+	if (region == NULL) return;
+
+	//! Kolory dla kolejnych ilości odczytów liczymy raz, powyżej VISIT_HEATMAP_MAX_LEVEL kolor się nie zmienia.
+	uint8_t palette[VISIT_HEATMAP_MAX_LEVEL + 1][4];
+	for (uint32_t level = 0; level <= VISIT_HEATMAP_MAX_LEVEL; level++) visit_color(level, palette[level]);
+
+	uint64_t max_visits = 0;
+	uint64_t total_visits = 0;
+	uint64_t visited_pixels = 0;
+	for (uint32_t y = 0; y < image->height; y++) {
+		uint8_t* row = (uint8_t*)region->data + (int64_t)y * region->pitch;
+		const uint32_t* counts = visit_counts + (uint64_t)y * image->width;
+		for (uint32_t x = 0; x < image->width; x++) {
+			uint32_t visits = counts[x];
+			memcpy(row + x * 4, palette[visits < VISIT_HEATMAP_MAX_LEVEL ? visits : VISIT_HEATMAP_MAX_LEVEL], 4);
+			if (visits > max_visits) max_visits = visits;
+			total_visits += visits;
+			visited_pixels += visits > 0;
+		}
+	}
+	al_unlock_bitmap(heatmap.bitmap);
+	heatmap.bitmap_valid = true;
+
+	printf(
+		"Heatmap: %llu pixels read, %.2f reads per read pixel, at most %llu\n",
+		visited_pixels,
+		visited_pixels ? (double)total_visits / visited_pixels : 0.0,
+		max_visits
+	);
+}
+
+/*!
+* Rysuje nakładkę w tym samym miejscu i skali co obraz, jeśli jest aktualna dla tego obrazu.
+* \param const Image* image Wyświetlany obraz.
+*/
+void draw_visit_heatmap(const Image* image) {
+	if (!heatmap.enabled || !heatmap.bitmap_valid || visit_pixels != image->as_array) return;
+	al_draw_scaled_bitmap(
+		heatmap.bitmap,
+		0,
+		0,
+		image->width,
+		image->height,
+		0,
+		0,
+		image->width * image->scale,
+		image->height * image->scale,
+		0
+	);
+}
+
+//! Zwalnia liczniki i bitmapę nakładki.
+void destroy_visit_heatmap() {
+	set_visit_heatmap_enabled(false);
+	if (heatmap.bitmap) al_destroy_bitmap(heatmap.bitmap);
+	heatmap.bitmap = NULL;
+}
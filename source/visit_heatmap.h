@@ -0,0 +1,31 @@
+//! \file visit_heatmap.h Mapa cieplna odczytów pikseli przez ostatnie wypełnianie.
+
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "values.h"
+
+//! Przezroczystość nakładki, 0 - niewidoczna, 255 - nieprzezroczysta.
+#define VISIT_HEATMAP_ALPHA 160
+//! Ilość odczytów piksela, od której nakładka ma kolor czerwony. Jeden odczyt jest niebieski.
+#define VISIT_HEATMAP_MAX_LEVEL 8
+
+//! Liczniki odczytów pikseli wypełnianego obrazu, NULL gdy mapa cieplna jest wyłączona.
+extern uint32_t* visit_counts;
+//! Tablica pikseli, której odczyty są liczone, odczyty innych obrazów (np. kopii w pomiarach) są pomijane.
+extern const uint8_t* visit_pixels;
+
+//! Dolicza odczyt piksela do mapy cieplnej, bez MEASURE_VISIT_HEATMAP nie generuje żadnego kodu.
+#if MEASURE_VISIT_HEATMAP
+#define COUNT_PIXEL_VISIT(x, y, image) if (visit_counts && (image)->as_array == visit_pixels) visit_counts[(uint64_t)(y) * (image)->width + (x)]++
+#else
+#define COUNT_PIXEL_VISIT(x, y, image)
+#endif
+
+void set_visit_heatmap_enabled(bool);
+bool visit_heatmap_enabled();
+void start_visit_heatmap(const Image*);
+void clear_visit_heatmap();
+void update_visit_heatmap_bitmap(const Image*);
+void draw_visit_heatmap(const Image*);
+void destroy_visit_heatmap();